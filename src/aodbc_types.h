@@ -3,6 +3,7 @@
 
 
 #include "headers.h"
+#include "event_loop.h"
 
 
 #define DISCONNECTED 0
@@ -11,30 +12,235 @@
 #define TO_DISCONNECT 3
 
 
+/*
+    The state of the module, each interpreter has its own
+*/
+typedef struct module_state {
+    PyTypeObject *connection_type;
+    PyTypeObject *cursor_type;
+    PyTypeObject *pool_type;
+    PyTypeObject *pool_request_type;
+    PyTypeObject *group_type;
+    SQLHENV env;  // shared by the connections, it's allocated at the first connection
+    unsigned char env_pooling:1;  // the driver manager reuses the connections of the environment
+    unsigned char env_relaxed_match:1;
+    #ifdef __linux__
+    thread_pool pool;
+    timer_wheel wheel;
+    poller poller;
+    _Atomic(PyObject *) get_running_loop;
+    #endif
+} module_state;
+
+
+/*
+    The common beginning of Connection and Cursor, the handle type tells them apart
+*/
+typedef struct odbc_object {
+    PyObject_HEAD
+
+    SQLHANDLE handle;
+    SQLSMALLINT handle_type;
+    SQLRETURN retcode;
+} odbc_object;
+
+
+#define FREE_LIST_SIZE 16
+
+// a handle prepared for the query, it isn't used by a cursor
+typedef struct prepared_statement {
+    const wchar_t *query;
+    size_t hash;
+    SQLHSTMT handle;
+    struct prepared_statement *prev;  // the more recently used one
+    struct prepared_statement *next;
+} prepared_statement;
+
+typedef struct statement_cache {
+    prepared_statement *head;  // the most recently used one
+    prepared_statement *tail;
+    Py_ssize_t count;
+    Py_ssize_t max_size;  // 0 - the cache is disabled
+    unsigned long long hits;
+    unsigned long long misses;
+    unsigned long long evictions;
+} statement_cache;
+
+#define PARSED_QUERIES_SIZE 256  // the cache of a connection is cleared when it's full
+
+// the query with the positional markers for the driver, the named markers are replaced by "?"
+typedef struct parsed_query {
+    wchar_t *query;
+    Py_ssize_t length;  // without the terminator
+    Py_ssize_t parameter_count;
+    PyObject *names;  // the names of the markers in their order, NULL - the markers are positional
+} parsed_query;
+
+#define BATCH_MAX_PARAMETERS 2100  // the limit of SQL Server for one request
+
+// the queries of Connection.fetchall, which are sent by one execution
+typedef struct statement_batching {
+    PyObject *requests;  // the tuples (query, params, future) waiting for the flush
+    PyObject *timer;  // the handle of the loop callback, which flushes them
+    Py_ssize_t parameter_count;
+    Py_ssize_t max_size;  // 0 - each query is executed at once
+    double window;  // seconds, 0 - until the next iteration of the loop
+    double timeout;  // the timeout of the batch, 0 if one of the queries is without it
+} statement_batching;
+
 typedef struct Connection {
     PyObject_HEAD
 
-    SQLHENV env;
     SQLHDBC handle;
     SQLSMALLINT handle_type;
     SQLRETURN retcode;
+    SQLHENV env;
+    PyObject *module;
+    PyObject *owner;  // the pool, which the connection is acquired from
     HANDLE event;
     ESTATUS event_status;
-    SQLUSMALLINT mca;
+    #ifdef __linux__
+    thread_pool *pool;
+    timer_wheel *wheel;
+    poller *poller;  // NULL - the statements are executed by the worker pool
+    #endif
+    SQLUSMALLINT mca;  // 0 - without a limit
     SQLUSMALLINT runned_cursors;
+    struct Cursor *queue_head;  // the statements waiting for a slot, in FIFO order
+    struct Cursor *queue_tail;
+    SQLHSTMT free_stmts[FREE_LIST_SIZE];  // the reset statement handles of the closed cursors
+    struct Cursor *free_cursors[FREE_LIST_SIZE];  // the memory of the freed cursors
+    unsigned char free_stmt_count;
+    unsigned char free_cursor_count;
+    statement_cache cache;
+    statement_batching batching;
+    PyObject *parsed_queries;  // the query strings and the capsules of their parsed_query
     const wchar_t *dsn;
-    long long timeout;
-    clock_t start_time;
+    double timeout;  // seconds
+    timer_entry timer;
+    long long created_at;  // ms of the monotonic clock
     double rate;
     unsigned char state:2;
     unsigned char is_exc:1;
 } Connection;
 
+typedef struct idle_connection {
+    Connection *conn;
+    long long idle_since;  // ms of the monotonic clock
+} idle_connection;
+
+/*
+    The pool reuses the established connections, its size counts the idle, acquired and connecting ones
+*/
+typedef struct ConnectionPool {
+    PyObject_HEAD
+
+    PyObject *module;
+    const wchar_t *dsn;
+    double timeout;  // seconds
+    double idle_timeout;  // seconds, 0 - infinite
+    double max_lifetime;  // seconds, 0 - infinite
+    idle_connection *idle;  // a stack, the last released connection is reused first
+    Py_ssize_t idle_count;
+    PyObject *pending;  // the connections opened by create_pool or closed by close
+    PyObject *waiters;  // the futures of the tasks waiting for a released connection
+    PyObject *error_type;  // the first error of the opening, it's raised after the closing
+    PyObject *error_value;
+    PyObject *error_traceback;
+    Py_ssize_t min_size;
+    Py_ssize_t max_size;
+    Py_ssize_t size;
+    unsigned char state:2;
+    unsigned char polling:1;
+} ConnectionPool;
+
+#define REQUEST_ACQUIRE 0
+#define REQUEST_WAIT 1
+#define REQUEST_CONNECT 2
+#define REQUEST_EXECUTE 3
+#define REQUEST_FETCH 4
+#define REQUEST_ACQUIRED 5
+#define REQUEST_DONE 6
+
+#define REQUEST_KIND_ACQUIRE 0
+#define REQUEST_KIND_EXECUTE 1
+#define REQUEST_KIND_FETCHALL 2
+
+/*
+    The awaitable of acquire, execute and fetchall of a pool
+*/
+typedef struct PoolRequest {
+    PyObject_HEAD
+
+    ConnectionPool *pool;
+    Connection *conn;
+    PyObject *future;  // the waiting for a released connection
+    PyObject *cursor;
+    PyObject *awaited;  // the awaitable of the cursor
+    PyObject *args;  // the arguments of Cursor.execute
+    PyObject *kwargs;
+    unsigned char kind:2;
+    unsigned char state:3;
+} PoolRequest;
+
+/*
+    The awaitable of connect_many, the connections are opened in parallel by the workers
+*/
+typedef struct ConnectionGroup {
+    PyObject_HEAD
+
+    PyObject *module;
+    PyObject *results;  // a connection or the exception of its opening per place
+    PyObject *future;  // it's resolved, when any of the connections is ready
+    Py_ssize_t *pending;  // the places of the connecting ones
+    Py_ssize_t pending_count;
+    Py_ssize_t opened;
+    Py_ssize_t quorum;
+    unsigned char is_done:1;
+} ConnectionGroup;
+
+#define EXEC_DIRECT 0  // SQLExecDirectW
+#define EXEC_PREPARE 1  // SQLPrepareW without the execution
+#define EXEC_PREPARE_EXECUTE 2  // SQLPrepareW and SQLExecute
+#define EXEC_EXECUTE 3  // SQLExecute of the prepared statement
+#define EXEC_NONE 4  // the statement is already prepared
+#define EXEC_MORE_RESULTS 5  // SQLMoreResults of the next result set
+
 #define CLOSED 0
 #define TO_OPEN 1
 #define OPENED 2
 #define TO_EXECUTE 3
 #define EXECUTED 4
+#define TO_FETCH 5
+
+#define SHORT_STRING_LENGTH 16  // UTF-16 units of the strings, which are kept in the parameter
+#define STREAM_STRING_LENGTH 32768  // UTF-16 units, the longer strings are sent at the execution
+#define STREAM_CHUNK_SIZE 65536  // bytes of a SQLPutData call
+#define STREAM_BINARY_SIZE 65536  // bytes, the larger buffers are sent at the execution
+
+// the sources of the values, which are sent by SQLPutData at the execution
+#define STREAM_STRING 0
+#define STREAM_BUFFER 1
+#define STREAM_READER 2  // the read method of a file, it can return an awaitable
+#define STREAM_ITERATOR 3
+#define STREAM_ASYNC_ITERATOR 4
+
+/*
+    The current chunk is sent by the worker without the GIL,
+    the next chunk of a file or an iterator is read by the loop between the calls of the worker
+*/
+typedef struct parameter_stream {
+    PyObject *source;
+    PyObject *chunk;  // the string of the chunk, NULL - the chunk is in the view
+    Py_buffer view;  // the bytes of the chunk
+    PyObject *reading;  // the iterator of the awaitable, which returns the next chunk
+    Py_ssize_t offset;  // the sent code points of the string or bytes of the view
+    unsigned char kind:3;
+    unsigned char is_text:1;
+    unsigned char is_end:1;  // the source is exhausted
+    unsigned char is_put:1;  // SQLPutData was called for the value
+} parameter_stream;
+
 
 typedef struct _parameter {
     union value {
@@ -48,38 +254,206 @@ typedef struct _parameter {
         #elif __linux__
         char16_t *v_str;
         #endif
+        SQLWCHAR v_short[SHORT_STRING_LENGTH];
 
         SQL_TIMESTAMP_STRUCT v_datetime;
         SQL_DATE_STRUCT v_date;
         SQL_TIME_STRUCT v_time;
     } value;
     SQLLEN indicator;
+    SQLLEN str_capacity;  // the size of v_str in bytes, it's reused by the next string
     unsigned char alloc_str:1;
+    unsigned char is_viewed:1;  // the view is bound
+
+    Py_buffer view;  // the bytes, which are bound without the copy until the end of the execution
+
+    // the binding of the last execution, the same one isn't passed to the driver again, 0 - not bound
+    SQLSMALLINT c_type;
+    SQLSMALLINT sql_type;
+    SQLULEN column_size;
+    SQLSMALLINT decimal_digits;
+    SQLPOINTER buffer;
+    SQLLEN buffer_length;
+
+    parameter_stream *stream;  // the value, which is sent at the execution
 } parameter;
 
 typedef struct parameters_info {
     parameter *parameters;
     Py_ssize_t params_length;
+    Py_ssize_t stream_count;
+    Py_ssize_t view_count;
+    parameter *streamed;  // the parameter, which takes the data at the execution
+    SQLWCHAR *chunk;  // the UTF-16 of the streamed strings, it's in the memory of the statement
+    unsigned char is_putting:1;  // the execution has asked for the data
 } parameters_info;
 
+// the values of a parameter for all rows of a batch, they're bound by column
+typedef struct parameter_array {
+    SQLSMALLINT c_type;
+    SQLSMALLINT sql_type;
+    SQLULEN column_size;
+    SQLSMALLINT decimal_digits;
+    SQLLEN width;  // the size of a value in bytes
+    char *values;
+    SQLLEN *indicators;
+} parameter_array;
+
+#define SOURCE_INT32 0
+#define SOURCE_INT64 1
+#define SOURCE_FLOAT32 2
+#define SOURCE_FLOAT64 3
+#define SOURCE_BOOL 4
+#define SOURCE_UTF8 5  // fixed-width UTF-8 strings padded by zeros
+#define SOURCE_UCS4 6  // fixed-width UCS4 strings padded by zeros
+#define SOURCE_OFFSETS32 7  // UTF-8 strings in the data at the int32 offsets
+#define SOURCE_OFFSETS64 8  // UTF-8 strings in the data at the int64 offsets
+
+// a column of insert_columns, the values are read from the buffers of the objects without PyObjects
+typedef struct column_source {
+    Py_buffer values;  // the fixed-width values or the data of the strings
+    Py_buffer offsets;  // n + 1 offsets of the strings in the data
+    Py_buffer validity;  // a byte per row, 0 - NULL
+    Py_ssize_t row_count;
+    Py_ssize_t width;  // the size of the fixed-width value of a row in bytes
+    unsigned char kind;
+} column_source;
+
+// executemany binds the rows by batches, the next batch is bound after the previous one is executed
+typedef struct batch_info {
+    PyObject *rows;  // the list or the tuple of the parameter tuples
+    column_source *columns;  // or the columns of insert_columns
+    Py_ssize_t total;  // the rows of all batches
+    Py_ssize_t offset;  // the first row of the bound batch
+    Py_ssize_t count;  // the rows of the bound batch
+    Py_ssize_t size;  // the max rows of a batch
+    Py_ssize_t params_length;
+    parameter_array *arrays;
+    SQLUSMALLINT *status;
+    SQLULEN processed;
+    PyObject *statuses;  // the list of the statuses of the executed rows
+} batch_info;
+
+typedef struct column_info {
+    PyObject *key;  // the column name, it's created on the event loop thread
+    SQLWCHAR name[256];
+    SQLSMALLINT name_length;
+    SQLSMALLINT sql_type;
+    SQLSMALLINT c_type;  // the target type of SQLGetData
+    size_t data_size;  // the first buffer of a variable length value, bytes
+} column_info;
+
+typedef struct result_info {
+    column_info *columns;
+    SQLSMALLINT column_count;
+    SQLLEN row_count;  // SQLRowCount of the current result, -1 if it's unknown
+    unsigned char is_described:1;
+    unsigned char is_end:1;  // all rows are taken, the next fetching returns an empty list
+} result_info;
+
+#define ARENA_BLOCK_SIZE 65536  // bytes
+
+typedef struct arena_block {
+    struct arena_block *next;
+    size_t size;
+    size_t used;
+    char data[];
+} arena_block;
+
+/*
+    The memory of the small values, which are freed together, it's allocated by malloc without the GIL.
+    The blocks of ARENA_BLOCK_SIZE are kept for the next values after the reset,
+    a larger value takes its own block, which is freed by the reset
+*/
+typedef struct arena {
+    arena_block *head;  // the block of the last allocation
+    arena_block *current;  // the block of the small values
+    arena_block *first;  // the blocks of the small values in the order of use
+    arena_block *large;  // the blocks of the larger values, the last one is the first
+} arena;
+
+// the value of a column is read into a cell without the GIL and converted to PyObject later
+typedef struct cell {
+    SQLLEN indicator;  // SQL_NULL_DATA or the length of a variable-length value in bytes
+    union cell_value {
+        SQLINTEGER v_int;
+        SQLBIGINT v_bigint;
+        SQLCHAR v_char;
+        SQLDOUBLE v_double;
+        SQL_NUMERIC_STRUCT v_numeric;
+        SQL_TIMESTAMP_STRUCT v_datetime;
+        SQL_DATE_STRUCT v_date;
+        SQL_TIME_STRUCT v_time;
+        void *v_data;
+    } value;
+} cell;
+
+typedef struct row_batch {
+    cell *cells;  // rows * column_count
+    size_t rows;
+    size_t capacity;  // in rows
+    size_t limit;  // 0 - all rows
+    arena values;  // the variable-length values of the cells
+    const char *failed_fn;
+    char *error_message;
+    unsigned char is_end:1;
+    unsigned char no_memory:1;
+} row_batch;
+
+#define PREFETCH_DEFAULT_DEPTH 2
+
+// the batches are filled by a worker, while the event loop thread converts the previous ones
+typedef struct prefetch_info {
+    row_batch **batches;  // a ring of the filled batches
+    size_t depth;
+    size_t head;
+    size_t count;
+    size_t size;  // rows in a batch
+    #ifdef __linux__
+    pthread_mutex_t lock;
+    pthread_cond_t idle;
+    #endif
+    unsigned char is_running:1;  // the filler is submitted to the worker pool
+    unsigned char is_end:1;  // the last batch is published
+    unsigned char is_stopped:1;
+    unsigned char no_memory:1;
+} prefetch_info;
+
 typedef struct Cursor {
     PyObject_HEAD
 
-    Connection *conn;
     SQLHSTMT handle;
     SQLSMALLINT handle_type;
     SQLRETURN retcode;
+    Connection *conn;
     HANDLE event;
     ESTATUS event_status;
     parameters_info p_info;
+    result_info r_info;
+    row_batch *batch;
+    prefetch_info *prefetch;
+    batch_info *many;  // the batches of executemany
+    PyObject *sets;  // the results of fetch_all_sets
+    Py_ssize_t batch_size;  // the statements of a batch, fetch_all_sets keeps their errors in place of the results
     const wchar_t *query;
-    long long timeout;
-    clock_t start_time;
+    arena memory;  // the transient buffers of the statement
+    double timeout;  // seconds
+    timer_entry timer;
+    #ifdef __linux__
+    poll_entry poll;
+    char16_t *polled_query;  // the same arguments are passed on each call in the polling mode
+    #endif
+    struct Cursor *next_queued;
+    const wchar_t *prepared_query;  // the query, which the handle is prepared for
     unsigned char state:3;
+    unsigned char exec_mode:3;
+    unsigned char is_queued:1;  // the statement waits for a slot of the connection
+    unsigned char is_cancelled:1;  // SQLCancel was called for the awaited operation
+    unsigned char is_polled:1;  // the statement is executed in the asynchronous mode by the poller thread
 } Cursor;
 
 
-inline void close_event(HANDLE *event, ESTATUS *event_status)
+static inline void close_event(HANDLE *event, ESTATUS *event_status)
 {
     #ifdef _WIN32
     if (*event != NULL && *event != INVALID_HANDLE_VALUE) {
@@ -89,6 +463,7 @@ inline void close_event(HANDLE *event, ESTATUS *event_status)
     }
     #elif __linux__
     if (*event != NULL) {
+        release_event_waiter(*event);
         close_t_event(*event);
         *event = NULL;
         *event_status = 258;
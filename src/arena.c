@@ -0,0 +1,168 @@
+#include "arena.h"
+
+
+#define ARENA_ALIGNMENT 8
+
+
+static arena_block* new_block(size_t size)
+{
+    arena_block *block = (arena_block *)malloc(sizeof(arena_block) + size);
+    if (block == NULL) {
+        return NULL;
+    }
+
+    block->next = NULL;
+    block->size = size;
+    block->used = 0;
+    return block;
+}
+
+
+void arena_init(arena *memory)
+{
+    memory->head = NULL;
+    memory->current = NULL;
+    memory->first = NULL;
+    memory->large = NULL;
+}
+
+
+/*
+    The value above ARENA_BLOCK_SIZE takes its own block
+*/
+static void* alloc_large(arena *memory, size_t size)
+{
+    arena_block *block = new_block(size);
+    if (block == NULL) {
+        return NULL;
+    }
+
+    block->next = memory->large;
+    block->used = size;
+    memory->large = block;
+    memory->head = block;
+    return block->data;
+}
+
+
+void* arena_alloc(arena *memory, size_t size)
+{
+    if (size > ARENA_BLOCK_SIZE) {
+        return alloc_large(memory, size);
+    }
+
+    arena_block *block = memory->current;
+    size_t offset = 0;
+
+    if (block != NULL) {
+        offset = (block->used + ARENA_ALIGNMENT - 1) & ~(size_t)(ARENA_ALIGNMENT - 1);
+    }
+
+    if (block == NULL || offset + size > block->size) {
+        // the next block is kept from the values before the reset
+        arena_block *next = block != NULL ? block->next : NULL;
+        if (next == NULL) {
+            next = new_block(ARENA_BLOCK_SIZE);
+            if (next == NULL) {
+                return NULL;
+            }
+
+            if (block == NULL) {
+                memory->first = next;
+            } else {
+                block->next = next;
+            }
+        }
+
+        block = next;
+        memory->current = block;
+        offset = 0;
+    }
+
+    block->used = offset + size;
+    memory->head = block;
+    return &block->data[offset];
+}
+
+
+/*
+    The last allocation grows in its block or moves to a new one with its used bytes,
+    the left space is freed with the arena. The own block of a large value is reallocated
+*/
+void* arena_grow(arena *memory, void *last, size_t used, size_t size)
+{
+    arena_block *block = memory->head;
+    size_t offset = (size_t)((char *)last - block->data);
+
+    if (offset + size <= block->size) {
+        block->used = offset + size;
+        return last;
+    }
+
+    if (block == memory->large) {
+        arena_block *grown = (arena_block *)realloc(block, sizeof(arena_block) + size);
+        if (grown == NULL) {
+            return NULL;
+        }
+        grown->size = size;
+        grown->used = size;
+        memory->large = grown;
+        memory->head = grown;
+        return grown->data;
+    }
+
+    block->used = offset;
+    char *data = (char *)arena_alloc(memory, size);
+    if (data == NULL) {
+        return NULL;
+    }
+
+    memcpy(data, last, used);
+    return data;
+}
+
+
+/*
+    The last allocation returns the unused bytes to its block
+*/
+void arena_trim(arena *memory, void *last, size_t size)
+{
+    arena_block *block = memory->head;
+    block->used = (size_t)((char *)last - block->data) + size;
+}
+
+
+/*
+    The blocks of the small values are reused from the first one, so only the blocks of the large values
+    are freed, the reset of the small values doesn't depend on their number
+*/
+void arena_reset(arena *memory)
+{
+    arena_block *block = memory->large;
+    while (block != NULL) {
+        arena_block *next = block->next;
+        free(block);
+        block = next;
+    }
+    memory->large = NULL;
+
+    if (memory->first != NULL) {
+        memory->first->used = 0;
+    }
+    memory->current = memory->first;
+    memory->head = memory->first;
+}
+
+
+void arena_free(arena *memory)
+{
+    arena_reset(memory);
+
+    arena_block *block = memory->first;
+    while (block != NULL) {
+        arena_block *next = block->next;
+        free(block);
+        block = next;
+    }
+    arena_init(memory);
+}
@@ -0,0 +1,17 @@
+#ifndef _ARENA_H_
+#define _ARENA_H_
+
+
+#include "aodbc_types.h"
+
+
+// the functions don't need the GIL
+void arena_init(arena *memory);
+void* arena_alloc(arena *memory, size_t size);
+void* arena_grow(arena *memory, void *last, size_t used, size_t size);
+void arena_trim(arena *memory, void *last, size_t size);
+void arena_reset(arena *memory);
+void arena_free(arena *memory);
+
+
+#endif
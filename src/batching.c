@@ -0,0 +1,489 @@
+#include "batching.h"
+
+
+// begin static declarations
+static PyObject* on_batch_window(PyObject *conn, PyObject *unused);
+static PyMethodDef on_batch_window_def;
+static PyObject* on_batch_executed(PyObject *batch, PyObject *task);
+static PyMethodDef on_batch_executed_def;
+static PyObject* on_batch_fetched(PyObject *batch, PyObject *task);
+static PyMethodDef on_batch_fetched_def;
+// end static declarations
+
+
+/*
+    The future of a cancelled caller is already done, it's skipped
+*/
+static void resolve_future(PyObject *future, const char *method, PyObject *value)
+{
+    PyObject *done = PyObject_CallMethod(future, "done", NULL);
+    if (done == NULL) {
+        PyErr_Clear();
+        return;
+    }
+
+    if (done == Py_False) {
+        PyObject *result = value != NULL
+            ? PyObject_CallMethod(future, method, "O", value)
+            : PyObject_CallMethod(future, method, NULL);
+        if (result == NULL) {
+            PyErr_Clear();  // e.g. the loop is already closed
+        }
+        Py_XDECREF(result);
+    }
+    Py_DECREF(done);
+}
+
+
+/*
+    Each future takes its own instance of the error, which is caused by the original one
+*/
+static void set_error_copy(PyObject *future, PyObject *error)
+{
+    PyObject *copy = NULL;
+    PyObject *args = PyObject_GetAttrString(error, "args");
+    if (args != NULL && PyTuple_Check(args)) {
+        copy = PyObject_CallObject((PyObject *)Py_TYPE(error), args);
+    }
+    Py_XDECREF(args);
+
+    if (copy == NULL || !PyExceptionInstance_Check(copy)) {
+        // e.g. the constructor of the error takes other arguments
+        PyErr_Clear();
+        Py_XDECREF(copy);
+        copy = PyObject_CallFunction(PyExc_Exception, "O", error);
+        if (copy == NULL) {
+            PyErr_Clear();
+            resolve_future(future, "set_exception", error);
+            return;
+        }
+    }
+
+    Py_INCREF(error);
+    PyException_SetCause(copy, error);
+
+    resolve_future(future, "set_exception", copy);
+    Py_DECREF(copy);
+}
+
+
+/*
+    The raised error is set to the futures of all queries of the batch
+*/
+static void fail_batch(PyObject *futures)
+{
+    PyObject *type, *value, *traceback;
+    PyErr_Fetch(&type, &value, &traceback);
+    PyErr_NormalizeException(&type, &value, &traceback);
+    if (value == NULL) {
+        return;
+    }
+
+    if (traceback != NULL) {
+        PyException_SetTraceback(value, traceback);
+    }
+
+    for (Py_ssize_t i = 0; i < PyList_GET_SIZE(futures); i++) {
+        set_error_copy(PyList_GET_ITEM(futures, i), value);
+    }
+
+    Py_XDECREF(type);
+    Py_DECREF(value);
+    Py_XDECREF(traceback);
+}
+
+
+static void close_batch_cursor(PyObject *cursor)
+{
+    PyObject *type, *value, *traceback;
+    PyErr_Fetch(&type, &value, &traceback);
+
+    PyObject *result = PyObject_CallMethod(cursor, "close", NULL);
+    if (result == NULL) {
+        PyErr_Clear();
+    }
+    Py_XDECREF(result);
+
+    PyErr_Restore(type, value, traceback);
+}
+
+
+/*
+    The awaitable of the cursor is driven by a task, its callback takes the batch (cursor, futures)
+*/
+static int run_in_task(PyObject *awaitable, PyObject *batch, PyMethodDef *callback_def)
+{
+    PyObject *asyncio = PyImport_ImportModule("asyncio");
+    if (asyncio == NULL) {
+        return -1;
+    }
+
+    PyObject *task = PyObject_CallMethod(asyncio, "ensure_future", "O", awaitable);
+    Py_DECREF(asyncio);
+    if (task == NULL) {
+        return -1;
+    }
+
+    PyObject *callback = PyCFunction_New(callback_def, batch);
+    if (callback == NULL) {
+        Py_DECREF(task);
+        return -1;
+    }
+
+    PyObject *result = PyObject_CallMethod(task, "add_done_callback", "O", callback);
+    Py_DECREF(callback);
+    Py_DECREF(task);
+    if (result == NULL) {
+        return -1;
+    }
+    Py_DECREF(result);
+
+    return 0;
+}
+
+
+static PyObject* on_batch_executed(PyObject *batch, PyObject *task)
+{
+    PRINT_DEBUG_MESSAGE(__FUNCTION__);
+
+    PyObject *cursor = PyTuple_GET_ITEM(batch, 0);
+    PyObject *futures = PyTuple_GET_ITEM(batch, 1);
+
+    // it raises the error of the execution or CancelledError
+    PyObject *result = PyObject_CallMethod(task, "result", NULL);
+    if (result == NULL) {
+        goto clean_up;
+    }
+    Py_DECREF(result);
+
+    PyObject *awaitable = PyObject_CallMethod(cursor, "fetch_all_sets", NULL);
+    if (awaitable == NULL) {
+        goto clean_up;
+    }
+
+    int code = run_in_task(awaitable, batch, &on_batch_fetched_def);
+    Py_DECREF(awaitable);
+    if (code == -1) {
+        goto clean_up;
+    }
+
+    Py_RETURN_NONE;
+
+    clean_up:
+        fail_batch(futures);
+        close_batch_cursor(cursor);
+        Py_RETURN_NONE;
+}
+
+
+static PyMethodDef on_batch_executed_def = {
+    "_on_batch_executed", (PyCFunction)on_batch_executed, METH_O, "Fetch the result sets of the batch"
+};
+
+
+/*
+    The result sets are given to the queries in their order, the error of a statement is given only to its query.
+    The sets, which are ended by the error of the batch (e.g. the lost connection), give it to the rest of the queries
+*/
+static PyObject* on_batch_fetched(PyObject *batch, PyObject *task)
+{
+    PRINT_DEBUG_MESSAGE(__FUNCTION__);
+
+    PyObject *cursor = PyTuple_GET_ITEM(batch, 0);
+    PyObject *futures = PyTuple_GET_ITEM(batch, 1);
+    Py_ssize_t count = PyList_GET_SIZE(futures);
+
+    PyObject *sets = PyObject_CallMethod(task, "result", NULL);
+    if (sets == NULL) {
+        goto clean_up;
+    }
+
+    Py_ssize_t length = PyList_Check(sets) ? PyList_GET_SIZE(sets) : 0;
+    int is_ended = length > 0 && length < count && PyExceptionInstance_Check(PyList_GET_ITEM(sets, length - 1));
+
+    if (!PyList_Check(sets) || (length != count && !is_ended)) {
+        PyErr_Format(
+            PyExc_Exception,
+            "(%s) The batch of %zd queries returned %zd results, each query must return one result",
+            __FUNCTION__, count, length
+        );
+        Py_DECREF(sets);
+        goto clean_up;
+    }
+
+    for (Py_ssize_t i = 0; i < count; i++) {
+        PyObject *future = PyList_GET_ITEM(futures, i);
+
+        if (i >= length) {
+            set_error_copy(future, PyList_GET_ITEM(sets, length - 1));
+        } else if (PyExceptionInstance_Check(PyList_GET_ITEM(sets, i))) {
+            resolve_future(future, "set_exception", PyList_GET_ITEM(sets, i));
+        } else {
+            resolve_future(future, "set_result", PyList_GET_ITEM(sets, i));
+        }
+    }
+    Py_DECREF(sets);
+
+    close_batch_cursor(cursor);
+    Py_RETURN_NONE;
+
+    clean_up:
+        fail_batch(futures);
+        close_batch_cursor(cursor);
+        Py_RETURN_NONE;
+}
+
+
+static PyMethodDef on_batch_fetched_def = {
+    "_on_batch_fetched", (PyCFunction)on_batch_fetched, METH_O, "Give the result sets to the queries"
+};
+
+
+/*
+    Joins the queries waiting for the flush and starts their execution by one SQLExecDirectW.
+    The markers of the parameters are positional, so the parameters are joined in the same order.
+    The errors are given to the futures of the queries
+*/
+void flush_batch(Connection *self)
+{
+    PRINT_DEBUG_MESSAGE(__FUNCTION__);
+
+    statement_batching *batching = &self->batching;
+    PyObject *requests = batching->requests;
+    PyObject *futures = NULL;
+    PyObject *queries = NULL;
+    PyObject *params = NULL;
+    PyObject *params_tuple = NULL;
+    PyObject *query = NULL;
+    PyObject *cursor = NULL;
+    PyObject *awaitable = NULL;
+    PyObject *batch = NULL;
+
+    batching->requests = NULL;
+    batching->parameter_count = 0;
+
+    if (batching->timer != NULL) {
+        // the batch is full before its window
+        PyObject *result = PyObject_CallMethod(batching->timer, "cancel", NULL);
+        if (result == NULL) {
+            PyErr_Clear();
+        }
+        Py_XDECREF(result);
+        Py_CLEAR(batching->timer);
+    }
+
+    if (requests == NULL) {
+        return;
+    }
+
+    Py_ssize_t count = PyList_GET_SIZE(requests);
+
+    futures = PyList_New(count);
+    if (futures == NULL) {
+        PyErr_Clear();
+        Py_DECREF(requests);
+        return;
+    }
+
+    for (Py_ssize_t i = 0; i < count; i++) {
+        PyObject *future = PyTuple_GET_ITEM(PyList_GET_ITEM(requests, i), 2);
+        Py_INCREF(future);
+        PyList_SET_ITEM(futures, i, future);
+    }
+
+    queries = PyList_New(count);
+    params = PyList_New(0);
+    if (queries == NULL || params == NULL) {
+        goto clean_up;
+    }
+
+    for (Py_ssize_t i = 0; i < count; i++) {
+        PyObject *request = PyList_GET_ITEM(requests, i);
+        PyObject *request_query = PyTuple_GET_ITEM(request, 0);
+        PyObject *request_params = PyTuple_GET_ITEM(request, 1);
+
+        Py_INCREF(request_query);
+        PyList_SET_ITEM(queries, i, request_query);
+
+        if (request_params == Py_None) {
+            continue;
+        }
+
+        if (PyList_SetSlice(params, PY_SSIZE_T_MAX, PY_SSIZE_T_MAX, request_params) == -1) {
+            goto clean_up;
+        }
+    }
+
+    if (count == 1) {
+        query = PyList_GET_ITEM(queries, 0);
+        Py_INCREF(query);
+    } else {
+        PyObject *separator = PyUnicode_FromString(";\n");
+        if (separator == NULL) {
+            goto clean_up;
+        }
+        query = PyUnicode_Join(separator, queries);
+        Py_DECREF(separator);
+        if (query == NULL) {
+            goto clean_up;
+        }
+    }
+
+    params_tuple = PyList_AsTuple(params);
+    if (params_tuple == NULL) {
+        goto clean_up;
+    }
+
+    cursor = PyObject_CallMethod((PyObject *)self, "cursor", NULL);
+    if (cursor == NULL) {
+        goto clean_up;
+    }
+
+    batch = PyTuple_Pack(2, cursor, futures);
+    if (batch == NULL) {
+        goto clean_up;
+    }
+
+    // the error of a statement is given to its query, fetch_all_sets reads the next statements
+    if (PyObject_TypeCheck(cursor, get_object_state((PyObject *)self)->cursor_type)) {
+        ((Cursor *)cursor)->batch_size = count;
+    }
+
+    awaitable = PyObject_CallMethod(
+        cursor, "execute", "OOd", query, PyTuple_GET_SIZE(params_tuple) ? params_tuple : Py_None, batching->timeout
+    );
+    if (awaitable == NULL || run_in_task(awaitable, batch, &on_batch_executed_def) == -1) {
+        goto clean_up;
+    }
+
+    Py_DECREF(awaitable);
+    Py_DECREF(batch);
+    Py_DECREF(cursor);
+    Py_DECREF(query);
+    Py_DECREF(params_tuple);
+    Py_DECREF(params);
+    Py_DECREF(queries);
+    Py_DECREF(futures);
+    Py_DECREF(requests);
+    return;
+
+    clean_up:
+        fail_batch(futures);
+        if (cursor != NULL) {
+            close_batch_cursor(cursor);
+        }
+        Py_XDECREF(awaitable);
+        Py_XDECREF(batch);
+        Py_XDECREF(cursor);
+        Py_XDECREF(query);
+        Py_XDECREF(params_tuple);
+        Py_XDECREF(params);
+        Py_XDECREF(queries);
+        Py_DECREF(futures);
+        Py_DECREF(requests);
+}
+
+
+static PyObject* on_batch_window(PyObject *conn, PyObject *unused)
+{
+    PRINT_DEBUG_MESSAGE(__FUNCTION__);
+
+    Py_BEGIN_CRITICAL_SECTION(conn);
+    flush_batch((Connection *)conn);
+    Py_END_CRITICAL_SECTION();
+
+    Py_RETURN_NONE;
+}
+
+
+static PyMethodDef on_batch_window_def = {
+    "_on_batch_window", (PyCFunction)on_batch_window, METH_NOARGS, "Flush the batch of the queries"
+};
+
+
+/*
+    Returns the future of the query, it's resolved by the rows of its result set.
+    The batch is flushed, when it has max_size queries, after the window or at once without the batching
+*/
+PyObject* add_batch_request(Connection *self, PyObject *query, PyObject *params, double timeout)
+{
+    PRINT_DEBUG_MESSAGE(__FUNCTION__);
+
+    statement_batching *batching = &self->batching;
+    Py_ssize_t params_length = params == Py_None ? 0 : PyTuple_GET_SIZE(params);
+
+    PyObject *asyncio = PyImport_ImportModule("asyncio");
+    if (asyncio == NULL) {
+        return NULL;
+    }
+
+    PyObject *loop = PyObject_CallMethod(asyncio, "get_running_loop", NULL);
+    Py_DECREF(asyncio);
+    if (loop == NULL) {
+        return NULL;
+    }
+
+    PyObject *future = PyObject_CallMethod(loop, "create_future", NULL);
+    if (future == NULL) {
+        Py_DECREF(loop);
+        return NULL;
+    }
+
+    if (batching->requests != NULL && batching->parameter_count + params_length > BATCH_MAX_PARAMETERS) {
+        flush_batch(self);  // the parameters of the query don't fit into the batch
+    }
+
+    if (batching->requests == NULL) {
+        batching->requests = PyList_New(0);
+        if (batching->requests == NULL) {
+            goto clean_up;
+        }
+        batching->timeout = timeout;
+    } else if (timeout == 0 || batching->timeout == 0) {
+        batching->timeout = 0;
+    } else if (timeout > batching->timeout) {
+        batching->timeout = timeout;
+    }
+
+    PyObject *request = PyTuple_Pack(3, query, params, future);
+    if (request == NULL) {
+        goto clean_up;
+    }
+
+    int code = PyList_Append(batching->requests, request);
+    Py_DECREF(request);
+    if (code == -1) {
+        goto clean_up;
+    }
+    batching->parameter_count += params_length;
+
+    if (PyList_GET_SIZE(batching->requests) >= batching->max_size) {
+        flush_batch(self);
+    } else if (batching->timer == NULL) {
+        PyObject *callback = PyCFunction_New(&on_batch_window_def, (PyObject *)self);
+        if (callback == NULL) {
+            goto clean_up;
+        }
+
+        batching->timer = batching->window > 0
+            ? PyObject_CallMethod(loop, "call_later", "dO", batching->window, callback)
+            : PyObject_CallMethod(loop, "call_soon", "O", callback);
+        Py_DECREF(callback);
+        if (batching->timer == NULL) {
+            // the added query isn't left without the flush
+            PyObject *type, *value, *traceback;
+            PyErr_Fetch(&type, &value, &traceback);
+            flush_batch(self);
+            PyErr_Restore(type, value, traceback);
+            goto clean_up;
+        }
+    }
+
+    Py_DECREF(loop);
+    return future;
+
+    clean_up:
+        Py_DECREF(loop);
+        Py_DECREF(future);
+        return NULL;
+}
@@ -0,0 +1,14 @@
+#ifndef _BATCHING_H_
+#define _BATCHING_H_
+
+
+#include "aodbc_types.h"
+
+
+extern module_state* get_object_state(PyObject *self);
+
+PyObject* add_batch_request(Connection *self, PyObject *query, PyObject *params, double timeout);
+void flush_batch(Connection *self);
+
+
+#endif
@@ -4,12 +4,15 @@
 
 // start static declarations
 static PyObject* Connection_Iter(Connection *self);
-static PyObject* Connection_Next(Connection *self);
+static PyObject* Connection_Next_locked(Connection *self);
 static void Connection_Dealloc(Connection *self);
-static PyAsyncMethods Connection_Awaitable;
-static PyObject* Connection_Cursor(Connection *self);
-static PyObject* Connection_Close(Connection *self);
-static PyObject* Connection_Aexit(Connection *self, PyObject* args);
+static PyObject* Connection_Cursor_locked(Connection *self);
+static PyObject* Connection_Close_locked(Connection *self);
+static PyObject* Connection_Aexit_locked(Connection *self, PyObject* args);
+static PyObject* Connection_ConfigureStatementCache_locked(Connection *self, PyObject *args, PyObject *kwargs);
+static PyObject* Connection_StatementCacheStats_locked(Connection *self);
+static PyObject* Connection_ConfigureBatching_locked(Connection *self, PyObject *args, PyObject *kwargs);
+static PyObject* Connection_Fetchall_locked(Connection *self, PyObject *args, PyObject *kwargs);
 // end static declarations
 
 
@@ -26,7 +29,6 @@ void* t_sql_driver_connect_w(void *handle)
 
     char16_t *dsn = wctouc(conn->dsn);
     if (dsn == NULL) {
-        PyErr_NoMemory();
         conn->retcode = -1;
         goto clean_up;
     }
@@ -44,8 +46,8 @@ void* t_sql_driver_connect_w(void *handle)
     free(dsn);
 
     clean_up:
-        event->state = WAIT_OBJECT_0;
-        pthread_exit(0);
+        set_t_event(event);
+        return NULL;
 }
 
 
@@ -58,43 +60,124 @@ void* t_sql_disconnect(void *handle)
     Connection *conn = event->obj;
     conn->retcode = SQLDisconnect(conn->handle);
 
-    event->state = WAIT_OBJECT_0;
-    pthread_exit(0);
+    set_t_event(event);
+    return NULL;
 }
 #endif
 
 
-int connect_async(Connection *self, const wchar_t *dsn, long long timeout)
+static void on_connection_deadline(void *arg)
+{
+    Connection *conn = (Connection *)arg;
+    SQLCancelHandle(SQL_HANDLE_DBC, conn->handle);
+}
+
+
+#ifdef __linux__
+/*
+    The task awaiting the connection is cancelled, only the connecting can be interrupted
+*/
+void cancel_connection(Connection *self, PyObject *future)
+{
+    PRINT_DEBUG_MESSAGE(__FUNCTION__);
+
+    if (self->state == TO_CONNECT && self->event != NULL && self->event->future == future) {
+        SQLCancelHandle(SQL_HANDLE_DBC, self->handle);
+    }
+}
+#endif
+
+
+/*
+    The deadline is checked by the timer wheel on Linux and by the awaitable on Windows
+*/
+int start_deadline(Connection *conn, timer_entry *entry, double timeout)
+{
+    PRINT_DEBUG_MESSAGE(__FUNCTION__);
+
+    long long deadline = monotonic_ms() + (long long)(timeout * 1000 + 0.5);
+
+    #ifdef _WIN32
+    entry->deadline = deadline;
+    entry->is_fired = 0;
+
+    #elif __linux__
+    if (timer_wheel_add(conn->wheel, entry, deadline) == -1) {
+        PyErr_Format(PyExc_Exception, "(%s) Failed to start the timer thread", __FUNCTION__);
+        return -1;
+    }
+    #endif
+
+    return 0;
+}
+
+
+void stop_deadline(Connection *conn, timer_entry *entry)
 {
     PRINT_DEBUG_MESSAGE(__FUNCTION__);
 
-    self->env = SQL_NULL_HENV;
+    if (!entry->deadline) {
+        return;
+    }
+
+    #ifdef __linux__
+    timer_wheel_remove(conn->wheel, entry);
+    #endif
+
+    entry->deadline = 0;
+}
+
+
+/*
+    The environment is shared by the connections of the module, so the connection doesn't free it
+*/
+int connect_async(
+    Connection *self, SQLHENV env, void *pool, void *wheel, void *statements_poller, const wchar_t *dsn, double timeout
+)
+{
+    PRINT_DEBUG_MESSAGE(__FUNCTION__);
+
+    self->env = env;
     self->handle = SQL_NULL_HDBC;
     self->handle_type = SQL_HANDLE_DBC;
     self->retcode = -1;
     self->event = NULL;
     self->event_status = 258;
+    #ifdef __linux__
+    self->pool = (thread_pool *)pool;
+    self->wheel = (timer_wheel *)wheel;
+    self->poller = (poller *)statements_poller;
+    #endif
     self->mca = 1;
     self->runned_cursors = 0;
+    self->queue_head = NULL;
+    self->queue_tail = NULL;
+    self->free_stmt_count = 0;
+    self->free_cursor_count = 0;
+    memset(&self->cache, 0, sizeof(statement_cache));
+    memset(&self->batching, 0, sizeof(statement_batching));
+    self->parsed_queries = NULL;
     self->dsn = dsn;
     self->timeout = timeout;
-    self->start_time = 0;
+    timer_entry_init(&self->timer, on_connection_deadline, self);
+    self->created_at = monotonic_ms();
     self->rate = 1.0;
     self->state = DISCONNECTED;
     self->is_exc = 0;
 
-    self->retcode = SQLAllocHandle(SQL_HANDLE_ENV, SQL_NULL_HANDLE, &self->env);
-    CHECK_ERROR("connect_async::SQLAllocHandle::SQL_HANDLE_ENV");
-
-    self->retcode = SQLSetEnvAttr(self->env, SQL_ATTR_ODBC_VERSION, (SQLPOINTER)SQL_OV_ODBC3_80, SQL_IS_INTEGER);
-    CHECK_ERROR("connect_async::SQLSetEnvAttr::SQL_ATTR_ODBC_VERSION");
-
     self->retcode = SQLAllocHandle(SQL_HANDLE_DBC, self->env, &self->handle);
     CHECK_ERROR("connect_async::SQLAllocHandle::SQL_HANDLE_DBC");
 
-    self->retcode = SQLSetConnectAttr(self->handle, SQL_LOGIN_TIMEOUT, (SQLPOINTER)self->timeout, SQL_IS_INTEGER);
+    // the driver takes whole seconds, the deadline is exact
+    self->retcode = SQLSetConnectAttr(
+        self->handle, SQL_LOGIN_TIMEOUT, (SQLPOINTER)(SQLULEN)ceil(self->timeout), SQL_IS_INTEGER
+    );
     CHECK_ERROR("connect_async::SQLSetConnectAttr::SQL_LOGIN_TIMEOUT");
 
+    if (self->timeout && start_deadline(self, &self->timer, self->timeout) == -1) {
+        return -1;
+    }
+
     #ifdef _WIN32
     SQLWCHAR out_conn_str[1024];
     SQLSMALLINT out_conn_str_len;
@@ -131,8 +214,12 @@ int connect_async(Connection *self, const wchar_t *dsn, long long timeout)
 
     self->event->obj = self;
 
-    pthread_create(&self->event->thread, NULL, t_sql_driver_connect_w, self->event);
-    pthread_detach(self->event->thread);
+    if (thread_pool_submit(self->pool, t_sql_driver_connect_w, self->event) == -1) {
+        stop_deadline(self, &self->timer);
+        close_event(&self->event, &self->event_status);
+        PyErr_Format(PyExc_Exception, "(%s) The worker pool can't accept the task", __FUNCTION__);
+        return -1;
+    }
     #endif
 
     return 0;
@@ -148,6 +235,10 @@ static PyObject* Connection_Iter(Connection *self)
 }
 
 
+/*
+    0 means that the driver doesn't limit the active statements.
+    SQL Server reports 1 even with MARS, so the attribute of its driver is checked, the others refuse it
+*/
 SQLUSMALLINT get_max_concurrent_activities(SQLHDBC handle)
 {
     PRINT_DEBUG_MESSAGE(__FUNCTION__);
@@ -160,10 +251,34 @@ SQLUSMALLINT get_max_concurrent_activities(SQLHDBC handle)
         mca = 1;
     }
 
+    if (mca == 1) {
+        SQLUINTEGER mars = SQL_MARS_ENABLED_NO;
+        retcode = SQLGetConnectAttr(handle, SQL_COPT_SS_MARS_ENABLED, &mars, SQL_IS_UINTEGER, NULL);
+        if (SQL_SUCCEEDED(retcode) && mars == SQL_MARS_ENABLED_YES) {
+            mca = 0;
+        }
+    }
+
     return mca;
 }
 
 
+SQLUINTEGER get_async_mode(SQLHDBC handle)
+{
+    PRINT_DEBUG_MESSAGE(__FUNCTION__);
+
+    SQLRETURN retcode;
+    SQLUINTEGER async_mode;
+    retcode = SQLGetInfo(handle, SQL_ASYNC_MODE, &async_mode, sizeof(async_mode), NULL);
+
+    if (!SQL_SUCCEEDED(retcode)) {
+        async_mode = SQL_AM_NONE;
+    }
+
+    return async_mode;
+}
+
+
 static PyObject* Connection_Next(Connection *self)
 {
     PRINT_DEBUG_MESSAGE(__FUNCTION__);
@@ -180,24 +295,26 @@ static PyObject* Connection_Next(Connection *self)
 
     if (self->state == TO_CONNECT || self->state == TO_DISCONNECT) {
         if (self->event_status != WAIT_OBJECT_0) {
-            if (
-                self->start_time && \
-                clock() / CLOCKS_PER_SEC - self->start_time >= self->timeout + (long long)(1 / self->rate)
-            ) {
-                self->event_status = WAIT_OBJECT_0;
+            #ifdef _WIN32
+            check_timer_entry(&self->timer);
 
-                PyErr_Format(PyExc_SystemError, "(%s) An event error", __FUNCTION__);
-                return NULL;
+            self->event_status = WaitForSingleObject(self->event, (DWORD)(50 * self->rate));
+            if (self->event_status != WAIT_OBJECT_0) {
+                Py_RETURN_NONE;
             }
 
-            #ifdef _WIN32
-            self->event_status = WaitForSingleObject(self->event, (DWORD)(50 * self->rate));
-            
             #elif __linux__
-            self->event_status = wait_for_single_object(self->event, (unsigned long)(50 * self->rate));
+            PyObject *waiter = NULL;
+            switch (await_event(self->event, self->rate, &waiter)) {
+                case EVENT_READY:
+                    self->event_status = WAIT_OBJECT_0;
+                    break;
+                case EVENT_WAIT:
+                    return waiter;
+                default:
+                    return NULL;
+            }
             #endif
-
-            Py_RETURN_NONE;
         }
 
         #ifdef _WIN32
@@ -208,12 +325,24 @@ static PyObject* Connection_Next(Connection *self)
         close_event(&self->event, &self->event_status);
         PRINT_DEBUG_MESSAGE("Connection_Next::CloseHandle");
 
+        stop_deadline(self, &self->timer);
+        if (self->timer.is_fired && !SQL_SUCCEEDED(self->retcode)) {
+            self->timer.is_fired = 0;
+            PyErr_Format(PyExc_TimeoutError, "(%s) The connection timeout expired", __FUNCTION__);
+            return NULL;
+        }
+
         if (check_error((PyObject *)self, "Connection_Next::SQLCompleteAsync")) {
             return NULL;
         }
 
         if (self->state == TO_CONNECT) {
             self->mca = get_max_concurrent_activities(self->handle);
+            #ifdef __linux__
+            if (self->poller != NULL && get_async_mode(self->handle) == SQL_AM_NONE) {
+                self->poller = NULL;  // the driver doesn't support the polling, the worker pool is used
+            }
+            #endif
             self->state = CONNECTED;
             PY_MEM_FREE_TO_NULL(self->dsn);
             PRINT_DEBUG_MESSAGE("The connection is established");
@@ -225,18 +354,14 @@ static PyObject* Connection_Next(Connection *self)
                 return NULL;
             }
 
-            self->retcode = SQLFreeHandle(SQL_HANDLE_ENV, self->env);
-            if (check_error((PyObject *)self, "Connection_Next::SQLFreeHandle::SQL_HANDLE_ENV")) {
-                return NULL;
-            }
-
             self->env = SQL_NULL_HENV;
             self->handle = SQL_NULL_HDBC;
             self->retcode = -1;
             self->mca = 1;
             self->runned_cursors = 0;
+            self->queue_head = NULL;
+            self->queue_tail = NULL;
             self->timeout = 0;
-            self->start_time = 0;
             self->rate = 1.0;
             self->state = DISCONNECTED;
 
@@ -258,27 +383,222 @@ static PyObject* Connection_Next(Connection *self)
 }
 
 
+static void free_statements(Connection *self)
+{
+    while (self->free_stmt_count) {
+        SQLFreeHandle(SQL_HANDLE_STMT, self->free_stmts[--self->free_stmt_count]);
+    }
+}
+
+
+static size_t hash_query(const wchar_t *query)
+{
+    size_t hash = 2166136261u;  // FNV-1a
+    for (; *query; query++) {
+        hash = (hash ^ (size_t)*query) * 16777619u;
+    }
+    return hash;
+}
+
+
+static void unlink_statement(statement_cache *cache, prepared_statement *entry)
+{
+    if (entry->prev != NULL) {
+        entry->prev->next = entry->next;
+    } else {
+        cache->head = entry->next;
+    }
+
+    if (entry->next != NULL) {
+        entry->next->prev = entry->prev;
+    } else {
+        cache->tail = entry->prev;
+    }
+
+    cache->count--;
+}
+
+
+static void free_prepared_statement(prepared_statement *entry)
+{
+    SQLFreeHandle(SQL_HANDLE_STMT, entry->handle);
+    PyMem_Free((void *)entry->query);
+    PyMem_Free(entry);
+}
+
+
+/*
+    The least recently used statements are freed, until the cache fits its size
+*/
+static void evict_statements(Connection *self)
+{
+    statement_cache *cache = &self->cache;
+
+    while (cache->count > cache->max_size) {
+        prepared_statement *entry = cache->tail;
+        unlink_statement(cache, entry);
+        free_prepared_statement(entry);
+        cache->evictions++;
+    }
+}
+
+
+static void free_statement_cache(Connection *self)
+{
+    statement_cache *cache = &self->cache;
+
+    while (cache->head != NULL) {
+        prepared_statement *entry = cache->head;
+        unlink_statement(cache, entry);
+        free_prepared_statement(entry);
+    }
+}
+
+
+/*
+    A new cursor takes a reset handle of a closed one or allocates a new handle
+*/
+SQLRETURN take_statement(Connection *conn, SQLHSTMT *handle)
+{
+    if (conn->free_stmt_count) {
+        *handle = conn->free_stmts[--conn->free_stmt_count];
+        return SQL_SUCCESS;
+    }
+
+    return SQLAllocHandle(SQL_HANDLE_STMT, conn->handle, handle);
+}
+
+
+/*
+    Returns the handle prepared for the query and removes it from the cache, or SQL_NULL_HSTMT.
+    The caller takes the key of the entry
+*/
+SQLHSTMT take_prepared_statement(Connection *conn, const wchar_t *query, const wchar_t **key)
+{
+    statement_cache *cache = &conn->cache;
+    size_t hash = hash_query(query);
+
+    for (prepared_statement *entry = cache->head; entry != NULL; entry = entry->next) {
+        if (entry->hash == hash && wcscmp(entry->query, query) == 0) {
+            SQLHSTMT handle = entry->handle;
+            *key = entry->query;
+            unlink_statement(cache, entry);
+            PyMem_Free(entry);
+            cache->hits++;
+            return handle;
+        }
+    }
+
+    cache->misses++;
+    return SQL_NULL_HSTMT;
+}
+
+
+/*
+    The handle is reset to the state of a new one and kept for the next cursor.
+    The handle prepared for the query is kept by the cache, the connection takes the query
+*/
+SQLRETURN keep_statement(Connection *conn, SQLHSTMT handle, const wchar_t *query)
+{
+    if (!SQL_SUCCEEDED(SQLFreeStmt(handle, SQL_CLOSE))
+        || !SQL_SUCCEEDED(SQLFreeStmt(handle, SQL_UNBIND))
+        || !SQL_SUCCEEDED(SQLFreeStmt(handle, SQL_RESET_PARAMS))
+        #ifdef _WIN32
+        || !SQL_SUCCEEDED(SQLSetStmtAttr(
+            handle, SQL_ATTR_ASYNC_ENABLE, (SQLPOINTER)SQL_ASYNC_ENABLE_OFF, SQL_IS_INTEGER
+        ))
+        #endif
+    ) {
+        PyMem_Free((void *)query);
+        return SQLFreeHandle(SQL_HANDLE_STMT, handle);
+    }
+
+    if (query != NULL && conn->cache.max_size) {
+        prepared_statement *entry = PyMem_Malloc(sizeof(prepared_statement));
+        if (entry != NULL) {
+            statement_cache *cache = &conn->cache;
+
+            entry->query = query;
+            entry->hash = hash_query(query);
+            entry->handle = handle;
+            entry->prev = NULL;
+            entry->next = cache->head;
+            if (cache->head != NULL) {
+                cache->head->prev = entry;
+            } else {
+                cache->tail = entry;
+            }
+            cache->head = entry;
+            cache->count++;
+
+            evict_statements(conn);
+            return SQL_SUCCESS;
+        }
+    }
+    PyMem_Free((void *)query);
+
+    // the prepared statement is replaced by the next SQLExecDirectW or SQLPrepareW
+    if (conn->free_stmt_count < FREE_LIST_SIZE) {
+        conn->free_stmts[conn->free_stmt_count++] = handle;
+        return SQL_SUCCESS;
+    }
+
+    return SQLFreeHandle(SQL_HANDLE_STMT, handle);
+}
+
+
 static void Connection_Dealloc(Connection *self)
 {
     PRINT_DEBUG_MESSAGE(__FUNCTION__);
 
+    stop_deadline(self, &self->timer);
+
+    // the awaitable was abandoned, the worker still uses the handle, a finished operation has closed its event
+    if ((self->state == TO_CONNECT || self->state == TO_DISCONNECT) && self->event != NULL
+        && self->event_status != WAIT_OBJECT_0) {
+        Py_BEGIN_ALLOW_THREADS
+        #ifdef _WIN32
+        WaitForSingleObject(self->event, INFINITE);
+        SQLCompleteAsync(self->handle_type, self->handle, &self->retcode);
+        #elif __linux__
+        wait_for_single_object(self->event, -1);
+        #endif
+        Py_END_ALLOW_THREADS
+
+        if (self->state == TO_CONNECT && SQL_SUCCEEDED(self->retcode)) {
+            SQLDisconnect(self->handle);
+        }
+    }
+
+    free_statement_cache(self);
+    free_statements(self);
+    Py_CLEAR(self->batching.requests);
+    Py_CLEAR(self->batching.timer);
+    Py_CLEAR(self->parsed_queries);
     if (self->handle) {
         SQLFreeHandle(SQL_HANDLE_DBC, self->handle);
     }
 
-    if (self->env) {
-        SQLFreeHandle(SQL_HANDLE_ENV, self->env);
+    // the kept cursors are already deallocated, only their memory is left
+    while (self->free_cursor_count) {
+        PyObject_Free(self->free_cursors[--self->free_cursor_count]);
     }
 
     close_event(&self->event, &self->event_status);
     PY_MEM_FREE_TO_NULL(self->dsn);
-    PyObject_Del(self);
-}
 
+    // the acquired connection isn't released, its place in the pool is freed
+    if (self->owner != NULL) {
+        forget_connection(self->owner);
+        Py_DECREF(self->owner);
+    }
 
-static PyAsyncMethods Connection_Awaitable = {
-    .am_await = (unaryfunc)Connection_Iter
-};
+    Py_XDECREF(self->module);
+
+    PyTypeObject *type = Py_TYPE(self);
+    type->tp_free((PyObject *)self);
+    Py_DECREF(type);  // the instances of a heap type keep it
+}
 
 
 int disconnect_async(Connection *self)
@@ -291,6 +611,11 @@ int disconnect_async(Connection *self)
     }
 
     if (self->state == CONNECTED) {
+        // the queued statements won't get a slot
+        fail_queued_cursors(self);
+        free_statement_cache(self);
+        free_statements(self);
+
         #ifdef _WIN32
         self->event = CreateEvent(NULL, FALSE, FALSE, NULL);
         self->event_status = 258;
@@ -308,14 +633,15 @@ int disconnect_async(Connection *self)
         CHECK_EVENT_ERROR(self->event, "disconnect_async::create_t_event");
 
         self->event->obj = self;
-        pthread_create(&self->event->thread, NULL, t_sql_disconnect, self->event);
-        pthread_detach(self->event->thread);
+        if (thread_pool_submit(self->pool, t_sql_disconnect, self->event) == -1) {
+            close_event(&self->event, &self->event_status);
+            PyErr_Format(PyExc_Exception, "(%s) The worker pool can't accept the task", __FUNCTION__);
+            return -1;
+        }
         #endif
 
+        // SQLDisconnect can't be canceled, so it's without a deadline
         self->state = TO_DISCONNECT;
-        if (self->timeout) {
-            self->start_time = clock() / CLOCKS_PER_SEC;
-        }
         return 0;
     }
 
@@ -332,11 +658,22 @@ static PyObject* Connection_Cursor(Connection *self)
         return NULL;
     }
 
-    Cursor *cursor = PyObject_New(Cursor, &Cursor_Type);
-    if (cursor == NULL) {
-        return NULL;
+    module_state *state = (module_state *)PyModule_GetState(self->module);
+
+    Cursor *cursor;
+    if (self->free_cursor_count) {
+        // the memory of a freed cursor is reused
+        cursor = self->free_cursors[--self->free_cursor_count];
+        PyObject_Init((PyObject *)cursor, state->cursor_type);
+    } else {
+        cursor = PyObject_New(Cursor, state->cursor_type);
+        if (cursor == NULL) {
+            return NULL;
+        }
     }
 
+    // the failed cursor releases the connection on its deallocation
+    Py_INCREF(self);
     if (allocate_cursor(cursor, self) == -1) {
         Py_DECREF(cursor);
         return NULL;
@@ -344,7 +681,6 @@ static PyObject* Connection_Cursor(Connection *self)
 
     cursor->state = OPENED;
 
-    Py_INCREF(self);
     return (PyObject *)cursor;
 }
 
@@ -386,25 +722,242 @@ static PyObject* Connection_Aexit(Connection *self, PyObject* args)
 }
 
 
+static PyObject* Connection_ConfigureStatementCache(Connection *self, PyObject *args, PyObject *kwargs)
+{
+    PRINT_DEBUG_MESSAGE(__FUNCTION__);
+
+    static char *kwlist[] = {"size", NULL};
+    Py_ssize_t size;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "n", kwlist, &size)) {
+        return NULL;
+    }
+
+    if (size < 0) {
+        PyErr_Format(PyExc_Exception, "(%s) The size must be >= 0", __FUNCTION__);
+        return NULL;
+    }
+
+    // the statements of the cursors return to the cache on their closing
+    self->cache.max_size = size;
+    evict_statements(self);
+
+    Py_RETURN_NONE;
+}
+
+
+static PyObject* Connection_StatementCacheStats(Connection *self)
+{
+    PRINT_DEBUG_MESSAGE(__FUNCTION__);
+
+    return Py_BuildValue(
+        "{s:n,s:n,s:K,s:K,s:K}",
+        "size", self->cache.count,
+        "max_size", self->cache.max_size,
+        "hits", self->cache.hits,
+        "misses", self->cache.misses,
+        "evictions", self->cache.evictions
+    );
+}
+
+
+static PyObject* Connection_ConfigureBatching(Connection *self, PyObject *args, PyObject *kwargs)
+{
+    PRINT_DEBUG_MESSAGE(__FUNCTION__);
+
+    static char *kwlist[] = {"max_size", "window", NULL};
+    Py_ssize_t max_size;
+    double window = 0;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "n|d", kwlist, &max_size, &window)) {
+        return NULL;
+    }
+
+    if (max_size < 0 || window < 0) {
+        PyErr_Format(PyExc_Exception, "(%s) The max_size and the window must be >= 0", __FUNCTION__);
+        return NULL;
+    }
+
+    self->batching.max_size = max_size;
+    self->batching.window = window;
+
+    // the waiting queries aren't left for the old window
+    flush_batch(self);
+
+    Py_RETURN_NONE;
+}
+
+
+static PyObject* Connection_Fetchall(Connection *self, PyObject *args, PyObject *kwargs)
+{
+    PRINT_DEBUG_MESSAGE(__FUNCTION__);
+
+    static char *kwlist[] = {"query", "params", "timeout", NULL};
+    PyObject *py_query = NULL;
+    PyObject *params = Py_None;
+    double timeout = 0;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|Od", kwlist, &py_query, &params, &timeout)) {
+        return NULL;
+    }
+
+    if (self->state != CONNECTED) {
+        PyErr_Format(PyExc_Exception, "(%s) The connection isn't established", __FUNCTION__);
+        return NULL;
+    }
+
+    if (!PyUnicode_Check(py_query)) {
+        PyErr_Format(PyExc_AttributeError, "(%s) The query must be an Unicode string", __FUNCTION__);
+        return NULL;
+    }
+
+    if (timeout < 0 || timeout > 2147483647) {
+        PyErr_Format(PyExc_AttributeError, "(%s) The value must be nonnegative and less than 2147483648", __FUNCTION__);
+        return NULL;
+    }
+
+    // a wrong query fails alone, not the batch
+    PyObject *parsed = parse_query(self, py_query);
+    if (parsed == NULL) {
+        return NULL;
+    }
+
+    PyObject *result = NULL;
+    parsed_query *parsed_data = get_parsed_query(parsed);
+    PyObject *ordered = order_parameters(parsed_data, params, __FUNCTION__);
+    if (ordered == NULL) {
+        goto clean_up;
+    }
+
+    // the named markers are joined into the batch as the positional ones
+    if (parsed_data->names != NULL) {
+        PyObject *positional = PyUnicode_FromWideChar(parsed_data->query, parsed_data->length);
+        if (positional != NULL) {
+            result = add_batch_request(self, positional, ordered, timeout);
+            Py_DECREF(positional);
+        }
+    } else {
+        result = add_batch_request(self, py_query, ordered, timeout);
+    }
+    Py_DECREF(ordered);
+
+    clean_up:
+        Py_DECREF(parsed);
+        return result;
+}
+
+
+/*
+    The methods lock the connection, it matters only for the free-threaded build
+*/
+static PyObject* Connection_Next_locked(Connection *self)
+{
+    PyObject *result;
+    Py_BEGIN_CRITICAL_SECTION(self);
+    result = Connection_Next(self);
+    Py_END_CRITICAL_SECTION();
+    return result;
+}
+
+
+static PyObject* Connection_Cursor_locked(Connection *self)
+{
+    PyObject *result;
+    Py_BEGIN_CRITICAL_SECTION(self);
+    result = Connection_Cursor(self);
+    Py_END_CRITICAL_SECTION();
+    return result;
+}
+
+
+static PyObject* Connection_Close_locked(Connection *self)
+{
+    PyObject *result;
+    Py_BEGIN_CRITICAL_SECTION(self);
+    result = Connection_Close(self);
+    Py_END_CRITICAL_SECTION();
+    return result;
+}
+
+
+static PyObject* Connection_Aexit_locked(Connection *self, PyObject* args)
+{
+    PyObject *result;
+    Py_BEGIN_CRITICAL_SECTION(self);
+    result = Connection_Aexit(self, args);
+    Py_END_CRITICAL_SECTION();
+    return result;
+}
+
+
+static PyObject* Connection_ConfigureStatementCache_locked(Connection *self, PyObject *args, PyObject *kwargs)
+{
+    PyObject *result;
+    Py_BEGIN_CRITICAL_SECTION(self);
+    result = Connection_ConfigureStatementCache(self, args, kwargs);
+    Py_END_CRITICAL_SECTION();
+    return result;
+}
+
+
+static PyObject* Connection_StatementCacheStats_locked(Connection *self)
+{
+    PyObject *result;
+    Py_BEGIN_CRITICAL_SECTION(self);
+    result = Connection_StatementCacheStats(self);
+    Py_END_CRITICAL_SECTION();
+    return result;
+}
+
+
+static PyObject* Connection_ConfigureBatching_locked(Connection *self, PyObject *args, PyObject *kwargs)
+{
+    PyObject *result;
+    Py_BEGIN_CRITICAL_SECTION(self);
+    result = Connection_ConfigureBatching(self, args, kwargs);
+    Py_END_CRITICAL_SECTION();
+    return result;
+}
+
+
+static PyObject* Connection_Fetchall_locked(Connection *self, PyObject *args, PyObject *kwargs)
+{
+    PyObject *result;
+    Py_BEGIN_CRITICAL_SECTION(self);
+    result = Connection_Fetchall(self, args, kwargs);
+    Py_END_CRITICAL_SECTION();
+    return result;
+}
+
+
 static PyMethodDef Connection_Methods[] = {
     {"__aenter__", (PyCFunction)Connection_Iter, METH_NOARGS, "Asynchronous connection"},
-    {"__aexit__", (PyCFunction)Connection_Aexit, METH_VARARGS, "Asynchronous disconnection"},
-    {"cursor", (PyCFunction)Connection_Cursor, METH_NOARGS, "Create a cursor"},
-    {"close", (PyCFunction)Connection_Close, METH_NOARGS, "Asynchronous disconnection"},
+    {"__aexit__", (PyCFunction)Connection_Aexit_locked, METH_VARARGS, "Asynchronous disconnection"},
+    {"cursor", (PyCFunction)Connection_Cursor_locked, METH_NOARGS, "Create a cursor"},
+    {"close", (PyCFunction)Connection_Close_locked, METH_NOARGS, "Asynchronous disconnection"},
+    {"configure_statement_cache", (PyCFunction)Connection_ConfigureStatementCache_locked, METH_VARARGS|METH_KEYWORDS, "Set the size of the prepared statement cache"},
+    {"statement_cache_stats", (PyCFunction)Connection_StatementCacheStats_locked, METH_NOARGS, "Counters of the prepared statement cache"},
+    {"configure_batching", (PyCFunction)Connection_ConfigureBatching_locked, METH_VARARGS|METH_KEYWORDS, "Set the batching of the queries of fetchall"},
+    {"fetchall", (PyCFunction)Connection_Fetchall_locked, METH_VARARGS|METH_KEYWORDS, "Asynchronous execution and fetchall in a batch"},
     {NULL, NULL, 0, NULL}
 };
 
 
-PyTypeObject Connection_Type = {
-    PyVarObject_HEAD_INIT(NULL, 0)
-    .tp_name = "pyaodbc.Connection",
-    .tp_doc = PyDoc_STR("Asynchronous Connection Class"),
-    .tp_basicsize = sizeof(Connection),
-    .tp_itemsize = 0,
-    .tp_flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE,
-    .tp_iter = (getiterfunc)Connection_Iter,
-    .tp_iternext = (iternextfunc)Connection_Next,
-    .tp_dealloc = (destructor)Connection_Dealloc,
-    .tp_as_async = &Connection_Awaitable,
-    .tp_methods = Connection_Methods
+static PyType_Slot Connection_Slots[] = {
+    {Py_tp_doc, (void *)PyDoc_STR("Asynchronous Connection Class")},
+    {Py_tp_iter, (void *)Connection_Iter},
+    {Py_tp_iternext, (void *)Connection_Next_locked},
+    {Py_tp_dealloc, (void *)Connection_Dealloc},
+    {Py_am_await, (void *)Connection_Iter},
+    {Py_tp_methods, Connection_Methods},
+    {0, NULL}
+};
+
+
+PyType_Spec Connection_Spec = {
+    .name = "pyaodbc.Connection",
+    .basicsize = sizeof(Connection),
+    .itemsize = 0,
+    .flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE | TPFLAGS_NO_INSTANTIATION,
+    .slots = Connection_Slots
 };
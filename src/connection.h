@@ -5,22 +5,37 @@
 #include "aodbc_types.h"
 
 
-PyTypeObject ConnectionType;
+PyType_Spec Connection_Spec;
 
 #ifdef __linux__
 void* t_sql_driver_connect_w(void *handle);
 void* t_sql_disconnect(void *handle);
-extern short wait_for_single_object(t_event *event, unsigned long milliseconds);
+extern int await_event(HANDLE event, double rate, PyObject **waiter);
 extern char16_t* wctouc(const wchar_t *wc);
+void cancel_connection(Connection *self, PyObject *future);
 #endif
 
-int connect_async(Connection *self, const wchar_t *dsn, long long timeout);
+int start_deadline(Connection *conn, timer_entry *entry, double timeout);
+void stop_deadline(Connection *conn, timer_entry *entry);
+int connect_async(
+    Connection *self, SQLHENV env, void *pool, void *wheel, void *statements_poller, const wchar_t *dsn, double timeout
+);
+SQLUINTEGER get_async_mode(SQLHDBC handle);
 SQLUSMALLINT get_max_concurrent_activities(SQLHDBC handle);
 int disconnect_async(Connection *self);
+SQLRETURN take_statement(Connection *conn, SQLHSTMT *handle);
+SQLHSTMT take_prepared_statement(Connection *conn, const wchar_t *query, const wchar_t **key);
+SQLRETURN keep_statement(Connection *conn, SQLHSTMT handle, const wchar_t *query);
 
 extern int check_error(PyObject *self, const char *fn_name);
-extern PyTypeObject Cursor_Type;
 extern int allocate_cursor(Cursor *self, Connection *conn);
+extern void forget_connection(PyObject *owner);
+extern void fail_queued_cursors(Connection *conn);
+extern PyObject* parse_query(Connection *conn, PyObject *py_query);
+extern parsed_query* get_parsed_query(PyObject *parsed);
+extern PyObject* order_parameters(parsed_query *parsed, PyObject *params, const char *fn_name);
+extern PyObject* add_batch_request(Connection *self, PyObject *query, PyObject *params, double timeout);
+extern void flush_batch(Connection *self);
 
 
 #endif
@@ -0,0 +1,1651 @@
+#include "headers.h"
+#include "connection_pool.h"
+
+
+// start static declarations
+static PyObject* ConnectionPool_Iter(ConnectionPool *self);
+static PyObject* ConnectionPool_Next_locked(ConnectionPool *self);
+static void ConnectionPool_Dealloc(ConnectionPool *self);
+static PyObject* ConnectionPool_Acquire_locked(ConnectionPool *self);
+static PyObject* ConnectionPool_Release_locked(ConnectionPool *self, PyObject *conn);
+static PyObject* ConnectionPool_Execute_locked(ConnectionPool *self, PyObject *args, PyObject *kwargs);
+static PyObject* ConnectionPool_Fetchall_locked(ConnectionPool *self, PyObject *args, PyObject *kwargs);
+static PyObject* ConnectionPool_Stats_locked(ConnectionPool *self);
+static PyObject* ConnectionPool_Close_locked(ConnectionPool *self);
+static PyObject* ConnectionPool_Aexit_locked(ConnectionPool *self, PyObject *args);
+static PyObject* PoolRequest_Iter(PoolRequest *self);
+static PyObject* PoolRequest_Next_locked(PoolRequest *self);
+static void PoolRequest_Dealloc(PoolRequest *self);
+static PyObject* PoolRequest_Aexit_locked(PoolRequest *self, PyObject *args);
+static PyObject* ConnectionGroup_Iter(ConnectionGroup *self);
+static PyObject* ConnectionGroup_Next_locked(ConnectionGroup *self);
+static void ConnectionGroup_Dealloc(ConnectionGroup *self);
+// end static declarations
+
+
+static PyObject* call_asyncio(const char *name)
+{
+    PyObject *asyncio = PyImport_ImportModule("asyncio");
+    if (asyncio == NULL) {
+        return NULL;
+    }
+
+    PyObject *result = PyObject_CallMethod(asyncio, name, NULL);
+    Py_DECREF(asyncio);
+    return result;
+}
+
+
+// StopIteration(value), a tuple prevents unpacking of a list
+static PyObject* stop_with(PyObject *value)
+{
+    PyObject *args = PyTuple_Pack(1, value);
+    if (args == NULL) {
+        return NULL;
+    }
+
+    PyErr_SetObject(PyExc_StopIteration, args);
+    Py_DECREF(args);
+    return NULL;
+}
+
+
+/*
+    Resumes an awaitable of a connection or a cursor.
+    Returns EVENT_WAIT and a waiter to yield, EVENT_READY and the result of the awaitable or -1
+*/
+static int step_awaitable(PyObject *awaitable, PyObject **waiter, PyObject **result)
+{
+    PyObject *value = Py_TYPE(awaitable)->tp_iternext(awaitable);
+    if (value != NULL) {
+        *waiter = value;
+        return EVENT_WAIT;
+    }
+
+    if (!PyErr_Occurred()) {
+        Py_INCREF(Py_None);
+        *result = Py_None;
+        return EVENT_READY;
+    }
+
+    if (!PyErr_ExceptionMatches(PyExc_StopIteration)) {
+        return -1;
+    }
+
+    PyObject *type, *exc, *traceback;
+    PyErr_Fetch(&type, &exc, &traceback);
+    PyErr_NormalizeException(&type, &exc, &traceback);
+
+    *result = PyObject_GetAttrString(exc, "value");
+    Py_XDECREF(type);
+    Py_XDECREF(exc);
+    Py_XDECREF(traceback);
+
+    return *result == NULL ? -1 : EVENT_READY;
+}
+
+
+static wchar_t* copy_dsn(const wchar_t *dsn)
+{
+    size_t size = (wcslen(dsn) + 1) * sizeof(wchar_t);
+
+    wchar_t *copy = (wchar_t *)PyMem_Malloc(size);
+    if (copy != NULL) {
+        memcpy(copy, dsn, size);
+    }
+
+    return copy;
+}
+
+
+/*
+    SQL_ATTR_CONNECTION_DEAD is answered by the driver without a round trip to the server
+*/
+static int is_connection_dead(Connection *conn)
+{
+    SQLUINTEGER dead = SQL_CD_FALSE;
+    SQLRETURN retcode = SQLGetConnectAttr(conn->handle, SQL_ATTR_CONNECTION_DEAD, &dead, SQL_IS_UINTEGER, NULL);
+
+    return SQL_SUCCEEDED(retcode) && dead == SQL_CD_TRUE;
+}
+
+
+static int is_connection_expired(ConnectionPool *self, Connection *conn, long long now)
+{
+    return self->max_lifetime && now - conn->created_at >= (long long)(self->max_lifetime * 1000 + 0.5);
+}
+
+
+/*
+    Hands the value over to the first waiting task: a connection or None, which lets the task open a connection.
+    Returns 1 if a task has taken it, the current exception is kept
+*/
+static int wake_waiter(ConnectionPool *self, PyObject *value)
+{
+    PRINT_DEBUG_MESSAGE(__FUNCTION__);
+
+    int is_woken = 0;
+    PyObject *type, *exc, *traceback;
+    PyErr_Fetch(&type, &exc, &traceback);
+
+    while (!is_woken && PyList_GET_SIZE(self->waiters)) {
+        PyObject *future = PyList_GET_ITEM(self->waiters, 0);
+        Py_INCREF(future);
+        if (PySequence_DelItem(self->waiters, 0) == -1) {
+            Py_DECREF(future);
+            break;
+        }
+
+        // the future of a cancelled task is skipped
+        PyObject *done = PyObject_CallMethod(future, "done", NULL);
+        if (done == Py_False) {
+            PyObject *result = PyObject_CallMethod(future, "set_result", "O", value);
+            is_woken = result != NULL;
+            Py_XDECREF(result);
+        }
+
+        Py_XDECREF(done);
+        Py_DECREF(future);
+        PyErr_Clear();
+    }
+
+    PyErr_Restore(type, exc, traceback);
+    return is_woken;
+}
+
+
+/*
+    Starts the disconnection, which is awaited by a task of the running loop.
+    Without a running loop the connection waits for the disconnection, when it's freed
+*/
+static void close_in_background(Connection *conn)
+{
+    PRINT_DEBUG_MESSAGE(__FUNCTION__);
+
+    PyObject *type, *exc, *traceback;
+    PyErr_Fetch(&type, &exc, &traceback);
+
+    PyObject *awaitable = PyObject_CallMethod((PyObject *)conn, "close", NULL);
+    PyObject *loop = call_asyncio("get_running_loop");
+
+    if (awaitable != NULL && loop != NULL) {
+        PyObject *asyncio = PyImport_ImportModule("asyncio");
+        PyObject *ensure_future = asyncio != NULL ? PyObject_GetAttrString(asyncio, "ensure_future") : NULL;
+        PyObject *call_args = PyTuple_Pack(1, awaitable);
+        PyObject *call_kwargs = Py_BuildValue("{s:O}", "loop", loop);
+
+        if (ensure_future != NULL && call_args != NULL && call_kwargs != NULL) {
+            PyObject *task = PyObject_Call(ensure_future, call_args, call_kwargs);
+            Py_XDECREF(task);
+        }
+
+        Py_XDECREF(call_kwargs);
+        Py_XDECREF(call_args);
+        Py_XDECREF(ensure_future);
+        Py_XDECREF(asyncio);
+    }
+
+    Py_XDECREF(loop);
+    Py_XDECREF(awaitable);
+    PyErr_Clear();
+
+    PyErr_Restore(type, exc, traceback);
+}
+
+
+/*
+    The connection leaves the pool, its place is given to a waiting task
+*/
+static void discard_connection(ConnectionPool *self, Connection *conn)
+{
+    PRINT_DEBUG_MESSAGE(__FUNCTION__);
+
+    self->size--;
+
+    if (conn->state == CONNECTED) {
+        close_in_background(conn);
+    }
+
+    if (self->state == CONNECTED) {
+        wake_waiter(self, Py_None);
+    }
+}
+
+
+/*
+    The idle connections above min_size are closed after idle_timeout, the expired ones are closed at once
+*/
+static void close_idle_connections(ConnectionPool *self)
+{
+    PRINT_DEBUG_MESSAGE(__FUNCTION__);
+
+    if (!self->idle_timeout && !self->max_lifetime) {
+        return;
+    }
+
+    long long now = monotonic_ms();
+    long long idle_timeout = (long long)(self->idle_timeout * 1000 + 0.5);
+    Py_ssize_t kept = 0;
+
+    // the oldest connections are at the bottom of the stack
+    for (Py_ssize_t i = 0; i < self->idle_count; i++) {
+        idle_connection entry = self->idle[i];
+
+        int is_idle = self->idle_timeout && now - entry.idle_since >= idle_timeout && self->size > self->min_size;
+        if (is_idle || is_connection_expired(self, entry.conn, now)) {
+            discard_connection(self, entry.conn);
+            Py_DECREF(entry.conn);
+        } else {
+            self->idle[kept++] = entry;
+        }
+    }
+
+    self->idle_count = kept;
+}
+
+
+/*
+    Takes the last released connection, which is alive, the checked ones are discarded
+*/
+static Connection* take_idle_connection(ConnectionPool *self)
+{
+    PRINT_DEBUG_MESSAGE(__FUNCTION__);
+
+    close_idle_connections(self);
+
+    long long now = monotonic_ms();
+
+    while (self->idle_count) {
+        Connection *conn = self->idle[--self->idle_count].conn;
+
+        if (conn->state == CONNECTED && !is_connection_expired(self, conn, now) && !is_connection_dead(conn)) {
+            Py_INCREF(self);
+            conn->owner = (PyObject *)self;
+            return conn;
+        }
+
+        discard_connection(self, conn);
+        Py_DECREF(conn);
+    }
+
+    return NULL;
+}
+
+
+int release_connection(ConnectionPool *self, Connection *conn)
+{
+    PRINT_DEBUG_MESSAGE(__FUNCTION__);
+
+    if (conn->owner != (PyObject *)self) {
+        PyErr_Format(PyExc_Exception, "(%s) The connection isn't acquired from the pool", __FUNCTION__);
+        return -1;
+    }
+
+    Py_CLEAR(conn->owner);  // the caller keeps the pool
+
+    // a cursor with the pending results keeps the connection busy
+    if (self->state != CONNECTED || conn->state != CONNECTED || conn->runned_cursors
+        || is_connection_expired(self, conn, monotonic_ms()) || is_connection_dead(conn)) {
+        discard_connection(self, conn);
+        close_idle_connections(self);
+        return 0;
+    }
+
+    Py_INCREF(self);
+    conn->owner = (PyObject *)self;
+    if (wake_waiter(self, (PyObject *)conn)) {
+        return 0;
+    }
+    Py_CLEAR(conn->owner);
+
+    Py_INCREF(conn);
+    self->idle[self->idle_count].conn = conn;
+    self->idle[self->idle_count].idle_since = monotonic_ms();
+    self->idle_count++;
+
+    close_idle_connections(self);
+    return 0;
+}
+
+
+/*
+    Called by an acquired connection, which is freed without the release
+*/
+void forget_connection(PyObject *owner)
+{
+    PRINT_DEBUG_MESSAGE(__FUNCTION__);
+
+    ConnectionPool *self = (ConnectionPool *)owner;
+
+    Py_BEGIN_CRITICAL_SECTION(self);
+    self->size--;
+    if (self->state == CONNECTED) {
+        wake_waiter(self, Py_None);
+    }
+    Py_END_CRITICAL_SECTION();
+}
+
+
+/*
+    The first error of the opening is kept and raised after the closing of the pool
+*/
+static void keep_error(ConnectionPool *self)
+{
+    if (self->error_type == NULL) {
+        PyErr_Fetch(&self->error_type, &self->error_value, &self->error_traceback);
+    } else {
+        PyErr_Clear();
+    }
+}
+
+
+static void fail_waiters(ConnectionPool *self)
+{
+    PRINT_DEBUG_MESSAGE(__FUNCTION__);
+
+    for (Py_ssize_t i = 0; i < PyList_GET_SIZE(self->waiters); i++) {
+        PyObject *future = PyList_GET_ITEM(self->waiters, i);
+
+        PyObject *done = PyObject_CallMethod(future, "done", NULL);
+        if (done == Py_False) {
+            PyObject *exc = PyObject_CallFunction(PyExc_Exception, "s", "The pool is closed");
+            if (exc != NULL) {
+                PyObject *result = PyObject_CallMethod(future, "set_exception", "O", exc);
+                Py_XDECREF(result);
+                Py_DECREF(exc);
+            }
+        }
+
+        Py_XDECREF(done);
+        PyErr_Clear();
+    }
+
+    PyList_SetSlice(self->waiters, 0, PyList_GET_SIZE(self->waiters), NULL);
+}
+
+
+/*
+    Starts the disconnection of the idle connections, the acquired ones are closed on the release
+*/
+static int close_pool(ConnectionPool *self)
+{
+    PRINT_DEBUG_MESSAGE(__FUNCTION__);
+
+    if (self->state == DISCONNECTED) {
+        PyErr_Format(PyExc_Exception, "(%s) The pool is already closed", __FUNCTION__);
+        return -1;
+    }
+
+    if (self->state == TO_DISCONNECT) {
+        return 0;
+    }
+
+    self->state = TO_DISCONNECT;
+    fail_waiters(self);
+
+    while (self->idle_count) {
+        Connection *conn = self->idle[--self->idle_count].conn;
+
+        PyObject *result = PyObject_CallMethod((PyObject *)conn, "close", NULL);
+        if (result == NULL || PyList_Append(self->pending, (PyObject *)conn) == -1) {
+            keep_error(self);
+            self->size--;
+        }
+
+        Py_XDECREF(result);
+        Py_DECREF(conn);
+    }
+
+    return 0;
+}
+
+
+PyObject* create_pool(PyObject *module, PyObject *args, PyObject *kwargs)
+{
+    PRINT_DEBUG_MESSAGE(__FUNCTION__);
+
+    static char *kwlist[] = {"dsn", "min_size", "max_size", "timeout", "polling", "idle_timeout", "max_lifetime", NULL};
+    PyObject *py_dsn = NULL;
+    Py_ssize_t min_size = 1;
+    Py_ssize_t max_size = 10;
+    double timeout = 0;
+    int polling = 0;
+    double idle_timeout = 0;
+    double max_lifetime = 0;
+
+    if (!PyArg_ParseTupleAndKeywords(
+        args, kwargs, "O|nndpdd", kwlist,
+        &py_dsn, &min_size, &max_size, &timeout, &polling, &idle_timeout, &max_lifetime
+    )) {
+        return NULL;
+    }
+
+    if (!PyUnicode_Check(py_dsn)) {
+        PyErr_Format(PyExc_AttributeError, "(%s) The connection string must be an Unicode string", __FUNCTION__);
+        return NULL;
+    }
+
+    if (min_size < 0 || max_size < 1 || min_size > max_size) {
+        PyErr_Format(PyExc_AttributeError, "(%s) The sizes must be 0 <= min_size <= max_size, 1 <= max_size", __FUNCTION__);
+        return NULL;
+    }
+
+    if (timeout < 0 || idle_timeout < 0 || max_lifetime < 0) {
+        PyErr_Format(PyExc_AttributeError, "(%s) The value must be nonnegative", __FUNCTION__);
+        return NULL;
+    }
+
+    if (timeout > 2147483647) {
+        PyErr_Format(PyExc_AttributeError, "(%s) The value must be less than 2147483648", __FUNCTION__);
+        return NULL;
+    }
+
+    module_state *state = (module_state *)PyModule_GetState(module);
+
+    ConnectionPool *pool = PyObject_New(ConnectionPool, state->pool_type);
+    if (pool == NULL) {
+        return NULL;
+    }
+
+    Py_INCREF(module);
+    pool->module = module;
+    pool->dsn = NULL;
+    pool->timeout = timeout;
+    pool->idle_timeout = idle_timeout;
+    pool->max_lifetime = max_lifetime;
+    pool->idle = NULL;
+    pool->idle_count = 0;
+    pool->pending = NULL;
+    pool->waiters = NULL;
+    pool->error_type = NULL;
+    pool->error_value = NULL;
+    pool->error_traceback = NULL;
+    pool->min_size = min_size;
+    pool->max_size = max_size;
+    pool->size = 0;
+    pool->state = TO_CONNECT;
+    pool->polling = polling ? 1 : 0;
+
+    pool->dsn = (const wchar_t *)PyUnicode_AsWideCharString(py_dsn, NULL);
+    if (pool->dsn == NULL) {
+        goto clean_up;
+    }
+
+    pool->idle = (idle_connection *)PyMem_Malloc(max_size * sizeof(idle_connection));
+    if (pool->idle == NULL) {
+        PyErr_NoMemory();
+        goto clean_up;
+    }
+
+    pool->pending = PyList_New(0);
+    pool->waiters = PyList_New(0);
+    if (pool->pending == NULL || pool->waiters == NULL) {
+        goto clean_up;
+    }
+
+    // the connections are opened in parallel by the workers and awaited by the pool
+    for (Py_ssize_t i = 0; i < min_size; i++) {
+        wchar_t *dsn = copy_dsn(pool->dsn);
+        if (dsn == NULL) {
+            PyErr_NoMemory();
+            goto clean_up;
+        }
+
+        Connection *conn = create_connection(module, dsn, timeout, polling, __FUNCTION__);
+        if (conn == NULL) {
+            goto clean_up;
+        }
+
+        int code = PyList_Append(pool->pending, (PyObject *)conn);
+        Py_DECREF(conn);
+        if (code == -1) {
+            goto clean_up;
+        }
+
+        pool->size++;
+    }
+
+    return (PyObject *)pool;
+
+    clean_up:
+        Py_DECREF(pool);
+        return NULL;
+}
+
+
+static PyObject* ConnectionPool_Iter(ConnectionPool *self)
+{
+    PRINT_DEBUG_MESSAGE(__FUNCTION__);
+
+    Py_INCREF(self);
+    return (PyObject *)self;
+}
+
+
+/*
+    Awaits the connections of the opening or the closing one by one, the workers run them in parallel
+*/
+static PyObject* ConnectionPool_Next(ConnectionPool *self)
+{
+    PRINT_DEBUG_MESSAGE(__FUNCTION__);
+
+    if (self->state == CONNECTED) {
+        PyErr_Format(PyExc_Exception, "(%s) The pool is already opened", __FUNCTION__);
+        return NULL;
+    }
+
+    if (self->state == DISCONNECTED) {
+        PyErr_Format(PyExc_Exception, "(%s) The pool is already closed", __FUNCTION__);
+        return NULL;
+    }
+
+    while (PyList_GET_SIZE(self->pending)) {
+        Connection *conn = (Connection *)PyList_GET_ITEM(self->pending, 0);
+        PyObject *waiter = NULL;
+        PyObject *result = NULL;
+
+        switch (step_awaitable((PyObject *)conn, &waiter, &result)) {
+            case EVENT_WAIT:
+                return waiter;
+            case EVENT_READY:
+                Py_DECREF(result);
+                break;
+            default:
+                keep_error(self);
+                if (close_pool(self) == -1) {
+                    keep_error(self);
+                }
+        }
+
+        Py_INCREF(conn);
+        PySequence_DelItem(self->pending, 0);
+
+        if (conn->state != CONNECTED) {
+            // disconnected or failed to connect
+            self->size--;
+        } else if (self->state == TO_CONNECT) {
+            self->idle[self->idle_count].conn = conn;
+            self->idle[self->idle_count].idle_since = monotonic_ms();
+            self->idle_count++;
+            continue;
+        } else {
+            // the connection is opened while the pool is closed
+            PyObject *awaitable = PyObject_CallMethod((PyObject *)conn, "close", NULL);
+            if (awaitable == NULL || PyList_Append(self->pending, (PyObject *)conn) == -1) {
+                keep_error(self);
+                self->size--;
+            }
+            Py_XDECREF(awaitable);
+        }
+
+        Py_DECREF(conn);
+    }
+
+    if (self->state == TO_CONNECT) {
+        self->state = CONNECTED;
+        return stop_with((PyObject *)self);
+    }
+
+    self->state = DISCONNECTED;
+
+    if (self->error_type != NULL) {
+        PyErr_Restore(self->error_type, self->error_value, self->error_traceback);
+        self->error_type = NULL;
+        self->error_value = NULL;
+        self->error_traceback = NULL;
+    }
+
+    // None, so __aexit__ doesn't suppress an exception
+    return NULL;
+}
+
+
+static void ConnectionPool_Dealloc(ConnectionPool *self)
+{
+    PRINT_DEBUG_MESSAGE(__FUNCTION__);
+
+    // the idle connections aren't disconnected like a connection, which isn't closed
+    for (Py_ssize_t i = 0; i < self->idle_count; i++) {
+        Py_DECREF(self->idle[i].conn);
+    }
+
+    PY_MEM_FREE_TO_NULL(self->idle);
+    PY_MEM_FREE_TO_NULL(self->dsn);
+    Py_XDECREF(self->pending);
+    Py_XDECREF(self->waiters);
+    Py_XDECREF(self->error_type);
+    Py_XDECREF(self->error_value);
+    Py_XDECREF(self->error_traceback);
+    Py_XDECREF(self->module);
+
+    PyTypeObject *type = Py_TYPE(self);
+    type->tp_free((PyObject *)self);
+    Py_DECREF(type);  // the instances of a heap type keep it
+}
+
+
+static PyObject* create_request(ConnectionPool *self, int kind, PyObject *args, PyObject *kwargs)
+{
+    PRINT_DEBUG_MESSAGE(__FUNCTION__);
+
+    module_state *state = (module_state *)PyModule_GetState(self->module);
+
+    PoolRequest *request = PyObject_New(PoolRequest, state->pool_request_type);
+    if (request == NULL) {
+        return NULL;
+    }
+
+    Py_INCREF(self);
+    request->pool = self;
+    request->conn = NULL;
+    request->future = NULL;
+    request->cursor = NULL;
+    request->awaited = NULL;
+    Py_XINCREF(args);
+    request->args = args;
+    Py_XINCREF(kwargs);
+    request->kwargs = kwargs;
+    request->kind = kind;
+    request->state = REQUEST_ACQUIRE;
+
+    return (PyObject *)request;
+}
+
+
+static PyObject* ConnectionPool_Acquire(ConnectionPool *self)
+{
+    PRINT_DEBUG_MESSAGE(__FUNCTION__);
+
+    return create_request(self, REQUEST_KIND_ACQUIRE, NULL, NULL);
+}
+
+
+static PyObject* ConnectionPool_Release(ConnectionPool *self, PyObject *conn)
+{
+    PRINT_DEBUG_MESSAGE(__FUNCTION__);
+
+    module_state *state = (module_state *)PyModule_GetState(self->module);
+
+    if (!PyObject_TypeCheck(conn, state->connection_type)) {
+        PyErr_Format(PyExc_TypeError, "(%s) The argument must be a connection", __FUNCTION__);
+        return NULL;
+    }
+
+    if (release_connection(self, (Connection *)conn) == -1) {
+        return NULL;
+    }
+
+    Py_RETURN_NONE;
+}
+
+
+static PyObject* ConnectionPool_Execute(ConnectionPool *self, PyObject *args, PyObject *kwargs)
+{
+    PRINT_DEBUG_MESSAGE(__FUNCTION__);
+
+    return create_request(self, REQUEST_KIND_EXECUTE, args, kwargs);
+}
+
+
+static PyObject* ConnectionPool_Fetchall(ConnectionPool *self, PyObject *args, PyObject *kwargs)
+{
+    PRINT_DEBUG_MESSAGE(__FUNCTION__);
+
+    return create_request(self, REQUEST_KIND_FETCHALL, args, kwargs);
+}
+
+
+static PyObject* ConnectionPool_Stats(ConnectionPool *self)
+{
+    PRINT_DEBUG_MESSAGE(__FUNCTION__);
+
+    Py_ssize_t waiting = 0;
+    for (Py_ssize_t i = 0; i < PyList_GET_SIZE(self->waiters); i++) {
+        PyObject *done = PyObject_CallMethod(PyList_GET_ITEM(self->waiters, i), "done", NULL);
+        if (done == NULL) {
+            return NULL;
+        }
+
+        waiting += done == Py_False;
+        Py_DECREF(done);
+    }
+
+    return Py_BuildValue(
+        "{s:n,s:n,s:n,s:n,s:n}",
+        "size", self->size,
+        "idle", self->idle_count,
+        "waiting", waiting,
+        "min_size", self->min_size,
+        "max_size", self->max_size
+    );
+}
+
+
+static PyObject* ConnectionPool_Close(ConnectionPool *self)
+{
+    PRINT_DEBUG_MESSAGE(__FUNCTION__);
+
+    if (close_pool(self) == -1) {
+        return NULL;
+    }
+
+    Py_INCREF(self);
+    return (PyObject *)self;
+}
+
+
+static PyObject* ConnectionPool_Aexit(ConnectionPool *self, PyObject *args)
+{
+    PRINT_DEBUG_MESSAGE(__FUNCTION__);
+
+    // an error of the closing is raised, when the pool is awaited
+    if (close_pool(self) == -1) {
+        PyErr_Clear();
+    }
+
+    Py_INCREF(self);
+    return (PyObject *)self;
+}
+
+
+/*
+    Waits for a released connection by a future of the running loop
+*/
+static int wait_for_connection(PoolRequest *self)
+{
+    PRINT_DEBUG_MESSAGE(__FUNCTION__);
+
+    PyObject *waiters = self->pool->waiters;
+
+    // the futures of the cancelled tasks
+    for (Py_ssize_t i = PyList_GET_SIZE(waiters) - 1; i >= 0; i--) {
+        PyObject *done = PyObject_CallMethod(PyList_GET_ITEM(waiters, i), "done", NULL);
+        if (done == NULL) {
+            return -1;
+        }
+
+        int is_done = done == Py_True;
+        Py_DECREF(done);
+        if (is_done && PySequence_DelItem(waiters, i) == -1) {
+            return -1;
+        }
+    }
+
+    PyObject *loop = call_asyncio("get_running_loop");
+    if (loop == NULL) {
+        return -1;
+    }
+
+    PyObject *future = PyObject_CallMethod(loop, "create_future", NULL);
+    Py_DECREF(loop);
+    if (future == NULL) {
+        return -1;
+    }
+
+    // the same as asyncio.Future.__await__ does before yielding
+    if (PyObject_SetAttrString(future, "_asyncio_future_blocking", Py_True) == -1
+        || PyList_Append(waiters, future) == -1) {
+        Py_DECREF(future);
+        return -1;
+    }
+
+    self->future = future;
+    return 0;
+}
+
+
+/*
+    Closes the cursor of the request and releases its connection, the current exception is kept
+*/
+static int finish_request(PoolRequest *self)
+{
+    PRINT_DEBUG_MESSAGE(__FUNCTION__);
+
+    int code = 0;
+    PyObject *type, *exc, *traceback;
+    PyErr_Fetch(&type, &exc, &traceback);
+
+    Py_CLEAR(self->awaited);
+
+    // closing of an executing cursor cancels its statement
+    if (self->cursor != NULL) {
+        PyObject *result = PyObject_CallMethod(self->cursor, "close", NULL);
+        if (result == NULL) {
+            code = -1;
+        }
+        Py_XDECREF(result);
+        Py_CLEAR(self->cursor);
+    }
+
+    if (self->conn != NULL) {
+        if (code == 0) {
+            code = release_connection(self->pool, self->conn);
+        } else {
+            PyObject *type, *exc, *traceback;
+            PyErr_Fetch(&type, &exc, &traceback);
+            release_connection(self->pool, self->conn);
+            PyErr_Restore(type, exc, traceback);
+        }
+        Py_CLEAR(self->conn);
+    }
+
+    self->state = REQUEST_DONE;
+
+    if (type != NULL) {
+        PyErr_Clear();
+        PyErr_Restore(type, exc, traceback);
+        return -1;
+    }
+
+    return code;
+}
+
+
+static PyObject* PoolRequest_Iter(PoolRequest *self)
+{
+    PRINT_DEBUG_MESSAGE(__FUNCTION__);
+
+    Py_INCREF(self);
+    return (PyObject *)self;
+}
+
+
+static PyObject* PoolRequest_Next(PoolRequest *self)
+{
+    PRINT_DEBUG_MESSAGE(__FUNCTION__);
+
+    ConnectionPool *pool = self->pool;
+    PyObject *waiter = NULL;
+    PyObject *result = NULL;
+
+    for (;;) {
+        switch (self->state) {
+            case REQUEST_ACQUIRE:
+                if (pool->state != CONNECTED) {
+                    self->state = REQUEST_DONE;
+                    PyErr_Format(PyExc_Exception, "(%s) The pool isn't opened", __FUNCTION__);
+                    return NULL;
+                }
+
+                self->conn = take_idle_connection(pool);
+                if (self->conn != NULL) {
+                    break;
+                }
+
+                if (pool->size < pool->max_size) {
+                    wchar_t *dsn = copy_dsn(pool->dsn);
+                    if (dsn == NULL) {
+                        self->state = REQUEST_DONE;
+                        return PyErr_NoMemory();
+                    }
+
+                    self->conn = create_connection(pool->module, dsn, pool->timeout, pool->polling, __FUNCTION__);
+                    if (self->conn == NULL) {
+                        self->state = REQUEST_DONE;
+                        return NULL;
+                    }
+
+                    pool->size++;
+                    self->state = REQUEST_CONNECT;
+                    continue;
+                }
+
+                if (wait_for_connection(self) == -1) {
+                    self->state = REQUEST_DONE;
+                    return NULL;
+                }
+
+                self->state = REQUEST_WAIT;
+                Py_INCREF(self->future);
+                return self->future;
+
+            case REQUEST_WAIT: {
+                PyObject *done = PyObject_CallMethod(self->future, "done", NULL);
+                if (done == NULL) {
+                    return NULL;
+                }
+
+                if (done == Py_False) {
+                    // resumed before the wakeup, the same future is yielded again
+                    Py_DECREF(done);
+                    if (PyObject_SetAttrString(self->future, "_asyncio_future_blocking", Py_True) == -1) {
+                        return NULL;
+                    }
+                    Py_INCREF(self->future);
+                    return self->future;
+                }
+                Py_DECREF(done);
+
+                // CancelledError or the closing of the pool
+                result = PyObject_CallMethod(self->future, "result", NULL);
+                Py_CLEAR(self->future);
+                if (result == NULL) {
+                    self->state = REQUEST_DONE;
+                    return NULL;
+                }
+
+                if (result == Py_None) {
+                    // a place in the pool is freed, the task opens a connection
+                    Py_DECREF(result);
+                    self->state = REQUEST_ACQUIRE;
+                    continue;
+                }
+
+                self->conn = (Connection *)result;
+                break;
+            }
+
+            case REQUEST_CONNECT:
+                switch (step_awaitable((PyObject *)self->conn, &waiter, &result)) {
+                    case EVENT_WAIT:
+                        return waiter;
+                    case EVENT_READY:
+                        Py_DECREF(result);
+                        break;
+                    default:
+                        Py_CLEAR(self->conn);
+                        pool->size--;
+                        wake_waiter(pool, Py_None);
+                        self->state = REQUEST_DONE;
+                        return NULL;
+                }
+
+                Py_INCREF(pool);
+                self->conn->owner = (PyObject *)pool;
+                break;
+
+            case REQUEST_EXECUTE:
+            case REQUEST_FETCH:
+                switch (step_awaitable(self->awaited, &waiter, &result)) {
+                    case EVENT_WAIT:
+                        return waiter;
+                    case EVENT_READY:
+                        break;
+                    default:
+                        finish_request(self);
+                        return NULL;
+                }
+
+                Py_CLEAR(self->awaited);
+
+                if (self->state == REQUEST_EXECUTE) {
+                    Py_DECREF(result);  // the cursor
+
+                    if (self->kind == REQUEST_KIND_FETCHALL) {
+                        self->awaited = PyObject_CallMethod(self->cursor, "fetchall_async", NULL);
+                        if (self->awaited == NULL) {
+                            finish_request(self);
+                            return NULL;
+                        }
+
+                        self->state = REQUEST_FETCH;
+                        continue;
+                    }
+
+                    Py_INCREF(Py_None);
+                    result = Py_None;
+                }
+
+                if (finish_request(self) == -1) {
+                    Py_DECREF(result);
+                    return NULL;
+                }
+
+                stop_with(result);
+                Py_DECREF(result);
+                return NULL;
+
+            case REQUEST_ACQUIRED:
+                PyErr_Format(PyExc_Exception, "(%s) The connection is already acquired", __FUNCTION__);
+                return NULL;
+
+            default:
+                return NULL;
+        }
+
+        // the connection is acquired
+        if (self->kind == REQUEST_KIND_ACQUIRE) {
+            self->state = REQUEST_ACQUIRED;
+            return stop_with((PyObject *)self->conn);
+        }
+
+        PyObject *execute = NULL;
+        self->cursor = PyObject_CallMethod((PyObject *)self->conn, "cursor", NULL);
+        if (self->cursor != NULL) {
+            execute = PyObject_GetAttrString(self->cursor, "execute");
+        }
+
+        if (execute != NULL) {
+            self->awaited = PyObject_Call(execute, self->args, self->kwargs);
+            Py_DECREF(execute);
+        }
+
+        if (self->awaited == NULL) {
+            finish_request(self);
+            return NULL;
+        }
+
+        self->state = REQUEST_EXECUTE;
+    }
+}
+
+
+static void PoolRequest_Dealloc(PoolRequest *self)
+{
+    PRINT_DEBUG_MESSAGE(__FUNCTION__);
+
+    PyObject *type, *exc, *traceback;
+    PyErr_Fetch(&type, &exc, &traceback);
+
+    Py_BEGIN_CRITICAL_SECTION(self->pool);
+
+    switch (self->state) {
+        case REQUEST_WAIT: {
+            // the task is cancelled, after a connection was handed over to it
+            PyObject *cancelled = PyObject_CallMethod(self->future, "cancel", NULL);
+            if (cancelled == Py_False) {
+                PyObject *result = PyObject_CallMethod(self->future, "result", NULL);
+                if (result != NULL && result != Py_None) {
+                    self->conn = (Connection *)result;
+                    result = NULL;
+                }
+                Py_XDECREF(result);
+            }
+            Py_XDECREF(cancelled);
+            PyErr_Clear();
+
+            if (self->conn != NULL) {
+                release_connection(self->pool, self->conn);
+                PyErr_Clear();
+            }
+            break;
+        }
+
+        case REQUEST_CONNECT:
+            // the abandoned connection waits for the worker, when it's freed
+            self->pool->size--;
+            wake_waiter(self->pool, Py_None);
+            break;
+
+        case REQUEST_EXECUTE:
+        case REQUEST_FETCH:
+            finish_request(self);
+            PyErr_Clear();
+            break;
+    }
+
+    Py_END_CRITICAL_SECTION();
+
+    Py_XDECREF(self->future);
+    Py_XDECREF(self->awaited);
+    Py_XDECREF(self->cursor);
+    Py_XDECREF(self->conn);
+    Py_XDECREF(self->args);
+    Py_XDECREF(self->kwargs);
+    Py_XDECREF(self->pool);
+
+    PyErr_Restore(type, exc, traceback);
+
+    PyTypeObject *tp = Py_TYPE(self);
+    tp->tp_free((PyObject *)self);
+    Py_DECREF(tp);  // the instances of a heap type keep it
+}
+
+
+static PyObject* PoolRequest_Aexit(PoolRequest *self, PyObject *args)
+{
+    PRINT_DEBUG_MESSAGE(__FUNCTION__);
+
+    // the connection can be already released by the caller
+    if (self->state == REQUEST_ACQUIRED && self->conn->owner == (PyObject *)self->pool) {
+        if (release_connection(self->pool, self->conn) == -1) {
+            return NULL;
+        }
+    }
+
+    Py_CLEAR(self->conn);
+    self->state = REQUEST_DONE;
+
+    // the awaited request returns None, so an exception isn't suppressed
+    Py_INCREF(self);
+    return (PyObject *)self;
+}
+
+
+PyObject* create_connection_group(PyObject *module, PyObject *args, PyObject *kwargs)
+{
+    PRINT_DEBUG_MESSAGE(__FUNCTION__);
+
+    static char *kwlist[] = {"dsn", "n", "timeout", "polling", "quorum", NULL};
+    PyObject *py_dsn = NULL;
+    Py_ssize_t n = 0;
+    double timeout = 0;
+    int polling = 0;
+    Py_ssize_t quorum = 0;
+
+    if (!PyArg_ParseTupleAndKeywords(
+        args, kwargs, "On|dpn", kwlist, &py_dsn, &n, &timeout, &polling, &quorum
+    )) {
+        return NULL;
+    }
+
+    if (!PyUnicode_Check(py_dsn)) {
+        PyErr_Format(PyExc_AttributeError, "(%s) The connection string must be an Unicode string", __FUNCTION__);
+        return NULL;
+    }
+
+    if (n < 1 || quorum < 0 || quorum > n) {
+        PyErr_Format(PyExc_AttributeError, "(%s) The values must be 1 <= n, 0 <= quorum <= n", __FUNCTION__);
+        return NULL;
+    }
+
+    if (timeout < 0) {
+        PyErr_Format(PyExc_AttributeError, "(%s) The value must be nonnegative", __FUNCTION__);
+        return NULL;
+    }
+
+    if (timeout > 2147483647) {
+        PyErr_Format(PyExc_AttributeError, "(%s) The value must be less than 2147483648", __FUNCTION__);
+        return NULL;
+    }
+
+    module_state *state = (module_state *)PyModule_GetState(module);
+
+    ConnectionGroup *group = PyObject_New(ConnectionGroup, state->group_type);
+    if (group == NULL) {
+        return NULL;
+    }
+
+    Py_INCREF(module);
+    group->module = module;
+    group->results = NULL;
+    group->future = NULL;
+    group->pending = NULL;
+    group->pending_count = 0;
+    group->opened = 0;
+    group->quorum = quorum ? quorum : n;
+    group->is_done = 0;
+
+    wchar_t *source = PyUnicode_AsWideCharString(py_dsn, NULL);
+    if (source == NULL) {
+        goto clean_up;
+    }
+
+    group->pending = (Py_ssize_t *)PyMem_Malloc(n * sizeof(Py_ssize_t));
+    group->results = PyList_New(n);
+    if (group->pending == NULL || group->results == NULL) {
+        if (group->pending == NULL) {
+            PyErr_NoMemory();
+        }
+        goto free_source;
+    }
+
+    // all logins are submitted at once, so the workers run them in parallel
+    for (Py_ssize_t i = 0; i < n; i++) {
+        wchar_t *dsn = copy_dsn(source);
+        if (dsn == NULL) {
+            PyErr_NoMemory();
+            goto free_source;
+        }
+
+        Connection *conn = create_connection(module, dsn, timeout, polling, __FUNCTION__);
+        if (conn == NULL) {
+            goto free_source;
+        }
+
+        PyList_SET_ITEM(group->results, i, (PyObject *)conn);
+        group->pending[group->pending_count++] = i;
+    }
+
+    PyMem_Free(source);
+    return (PyObject *)group;
+
+    free_source:
+        PyMem_Free(source);
+
+    clean_up:
+        Py_DECREF(group);
+        return NULL;
+}
+
+
+static PyObject* ConnectionGroup_Iter(ConnectionGroup *self)
+{
+    PRINT_DEBUG_MESSAGE(__FUNCTION__);
+
+    Py_INCREF(self);
+    return (PyObject *)self;
+}
+
+
+/*
+    The exception of a failed connection takes its place in the results
+*/
+static void keep_connection_error(ConnectionGroup *self, Py_ssize_t place)
+{
+    PyObject *type, *exc, *traceback;
+    PyErr_Fetch(&type, &exc, &traceback);
+    PyErr_NormalizeException(&type, &exc, &traceback);
+
+    if (traceback != NULL) {
+        PyException_SetTraceback(exc, traceback);
+    }
+
+    PyList_SetItem(self->results, place, exc);
+    Py_XDECREF(type);
+    Py_XDECREF(traceback);
+}
+
+
+#ifdef __linux__
+static PyObject* on_connection_ready(ConnectionGroup *self, PyObject *future)
+{
+    PRINT_DEBUG_MESSAGE(__FUNCTION__);
+
+    PyObject *result = Py_None;
+    Py_INCREF(result);
+
+    Py_BEGIN_CRITICAL_SECTION(self);
+    if (self->future != NULL) {
+        PyObject *done = PyObject_CallMethod(self->future, "done", NULL);
+        if (done == Py_False) {
+            Py_DECREF(result);
+            result = PyObject_CallMethod(self->future, "set_result", "O", Py_None);
+        }
+        Py_XDECREF(done);
+    }
+    Py_END_CRITICAL_SECTION();
+
+    if (result == NULL) {
+        return NULL;
+    }
+    Py_DECREF(result);
+    Py_RETURN_NONE;
+}
+
+
+static PyMethodDef on_connection_ready_def = {
+    "_on_connection_ready", (PyCFunction)on_connection_ready, METH_O, "Wake up the group of connections"
+};
+
+
+/*
+    A cancelled task cancels the waiters of the connecting ones, so their logins are cancelled by SQLCancelHandle
+*/
+static PyObject* on_group_done(ConnectionGroup *self, PyObject *future)
+{
+    PRINT_DEBUG_MESSAGE(__FUNCTION__);
+
+    PyObject *cancelled = PyObject_CallMethod(future, "cancelled", NULL);
+    if (cancelled == NULL) {
+        return NULL;
+    }
+
+    if (cancelled == Py_True) {
+        Py_BEGIN_CRITICAL_SECTION(self);
+        for (Py_ssize_t i = 0; i < self->pending_count; i++) {
+            Connection *conn = (Connection *)PyList_GET_ITEM(self->results, self->pending[i]);
+            if (conn->event != NULL && conn->event->future != NULL) {
+                PyObject *result = PyObject_CallMethod(conn->event->future, "cancel", NULL);
+                if (result == NULL) {
+                    PyErr_Clear();
+                }
+                Py_XDECREF(result);
+            }
+        }
+        Py_END_CRITICAL_SECTION();
+    }
+    Py_DECREF(cancelled);
+
+    Py_RETURN_NONE;
+}
+
+
+static PyMethodDef on_group_done_def = {
+    "_on_group_done", (PyCFunction)on_group_done, METH_O, "Cancel the logins of the cancelled group"
+};
+
+
+static int add_done_callback(PyObject *future, PyMethodDef *def, ConnectionGroup *self)
+{
+    PyObject *callback = PyCFunction_New(def, (PyObject *)self);
+    if (callback == NULL) {
+        return -1;
+    }
+
+    PyObject *result = PyObject_CallMethod(future, "add_done_callback", "O", callback);
+    Py_DECREF(callback);
+    if (result == NULL) {
+        return -1;
+    }
+
+    Py_DECREF(result);
+    return 0;
+}
+
+
+/*
+    Yields one future for all connections, it's resolved by the first ready one
+*/
+static PyObject* wait_for_any(ConnectionGroup *self, PyObject *waiters)
+{
+    PRINT_DEBUG_MESSAGE(__FUNCTION__);
+
+    PyObject *loop = call_asyncio("get_running_loop");
+    if (loop == NULL) {
+        return NULL;
+    }
+
+    PyObject *future = PyObject_CallMethod(loop, "create_future", NULL);
+    Py_DECREF(loop);
+    if (future == NULL) {
+        return NULL;
+    }
+
+    for (Py_ssize_t i = 0; i < PyList_GET_SIZE(waiters); i++) {
+        if (add_done_callback(PyList_GET_ITEM(waiters, i), &on_connection_ready_def, self) == -1) {
+            goto clean_up;
+        }
+    }
+
+    if (add_done_callback(future, &on_group_done_def, self) == -1) {
+        goto clean_up;
+    }
+
+    // the same as asyncio.Future.__await__ does before yielding
+    if (PyObject_SetAttrString(future, "_asyncio_future_blocking", Py_True) == -1) {
+        goto clean_up;
+    }
+
+    Py_INCREF(future);
+    self->future = future;
+    return future;
+
+    clean_up:
+        Py_DECREF(future);
+        return NULL;
+}
+#endif
+
+
+/*
+    Resumes all connecting ones, until the quorum is opened or all of them are finished
+*/
+static PyObject* ConnectionGroup_Next(ConnectionGroup *self)
+{
+    PRINT_DEBUG_MESSAGE(__FUNCTION__);
+
+    if (self->is_done) {
+        PyErr_Format(PyExc_Exception, "(%s) The connections are already opened", __FUNCTION__);
+        return NULL;
+    }
+
+    Py_CLEAR(self->future);
+
+    PyObject *waiters = PyList_New(0);
+    if (waiters == NULL) {
+        return NULL;
+    }
+
+    Py_ssize_t count = 0;
+    for (Py_ssize_t i = 0; i < self->pending_count; i++) {
+        Py_ssize_t place = self->pending[i];
+        PyObject *conn = PyList_GET_ITEM(self->results, place);
+        PyObject *waiter = NULL;
+        PyObject *result = NULL;
+
+        switch (step_awaitable(conn, &waiter, &result)) {
+            case EVENT_WAIT:
+                if (waiter == Py_None) {
+                    // the waiting without a running loop blocks, the others are resumed by the next iteration
+                    memmove(&self->pending[count], &self->pending[i], (self->pending_count - i) * sizeof(Py_ssize_t));
+                    self->pending_count = count + self->pending_count - i;
+                    Py_DECREF(waiters);
+                    return waiter;
+                }
+
+                self->pending[count++] = place;
+                int code = PyList_Append(waiters, waiter);
+                Py_DECREF(waiter);
+                if (code == -1) {
+                    memmove(&self->pending[count], &self->pending[i + 1], (self->pending_count - i - 1) * sizeof(Py_ssize_t));
+                    self->pending_count = count + self->pending_count - i - 1;
+                    Py_DECREF(waiters);
+                    return NULL;
+                }
+                break;
+            case EVENT_READY:
+                Py_DECREF(result);
+                self->opened++;
+                break;
+            default:
+                keep_connection_error(self, place);
+        }
+    }
+    self->pending_count = count;
+
+    if (!self->pending_count || self->opened >= self->quorum) {
+        // the rest are still connecting, awaiting of them finishes the login
+        Py_DECREF(waiters);
+        self->is_done = 1;
+        return stop_with(self->results);
+    }
+
+    #ifdef __linux__
+    PyObject *future = wait_for_any(self, waiters);
+    Py_DECREF(waiters);
+    return future;
+
+    #else
+    Py_DECREF(waiters);
+    Py_RETURN_NONE;
+    #endif
+}
+
+
+static void ConnectionGroup_Dealloc(ConnectionGroup *self)
+{
+    PRINT_DEBUG_MESSAGE(__FUNCTION__);
+
+    // the abandoned connections wait for their workers, when they're freed
+    PY_MEM_FREE_TO_NULL(self->pending);
+    Py_XDECREF(self->future);
+    Py_XDECREF(self->results);
+    Py_XDECREF(self->module);
+
+    PyTypeObject *type = Py_TYPE(self);
+    type->tp_free((PyObject *)self);
+    Py_DECREF(type);  // the instances of a heap type keep it
+}
+
+
+/*
+    The methods lock the pool, it matters only for the free-threaded build
+*/
+static PyObject* ConnectionPool_Next_locked(ConnectionPool *self)
+{
+    PyObject *result;
+    Py_BEGIN_CRITICAL_SECTION(self);
+    result = ConnectionPool_Next(self);
+    Py_END_CRITICAL_SECTION();
+    return result;
+}
+
+
+static PyObject* ConnectionPool_Acquire_locked(ConnectionPool *self)
+{
+    PyObject *result;
+    Py_BEGIN_CRITICAL_SECTION(self);
+    result = ConnectionPool_Acquire(self);
+    Py_END_CRITICAL_SECTION();
+    return result;
+}
+
+
+static PyObject* ConnectionPool_Release_locked(ConnectionPool *self, PyObject *conn)
+{
+    PyObject *result;
+    Py_BEGIN_CRITICAL_SECTION(self);
+    result = ConnectionPool_Release(self, conn);
+    Py_END_CRITICAL_SECTION();
+    return result;
+}
+
+
+static PyObject* ConnectionPool_Execute_locked(ConnectionPool *self, PyObject *args, PyObject *kwargs)
+{
+    PyObject *result;
+    Py_BEGIN_CRITICAL_SECTION(self);
+    result = ConnectionPool_Execute(self, args, kwargs);
+    Py_END_CRITICAL_SECTION();
+    return result;
+}
+
+
+static PyObject* ConnectionPool_Fetchall_locked(ConnectionPool *self, PyObject *args, PyObject *kwargs)
+{
+    PyObject *result;
+    Py_BEGIN_CRITICAL_SECTION(self);
+    result = ConnectionPool_Fetchall(self, args, kwargs);
+    Py_END_CRITICAL_SECTION();
+    return result;
+}
+
+
+static PyObject* ConnectionPool_Stats_locked(ConnectionPool *self)
+{
+    PyObject *result;
+    Py_BEGIN_CRITICAL_SECTION(self);
+    result = ConnectionPool_Stats(self);
+    Py_END_CRITICAL_SECTION();
+    return result;
+}
+
+
+static PyObject* ConnectionPool_Close_locked(ConnectionPool *self)
+{
+    PyObject *result;
+    Py_BEGIN_CRITICAL_SECTION(self);
+    result = ConnectionPool_Close(self);
+    Py_END_CRITICAL_SECTION();
+    return result;
+}
+
+
+static PyObject* ConnectionPool_Aexit_locked(ConnectionPool *self, PyObject *args)
+{
+    PyObject *result;
+    Py_BEGIN_CRITICAL_SECTION(self);
+    result = ConnectionPool_Aexit(self, args);
+    Py_END_CRITICAL_SECTION();
+    return result;
+}
+
+
+static PyObject* PoolRequest_Next_locked(PoolRequest *self)
+{
+    PyObject *result;
+    Py_BEGIN_CRITICAL_SECTION2(self, self->pool);
+    result = PoolRequest_Next(self);
+    Py_END_CRITICAL_SECTION2();
+    return result;
+}
+
+
+static PyObject* PoolRequest_Aexit_locked(PoolRequest *self, PyObject *args)
+{
+    PyObject *result;
+    Py_BEGIN_CRITICAL_SECTION2(self, self->pool);
+    result = PoolRequest_Aexit(self, args);
+    Py_END_CRITICAL_SECTION2();
+    return result;
+}
+
+
+static PyObject* ConnectionGroup_Next_locked(ConnectionGroup *self)
+{
+    PyObject *result;
+    Py_BEGIN_CRITICAL_SECTION(self);
+    result = ConnectionGroup_Next(self);
+    Py_END_CRITICAL_SECTION();
+    return result;
+}
+
+
+static PyMethodDef ConnectionPool_Methods[] = {
+    {"__aenter__", (PyCFunction)ConnectionPool_Iter, METH_NOARGS, "Asynchronous opening of the pool"},
+    {"__aexit__", (PyCFunction)ConnectionPool_Aexit_locked, METH_VARARGS, "Asynchronous closing of the pool"},
+    {"acquire", (PyCFunction)ConnectionPool_Acquire_locked, METH_NOARGS, "Acquire a connection"},
+    {"release", (PyCFunction)ConnectionPool_Release_locked, METH_O, "Release an acquired connection"},
+    {"execute", (PyCFunction)ConnectionPool_Execute_locked, METH_VARARGS|METH_KEYWORDS, "Asynchronous execution on an idle connection"},
+    {"fetchall", (PyCFunction)ConnectionPool_Fetchall_locked, METH_VARARGS|METH_KEYWORDS, "Asynchronous execution and fetchall on an idle connection"},
+    {"stats", (PyCFunction)ConnectionPool_Stats_locked, METH_NOARGS, "Statistics of the pool"},
+    {"close", (PyCFunction)ConnectionPool_Close_locked, METH_NOARGS, "Asynchronous closing of the pool"},
+    {NULL, NULL, 0, NULL}
+};
+
+
+static PyType_Slot ConnectionPool_Slots[] = {
+    {Py_tp_doc, (void *)PyDoc_STR("Asynchronous Connection Pool Class")},
+    {Py_tp_iter, (void *)ConnectionPool_Iter},
+    {Py_tp_iternext, (void *)ConnectionPool_Next_locked},
+    {Py_tp_dealloc, (void *)ConnectionPool_Dealloc},
+    {Py_am_await, (void *)ConnectionPool_Iter},
+    {Py_tp_methods, ConnectionPool_Methods},
+    {0, NULL}
+};
+
+
+PyType_Spec ConnectionPool_Spec = {
+    .name = "pyaodbc.ConnectionPool",
+    .basicsize = sizeof(ConnectionPool),
+    .itemsize = 0,
+    .flags = Py_TPFLAGS_DEFAULT | TPFLAGS_NO_INSTANTIATION,
+    .slots = ConnectionPool_Slots
+};
+
+
+static PyMethodDef PoolRequest_Methods[] = {
+    {"__aenter__", (PyCFunction)PoolRequest_Iter, METH_NOARGS, "Asynchronous acquiring of a connection"},
+    {"__aexit__", (PyCFunction)PoolRequest_Aexit_locked, METH_VARARGS, "Release the acquired connection"},
+    {NULL, NULL, 0, NULL}
+};
+
+
+static PyType_Slot PoolRequest_Slots[] = {
+    {Py_tp_doc, (void *)PyDoc_STR("Awaitable of a pool request")},
+    {Py_tp_iter, (void *)PoolRequest_Iter},
+    {Py_tp_iternext, (void *)PoolRequest_Next_locked},
+    {Py_tp_dealloc, (void *)PoolRequest_Dealloc},
+    {Py_am_await, (void *)PoolRequest_Iter},
+    {Py_tp_methods, PoolRequest_Methods},
+    {0, NULL}
+};
+
+
+PyType_Spec PoolRequest_Spec = {
+    .name = "pyaodbc.PoolRequest",
+    .basicsize = sizeof(PoolRequest),
+    .itemsize = 0,
+    .flags = Py_TPFLAGS_DEFAULT | TPFLAGS_NO_INSTANTIATION,
+    .slots = PoolRequest_Slots
+};
+
+
+static PyType_Slot ConnectionGroup_Slots[] = {
+    {Py_tp_doc, (void *)PyDoc_STR("Awaitable of connect_many")},
+    {Py_tp_iter, (void *)ConnectionGroup_Iter},
+    {Py_tp_iternext, (void *)ConnectionGroup_Next_locked},
+    {Py_tp_dealloc, (void *)ConnectionGroup_Dealloc},
+    {Py_am_await, (void *)ConnectionGroup_Iter},
+    {0, NULL}
+};
+
+
+PyType_Spec ConnectionGroup_Spec = {
+    .name = "pyaodbc.ConnectionGroup",
+    .basicsize = sizeof(ConnectionGroup),
+    .itemsize = 0,
+    .flags = Py_TPFLAGS_DEFAULT | TPFLAGS_NO_INSTANTIATION,
+    .slots = ConnectionGroup_Slots
+};
@@ -0,0 +1,20 @@
+#ifndef _CONNECTION_POOL_H_
+#define _CONNECTION_POOL_H_
+
+
+#include "aodbc_types.h"
+
+
+PyType_Spec ConnectionPool_Spec;
+PyType_Spec PoolRequest_Spec;
+PyType_Spec ConnectionGroup_Spec;
+
+PyObject* create_pool(PyObject *module, PyObject *args, PyObject *kwargs);
+PyObject* create_connection_group(PyObject *module, PyObject *args, PyObject *kwargs);
+int release_connection(ConnectionPool *self, Connection *conn);
+void forget_connection(PyObject *owner);
+
+extern Connection* create_connection(PyObject *module, const wchar_t *dsn, double timeout, int polling, const char *fn_name);
+
+
+#endif
@@ -5,20 +5,56 @@
 // start static declarations
 static PyObject* Cursor_Iter(Cursor *self);
 static PyObject* Cursor_Next(Cursor *self);
+static PyObject* add_result_set(Cursor *self, PyObject *results);
+static PyObject* Cursor_Next_locked(Cursor *self);
 static void Cursor_Dealloc(Cursor *self);
-static PyAsyncMethods Cursor_Awaitable;
-static PyObject* Cursor_Close(Cursor *self);
-static PyObject* Cursor_Exit(Cursor *self, PyObject* args);
-static PyObject* Cursor_Execute(Cursor *self, PyObject *args, PyObject *kwargs);
-static PyObject* Cursor_Fetchall(Cursor *self);
+static PyObject* Cursor_Close_locked(Cursor *self);
+static PyObject* Cursor_Exit_locked(Cursor *self, PyObject* args);
+static PyObject* Cursor_Execute_locked(Cursor *self, PyObject *args, PyObject *kwargs);
+static PyObject* Cursor_Fetchall_locked(Cursor *self);
+static PyObject* Cursor_Fetchmany_locked(Cursor *self, PyObject *args, PyObject *kwargs);
+static PyObject* Cursor_FetchallAsync_locked(Cursor *self);
+static PyObject* Cursor_FetchmanyAsync_locked(Cursor *self, PyObject *args, PyObject *kwargs);
+static PyObject* Cursor_Prefetch_locked(Cursor *self, PyObject *args, PyObject *kwargs);
+static PyObject* Cursor_ANext_locked(Cursor *self);
+static void end_prefetch(Cursor *self);
+static void abort_operation(Cursor *self);
+static void end_polling(Cursor *self);
+static int start_execute(Cursor *self);
+static void drop_queued(Cursor *self);
+static void forget_failed_prepare(Cursor *self);
+static void end_batches(Cursor *self);
+static int bind_batch(Cursor *self);
+static int submit_execute(Cursor *self);
+static PyObject* Cursor_Executemany_locked(Cursor *self, PyObject *args, PyObject *kwargs);
+static PyObject* Cursor_InsertColumns_locked(Cursor *self, PyObject *args, PyObject *kwargs);
+static PyObject* Cursor_Prepare_locked(Cursor *self, PyObject *args, PyObject *kwargs);
+static PyObject* Cursor_Nextset_locked(Cursor *self);
+static PyObject* Cursor_NextsetAsync_locked(Cursor *self);
+static PyObject* Cursor_FetchAllSets_locked(Cursor *self);
+static int prepare_fetch(Cursor *self, size_t limit, int is_end);
+static int start_more_results(Cursor *self);
 // end static declarations
 
 
-void free_parameters(parameters_info *p_info)
+/*
+    The handle forgets the bound buffers before they're freed, otherwise the driver reads them
+    at the next execution with less parameters
+*/
+void free_parameters(Cursor *self)
 {
     PRINT_DEBUG_MESSAGE(__FUNCTION__);
 
+    parameters_info *p_info = &self->p_info;
+
+    release_streams(p_info);
+    release_views(p_info);
+
     if (p_info->parameters != NULL) {
+        if (self->conn->state == CONNECTED) {
+            SQLFreeStmt(self->handle, SQL_RESET_PARAMS);
+        }
+
         for (Py_ssize_t i = 0; i < p_info->params_length; i++) {
             if (p_info->parameters[i].alloc_str == 1) {
                 PyMem_Free(p_info->parameters[i].value.v_str);
@@ -31,6 +67,82 @@ void free_parameters(parameters_info *p_info)
 }
 
 
+static void free_parameter_arrays(batch_info *many)
+{
+    if (many->arrays != NULL) {
+        for (Py_ssize_t i = 0; i < many->params_length; i++) {
+            PyMem_Free(many->arrays[i].values);
+            PyMem_Free(many->arrays[i].indicators);
+        }
+        PyMem_Free(many->arrays);
+        many->arrays = NULL;
+    }
+}
+
+
+/*
+    The handle returns to the execution of one set of parameters, the handle of a closed connection is already freed
+*/
+static void end_batches(Cursor *self)
+{
+    PRINT_DEBUG_MESSAGE(__FUNCTION__);
+
+    batch_info *many = self->many;
+    if (many == NULL) {
+        return;
+    }
+
+    free_parameters(self);  // the bindings are reset with the handle
+
+    if (self->conn->state == CONNECTED) {
+        SQLFreeStmt(self->handle, SQL_RESET_PARAMS);
+        SQLSetStmtAttr(self->handle, SQL_ATTR_PARAMSET_SIZE, (SQLPOINTER)1, SQL_IS_INTEGER);
+        SQLSetStmtAttr(self->handle, SQL_ATTR_PARAM_STATUS_PTR, NULL, SQL_IS_POINTER);
+        SQLSetStmtAttr(self->handle, SQL_ATTR_PARAMS_PROCESSED_PTR, NULL, SQL_IS_POINTER);
+    }
+
+    free_parameter_arrays(many);
+    if (many->columns != NULL) {
+        for (Py_ssize_t i = 0; i < many->params_length; i++) {
+            close_column_source(&many->columns[i]);
+        }
+        PyMem_Free(many->columns);
+    }
+    PyMem_Free(many->status);
+    Py_XDECREF(many->rows);
+    Py_XDECREF(many->statuses);
+    PyMem_Free(many);
+    self->many = NULL;
+}
+
+
+/*
+    The handle is reset to the state of a new one and kept by the connection for the next cursor,
+    the prepared one is kept by the statement cache
+*/
+static int release_statement(Cursor *self)
+{
+    PRINT_DEBUG_MESSAGE(__FUNCTION__);
+
+    self->retcode = keep_statement(self->conn, self->handle, self->prepared_query);
+    self->prepared_query = NULL;
+    CHECK_ERROR("release_statement::keep_statement");
+
+    return 0;
+}
+
+
+/*
+    The failed preparing leaves the handle without the prepared statement
+*/
+static void forget_failed_prepare(Cursor *self)
+{
+    if (self->exec_mode == EXEC_PREPARE || self->exec_mode == EXEC_PREPARE_EXECUTE) {
+        PY_MEM_FREE_TO_NULL(self->prepared_query);
+    }
+}
+
+
 int free_cursor(Cursor *self)
 {
     PRINT_DEBUG_MESSAGE(__FUNCTION__);
@@ -45,31 +157,170 @@ int free_cursor(Cursor *self)
         return -1;
     }
 
+    if (self->prefetch != NULL) {
+        end_prefetch(self);
+    }
+
+    if (self->state == TO_EXECUTE || self->state == TO_FETCH) {
+        abort_operation(self);
+    }
+
     if (self->state == OPENED || self->state == EXECUTED) {
-        free_parameters(&self->p_info);
+        // the results aren't taken, the slot is released with the statement
+        if (self->state == EXECUTED && !self->r_info.is_end) {
+            release_slot(self->conn);
+        }
+
+        free_parameters(self);
+        free_columns(self);
 
-        self->retcode = SQLFreeHandle(SQL_HANDLE_STMT, self->handle);
-        CHECK_ERROR("free_cursor::SQLFreeHandle");
+        if (release_statement(self) == -1) {
+            return -1;
+        }
 
         self->handle = SQL_NULL_HSTMT;
         self->retcode = -1;
         self->state = CLOSED;
         self->timeout = 0;
-        self->start_time = 0;
 
         PY_MEM_FREE_TO_NULL(self->query);
 
         return 0;
     }
 
+    PyErr_Format(PyExc_Exception, "(%s) An undefined cursor state", __FUNCTION__);
+    return -1;
+}
+
+
+static void on_cursor_deadline(void *arg)
+{
+    Cursor *cursor = (Cursor *)arg;
+    SQLCancel(cursor->handle);
+}
+
+
+/*
+    Drops the results of the finished operation, the cursor can be executed again
+*/
+static void drop_operation(Cursor *self)
+{
+    PRINT_DEBUG_MESSAGE(__FUNCTION__);
+
+    stop_deadline(self->conn, &self->timer);
+    self->timer.is_fired = 0;
+
+    close_event(&self->event, &self->event_status);
+    end_polling(self);
+    end_batches(self);
+    release_streams(&self->p_info);
+    release_views(&self->p_info);
+    free_batch(self, self->batch);
+    self->batch = NULL;
+    free_columns(self);
+    Py_CLEAR(self->sets);
+
+    SQLFreeStmt(self->handle, SQL_CLOSE);
+
+    // the slot is already released if the rows were taken before, the prepared statement doesn't take it
     if (self->state == TO_EXECUTE) {
-        PyErr_Format(PyExc_Exception, "(%s) Canceling of the executed instruction isn't implemented", __FUNCTION__);
-        return -1;
+        forget_failed_prepare(self);
+        if (self->exec_mode != EXEC_NONE) {
+            release_slot(self->conn);
+        }
+    } else if (!self->r_info.is_end) {
+        release_slot(self->conn);
     }
+    self->r_info.is_end = 0;
+    self->is_cancelled = 0;
+    self->state = OPENED;
+}
 
-    PyErr_Format(PyExc_Exception, "(%s) An undefined cursor state", __FUNCTION__);
-    return -1;
+
+/*
+    Cancels the executing or the fetching and waits for the worker without the GIL
+*/
+static void abort_operation(Cursor *self)
+{
+    PRINT_DEBUG_MESSAGE(__FUNCTION__);
+
+    if (self->is_queued) {
+        drop_queued(self);  // nothing is running
+        return;
+    }
+
+    if (!self->is_cancelled) {
+        SQLCancel(self->handle);
+    }
+
+    #ifdef _WIN32
+    if (self->event_status != WAIT_OBJECT_0 && self->event != NULL) {
+        Py_BEGIN_ALLOW_THREADS
+        self->event_status = WaitForSingleObject(self->event, INFINITE);
+        Py_END_ALLOW_THREADS
+    }
+
+    if (
+        self->state == TO_EXECUTE && self->exec_mode != EXEC_PREPARE && self->exec_mode != EXEC_NONE
+        && self->exec_mode != EXEC_MORE_RESULTS
+    ) {
+        SQLCompleteAsync(self->handle_type, self->handle, &self->retcode);
+    }
+
+    #elif __linux__
+    if (self->event_status != WAIT_OBJECT_0 && self->event != NULL) {
+        Py_BEGIN_ALLOW_THREADS
+        self->event_status = wait_for_single_object(self->event, -1);
+        Py_END_ALLOW_THREADS
+    }
+    #endif
+
+    drop_operation(self);
+}
+
+
+#ifdef __linux__
+/*
+    The task awaiting the cursor is cancelled, so the worker is interrupted by SQLCancel
+*/
+void cancel_cursor(Cursor *self, PyObject *future)
+{
+    PRINT_DEBUG_MESSAGE(__FUNCTION__);
+
+    if (self->state != TO_EXECUTE && self->state != TO_FETCH) {
+        return;
+    }
+
+    // the prefetched batches are kept for the next iteration
+    if (self->prefetch != NULL || self->event == NULL || self->event->future != future) {
+        return;
+    }
+
+    if (self->is_queued) {
+        drop_queued(self);  // the statement isn't started, it leaves the queue
+        return;
+    }
+
+    SQLCancel(self->handle);
+    self->is_cancelled = 1;
+}
+
+
+/*
+    The worker of the cancelled awaitable has finished, nobody takes its results
+*/
+void complete_cancelled_cursor(Cursor *self)
+{
+    PRINT_DEBUG_MESSAGE(__FUNCTION__);
+
+    if (self->prefetch != NULL || (self->state != TO_EXECUTE && self->state != TO_FETCH)) {
+        return;
+    }
+
+    self->event_status = WAIT_OBJECT_0;
+    drop_operation(self);
 }
+#endif
 
 
 int allocate_cursor(Cursor *self, Connection *conn)
@@ -85,11 +336,39 @@ int allocate_cursor(Cursor *self, Connection *conn)
     self->state = CLOSED;
     self->p_info.parameters = NULL;
     self->p_info.params_length = 0;
+    self->p_info.stream_count = 0;
+    self->p_info.view_count = 0;
+    self->p_info.streamed = NULL;
+    self->p_info.chunk = NULL;
+    self->p_info.is_putting = 0;
+    self->r_info.columns = NULL;
+    self->r_info.column_count = 0;
+    self->r_info.row_count = -1;
+    self->r_info.is_described = 0;
+    self->r_info.is_end = 0;
+    self->batch = NULL;
+    self->prefetch = NULL;
+    self->many = NULL;
+    self->sets = NULL;
+    self->batch_size = 0;
     self->query = NULL;
+    arena_init(&self->memory);
     self->timeout = 0;
-    self->start_time = 0;
+    self->is_cancelled = 0;
+    self->is_polled = 0;
+    self->is_queued = 0;
+    self->next_queued = NULL;
+    self->prepared_query = NULL;
+    self->exec_mode = EXEC_DIRECT;
+    timer_entry_init(&self->timer, on_cursor_deadline, self);
+    #ifdef __linux__
+    self->poll.next = NULL;
+    self->poll.routine = t_sql_exec_direct_poll;
+    self->poll.arg = NULL;
+    self->polled_query = NULL;
+    #endif
 
-    self->retcode = SQLAllocHandle(SQL_HANDLE_STMT, conn->handle, &self->handle);
+    self->retcode = take_statement(conn, &self->handle);
     CHECK_ERROR("allocate_cursor::SQLAllocHandle::SQL_HANDLE_STMT");
 
     return 0;
@@ -105,482 +384,2534 @@ static PyObject* Cursor_Iter(Cursor *self)
 }
 
 
-static PyObject* Cursor_Next(Cursor *self)
+/*
+    Returns EVENT_READY when the worker has finished, EVENT_WAIT with the value to yield or -1 on error
+*/
+static int wait_for_worker(Cursor *self, PyObject **waiter)
 {
-    PRINT_DEBUG_MESSAGE(__FUNCTION__);
-
-    if (self->conn->state != CONNECTED ) {
-        PyErr_Format(PyExc_Exception, "(%s) The connection isn't established", __FUNCTION__);
-        return NULL;
+    if (self->event_status == WAIT_OBJECT_0) {
+        return EVENT_READY;
     }
 
-    if (self->state == EXECUTED) {
-        PyErr_Format(PyExc_Exception, "(%s) The cursor is already executed, You need to take results", __FUNCTION__);
-        return NULL;
+    #ifdef _WIN32
+    self->event_status = WaitForSingleObject(self->event, (DWORD)(50 * self->conn->rate));
+    if (self->event_status != WAIT_OBJECT_0) {
+        Py_INCREF(Py_None);
+        *waiter = Py_None;
+        return EVENT_WAIT;
     }
+    return EVENT_READY;
 
-    if (self->state == CLOSED) {
-        PyErr_Format(PyExc_Exception, "(%s) The cursor is already closed", __FUNCTION__);
-        return NULL;
+    #elif __linux__
+    switch (await_event(self->event, self->conn->rate, waiter)) {
+        case EVENT_READY:
+            self->event_status = WAIT_OBJECT_0;
+            return EVENT_READY;
+        case EVENT_WAIT:
+            return EVENT_WAIT;
+        default:
+            return -1;
     }
+    #endif
+}
 
-    if (self->state == TO_EXECUTE) {
-        if (self->event_status != WAIT_OBJECT_0) {
-            if (
-                self->start_time && \
-                clock() / CLOCKS_PER_SEC - self->start_time >= self->timeout + (long long)(1 / self->conn->rate)
-            ) {
-                self->event_status = WAIT_OBJECT_0;
-                self->state = EXECUTED;
-                
-                PyErr_Format(PyExc_SystemError, "(%s) An event error", __FUNCTION__);
-                return NULL;
-            }
-
-            #ifdef _WIN32
-            self->event_status = WaitForSingleObject(self->event, (DWORD)(50 * self->conn->rate));
 
-            #elif __linux__
-            self->event_status = wait_for_single_object(self->event, (unsigned long)(50 * self->conn->rate));
-            #endif
+static void finish_fetch(Cursor *self, int is_end)
+{
+    PRINT_DEBUG_MESSAGE(__FUNCTION__);
 
-            Py_RETURN_NONE;
-        }
+    if (!is_end) {
         self->state = EXECUTED;
-        free_parameters(&self->p_info);
-
-        #ifdef _WIN32
-        SQLCompleteAsync(self->handle_type, self->handle, &self->retcode);
-        PRINT_DEBUG_MESSAGE("SQLCompleteAsync");
-        #endif
+        return;
+    }
 
-        close_event(&self->event, &self->event_status);
-        PRINT_DEBUG_MESSAGE("Cursor_Next::Close Handle");
+    // the slot is already released if the rows were taken before
+    if (!self->r_info.is_end) {
+        release_slot(self->conn);
+    }
+    self->state = OPENED;
+}
 
-        if (check_error((PyObject *)self, "Cursor_Next::SQLCompleteAsync")) {
-            return NULL;
-        }
 
-        PyErr_SetObject(PyExc_StopIteration, (PyObject *)self);
-        return NULL;
+static void read_row_count(Cursor *self)
+{
+    if (!SQL_SUCCEEDED(SQLRowCount(self->handle, &self->r_info.row_count))) {
+        self->r_info.row_count = -1;
     }
+}
 
-    PyErr_Format(PyExc_TypeError, "(%s) A coroutine was expected", __FUNCTION__);
-    return NULL;
+
+/*
+    fetch_all_sets of a batch reads the next statements after the error of a statement
+*/
+static int keeps_set_errors(Cursor *self)
+{
+    return self->sets != NULL && self->batch_size > 0;
 }
 
 
-static void Cursor_Dealloc(Cursor *self)
+/*
+    Returns 1 if the next result set is current, 0 if there aren't more result sets and -1 on error
+*/
+static int complete_more_results(Cursor *self, const char *fn_name)
 {
     PRINT_DEBUG_MESSAGE(__FUNCTION__);
 
-    if (self->state == OPENED || self->state == EXECUTED) {
-        free_cursor(self);
+    if (self->retcode == SQL_NO_DATA) {
+        release_slot(self->conn);
+        self->state = OPENED;
+        self->r_info.is_end = 1;
+        return 0;
     }
 
-    close_event(&self->event, &self->event_status);
+    if (check_error((PyObject *)self, fn_name)) {
+        // the reading of the batch goes on after the error of its statement, the slot is kept
+        if (!keeps_set_errors(self)) {
+            release_slot(self->conn);
+            self->state = OPENED;
+        }
+        return -1;
+    }
 
-    Py_CLEAR(self->conn);
-    PyObject_Del(self);
+    read_row_count(self);
+    self->state = EXECUTED;
+    return 1;
 }
 
 
-static PyAsyncMethods Cursor_Awaitable = {
-    .am_await = (unaryfunc)Cursor_Iter
-};
+static int is_sql_state(const SQLWCHAR *sql_state, const char *prefix)
+{
+    for (; *prefix; prefix++, sql_state++) {
+        if (*sql_state != (SQLWCHAR)*prefix) {
+            return 0;
+        }
+    }
 
+    return 1;
+}
 
-static PyObject* Cursor_Close(Cursor *self)
+
+/*
+    The lost connection and the cancelled or expired statement end the batch, its next statements aren't read
+*/
+static int is_batch_error(Cursor *self)
 {
-    PRINT_DEBUG_MESSAGE(__FUNCTION__);
+    SQLWCHAR sql_state[6];
+    SQLINTEGER native_error;
+    SQLSMALLINT message_len;
 
-    if (free_cursor(self) == -1) {
-        return NULL;
+    if (self->retcode != SQL_ERROR) {
+        return 0;  // e.g. the error of the conversion
     }
 
-    Py_RETURN_NONE;
+    SQLRETURN retcode = SQLGetDiagRecW(
+        SQL_HANDLE_STMT, self->handle, 1, sql_state, &native_error, NULL, 0, &message_len
+    );
+    if (!SQL_SUCCEEDED(retcode)) {
+        return 0;
+    }
+
+    return is_sql_state(sql_state, "08") || is_sql_state(sql_state, "HY008") || is_sql_state(sql_state, "HYT00");
 }
 
 
-static PyObject* Cursor_Exit(Cursor *self, PyObject* args)
+/*
+    The slot is kept for the next result set of fetch_all_sets
+*/
+static PyObject* next_result_set(Cursor *self)
 {
     PRINT_DEBUG_MESSAGE(__FUNCTION__);
 
-    PyObject *none = Cursor_Close(self);
+    self->state = EXECUTED;
 
-    PyObject *type, *value, *traceback;
-    if (PyArg_ParseTuple(args, "OOO", &type, &value, &traceback) && type != Py_None) {
+    if (start_more_results(self) == -1) {
+        Py_CLEAR(self->sets);
         return NULL;
     }
 
-    return none;
+    return Cursor_Next(self);
 }
 
 
-Py_ssize_t get_count_query_parameters(const wchar_t *query)
+/*
+    The error of a statement of the batch is kept in place of its result set and the next statements are read.
+    The error of the batch or of its last statement ends the reading, the sets are the result of the awaitable
+*/
+static PyObject* keep_set_error(Cursor *self)
 {
     PRINT_DEBUG_MESSAGE(__FUNCTION__);
-    
-    Py_ssize_t count = 0;
-    size_t string_length = wcslen(query);
-    for (size_t i = 0; i < string_length; i++) {
-        if (query[i] == '?') {
-            count++;
+
+    int is_end = is_batch_error(self);
+
+    PyObject *type, *value, *traceback;
+    PyErr_Fetch(&type, &value, &traceback);
+    PyErr_NormalizeException(&type, &value, &traceback);
+    if (value != NULL && traceback != NULL) {
+        PyException_SetTraceback(value, traceback);
+    }
+
+    int code = value != NULL ? PyList_Append(self->sets, value) : -1;
+    if (code == 0) {
+        Py_XDECREF(type);
+        Py_DECREF(value);
+        Py_XDECREF(traceback);
+
+        if (!is_end && PyList_GET_SIZE(self->sets) < self->batch_size) {
+            return next_result_set(self);
         }
+    } else if (value != NULL) {
+        // the error of the statement is raised instead of the error of the list
+        PyErr_Clear();
+        PyErr_Restore(type, value, traceback);
+    }
+
+    release_slot(self->conn);
+    self->state = OPENED;
+    self->r_info.is_end = 1;
+
+    if (code == -1) {
+        Py_CLEAR(self->sets);
+        return NULL;
     }
-    return count;
+
+    // the rest of the statements take the error of the batch
+    PyObject *sets = self->sets;
+    self->sets = NULL;
+    PyErr_SetObject(PyExc_StopIteration, sets);
+    Py_DECREF(sets);
+    return NULL;
 }
 
 
-int check_parameters_equality(const wchar_t *query, Py_ssize_t params_length)
+/*
+    The raised error of the execution is kept as the first result set of fetch_all_sets.
+    Returns -1 and keeps the error raised if the list isn't created
+*/
+static int keep_first_error(Cursor *self)
 {
-    PRINT_DEBUG_MESSAGE(__FUNCTION__);
-    
-    Py_ssize_t count_query_parameters = get_count_query_parameters(query);
+    PyObject *type, *value, *traceback;
+    PyErr_Fetch(&type, &value, &traceback);
+    PyErr_NormalizeException(&type, &value, &traceback);
+    if (value == NULL) {
+        return -1;
+    }
 
-    if (count_query_parameters != params_length) {
-        PyErr_Format(
-            PyExc_TypeError,
-            "(%s) The query takes %lld arguments, but %lld were given",
-            __FUNCTION__, count_query_parameters, (long long)params_length
-        );
+    if (traceback != NULL) {
+        PyException_SetTraceback(value, traceback);
+    }
+
+    self->sets = PyList_New(1);
+    if (self->sets == NULL) {
+        PyErr_Clear();
+        PyErr_Restore(type, value, traceback);
         return -1;
     }
 
+    PyList_SET_ITEM(self->sets, 0, value);
+    Py_XDECREF(type);
+    Py_XDECREF(traceback);
+
+    // the statement keeps the slot until the last result set
+    self->r_info.row_count = -1;
+    self->state = EXECUTED;
     return 0;
 }
 
 
-#ifdef __linux__
-void* t_sql_exec_direct_w(void *handle)
+/*
+    Keeps the rows of the fetched result set, or the row count of a statement without a result set,
+    and goes to the next result set of fetch_all_sets
+*/
+static PyObject* add_result_set(Cursor *self, PyObject *results)
 {
     PRINT_DEBUG_MESSAGE(__FUNCTION__);
-    
-    HANDLE event = (HANDLE)handle;
-
-    Cursor *cursor = event->obj;
 
-    char16_t *query = wctouc(cursor->query);
-    if (query == NULL) {
-        cursor->retcode = -1;
-        goto clean_up;
+    PyObject *item = results;
+    if (!self->r_info.column_count) {
+        Py_DECREF(results);
+        item = PyLong_FromSsize_t((Py_ssize_t)self->r_info.row_count);
     }
 
-    cursor->retcode = SQLExecDirectW(cursor->handle, (SQLWCHAR *)query, SQL_NTS);
-    free(query);
+    if (item == NULL || PyList_Append(self->sets, item) == -1) {
+        Py_XDECREF(item);
+        finish_fetch(self, 1);
+        Py_CLEAR(self->sets);
+        return NULL;
+    }
+    Py_DECREF(item);
 
-    clean_up:
-        event->state = WAIT_OBJECT_0;
-        pthread_exit(0);
+    return next_result_set(self);
 }
-#endif
 
 
-int prepare_execute(Cursor *self, const wchar_t *query, PyObject *params, Py_ssize_t params_length, long long timeout)
+/*
+    Completes SQLMoreResults of nextset_async or fetch_all_sets, the latter fetches the next result set
+*/
+static PyObject* complete_nextset(Cursor *self)
 {
     PRINT_DEBUG_MESSAGE(__FUNCTION__);
 
-    if (self->conn->state != CONNECTED ) {
-        PyErr_Format(PyExc_Exception, "(%s) The connection isn't established", __FUNCTION__);
-        return -1;
+    int code = complete_more_results(self, "Cursor_Next::SQLMoreResults");
+    if (code == -1) {
+        if (keeps_set_errors(self)) {
+            return keep_set_error(self);
+        }
+        Py_CLEAR(self->sets);
+        return NULL;
     }
 
-    if (self->state == TO_OPEN || self->state == CLOSED) {
-        PyErr_Format(PyExc_Exception, "(%s) The cursor isn't opened", __FUNCTION__);
-        return -1;
+    if (self->sets == NULL) {
+        PyErr_SetObject(PyExc_StopIteration, code ? Py_True : Py_False);
+        return NULL;
     }
 
-    if (self->conn->runned_cursors >= self->conn->mca) {
-        PyErr_Format(
-            PyExc_Exception,
-            "(%s) The number of cursors from one connection can't exceed max concurrent activities (%d)",
-            __FUNCTION__, self->conn->mca
-        );
-        return -1;
+    if (code) {
+        if (prepare_fetch(self, 0, 0) == -1) {
+            finish_fetch(self, 1);
+            Py_CLEAR(self->sets);
+            return NULL;
+        }
+        return Cursor_Next(self);
     }
 
-    parameter *parameters = NULL;
-    if (params_length) {
-        parameters = (parameter *)malloc(sizeof(parameter) * params_length);
-        if (parameters == NULL) {
-            PyErr_NoMemory();
-            return -1;
-        }
+    PyObject *sets = self->sets;
+    self->sets = NULL;
+    PyErr_SetObject(PyExc_StopIteration, sets);
+    Py_DECREF(sets);
+    return NULL;
+}
 
-        for (Py_ssize_t parameter_number = 0; parameter_number < params_length; parameter_number++) {
-            parameters[parameter_number].alloc_str = 0;
-            parameters[parameter_number].indicator = SQL_NTS;
-            PyObject *param = PyTuple_GetItem(params, parameter_number);
-            if (bind_parameter(self, parameter_number, param, &parameters[parameter_number]) == -1) {
-                if (!PyErr_Occurred()) {
-                    PyErr_Format(
-                        PyExc_TypeError,
-                        "(%s) The parameter type %lld in the query isn't supported for passing to SQL",
-                        __FUNCTION__, parameter_number + 1
-                    );
-                }
-                return -1;
-            }
-        }
-    }
-    self->p_info.parameters = parameters;
-    self->p_info.params_length = params_length;
-    self->query = query;
-    self->timeout = timeout;
 
-    self->retcode = SQLSetStmtAttr(self->handle, SQL_ATTR_QUERY_TIMEOUT, (SQLPOINTER)self->timeout, SQL_IS_INTEGER);
-    CHECK_ERROR("prepare_execute::SQLSetStmtAttr::SQL_ATTR_QUERY_TIMEOUT ");
+static PyObject* complete_fetch(Cursor *self)
+{
+    PRINT_DEBUG_MESSAGE(__FUNCTION__);
 
-    #ifdef _WIN32
-    self->retcode = SQLSetStmtAttr(self->handle, SQL_ATTR_ASYNC_ENABLE, (SQLPOINTER)SQL_ASYNC_ENABLE_ON, SQL_IS_INTEGER);
-    CHECK_ERROR("prepare_execute::SQLSetStmtAttr::SQL_ATTR_ASYNC_ENABLE");
+    row_batch *batch = self->batch;
+    self->batch = NULL;
 
-    self->event = CreateEvent(NULL, FALSE, FALSE, NULL);
+    close_event(&self->event, &self->event_status);
+
+    PyObject *results = convert_rows(self, batch);
+    if (results != NULL && self->sets != NULL) {
+        free_batch(self, batch);
+        return add_result_set(self, results);
+    }
+
+    if (results == NULL && keeps_set_errors(self)) {
+        free_batch(self, batch);
+        return keep_set_error(self);
+    }
+
+    // an error ends the fetching like in fetchall
+    finish_fetch(self, results == NULL || batch->is_end);
+    free_batch(self, batch);
+
+    if (results == NULL) {
+        Py_CLEAR(self->sets);
+        return NULL;
+    }
+
+    if (self->state == OPENED) {
+        self->r_info.is_end = 1;
+    }
+
+    // StopIteration(results), a tuple prevents unpacking of the list
+    PyObject *value = PyTuple_Pack(1, results);
+    Py_DECREF(results);
+    if (value == NULL) {
+        return NULL;
+    }
+
+    PyErr_SetObject(PyExc_StopIteration, value);
+    Py_DECREF(value);
+    return NULL;
+}
+
+
+static void end_prefetch(Cursor *self)
+{
+    PRINT_DEBUG_MESSAGE(__FUNCTION__);
+
+    stop_prefetch(self);
+    finish_fetch(self, 1);
+}
+
+
+static PyObject* next_prefetched(Cursor *self)
+{
+    PRINT_DEBUG_MESSAGE(__FUNCTION__);
+
+    PyObject *waiter = NULL;
+    row_batch *batch;
+    int is_end;
+
+    for (;;) {
+        // the state is reset before taking a batch, so a batch published after it wakes the waiting
+        self->event_status = 258;
+        #ifdef __linux__
+        self->event->state = 258;
+        #endif
+
+        batch = pop_batch(self, &is_end);
+        if (fill_batches(self) == -1) {
+            free_batch(self, batch);
+            end_prefetch(self);
+            return NULL;
+        }
+
+        #ifdef _WIN32
+        if (batch == NULL && !is_end) {
+            batch = pop_batch(self, &is_end);  // it's just filled
+        }
+        #endif
+
+        if (batch != NULL) {
+            break;
+        }
+
+        if (is_end) {
+            int no_memory = self->prefetch->no_memory;
+            end_prefetch(self);
+            if (no_memory) {
+                return PyErr_NoMemory();
+            }
+
+            self->r_info.is_end = 1;
+            PyErr_SetNone(PyExc_StopAsyncIteration);
+            return NULL;
+        }
+
+        switch (wait_for_worker(self, &waiter)) {
+            case EVENT_READY:
+                continue;
+            case EVENT_WAIT:
+                return waiter;
+            default:
+                return NULL;
+        }
+    }
+
+    PyObject *results = convert_rows(self, batch);
+    free_batch(self, batch);
+    if (results == NULL) {
+        end_prefetch(self);
+        return NULL;
+    }
+
+    PyObject *value = PyTuple_Pack(1, results);
+    Py_DECREF(results);
+    if (value == NULL) {
+        return NULL;
+    }
+
+    PyErr_SetObject(PyExc_StopIteration, value);
+    Py_DECREF(value);
+    return NULL;
+}
+
+
+/*
+    Keeps the statuses of the executed batch and starts the next one, the last one returns the statuses of all rows
+*/
+static PyObject* complete_batch(Cursor *self)
+{
+    PRINT_DEBUG_MESSAGE(__FUNCTION__);
+
+    batch_info *many = self->many;
+
+    for (Py_ssize_t i = 0; i < many->count; i++) {
+        // the rows after an error can be left unprocessed
+        PyObject *status = PyLong_FromLong((SQLULEN)i < many->processed ? many->status[i] : SQL_PARAM_UNUSED);
+        if (status == NULL || PyList_Append(many->statuses, status) == -1) {
+            Py_XDECREF(status);
+            goto clean_up;
+        }
+        Py_DECREF(status);
+    }
+    many->offset += many->count;
+
+    // the results of the batch aren't taken
+    SQLFreeStmt(self->handle, SQL_CLOSE);
+    release_slot(self->conn);
+    self->state = OPENED;
+
+    if (many->offset < many->total) {
+        // the statement is prepared by the first batch
+        self->exec_mode = EXEC_EXECUTE;
+        if (bind_batch(self) == -1 || submit_execute(self) == -1) {
+            end_batches(self);
+            return NULL;
+        }
+
+        self->state = TO_EXECUTE;
+        return Cursor_Next(self);
+    }
+
+    PyObject *statuses = many->statuses;
+    Py_INCREF(statuses);
+    end_batches(self);
+
+    PyErr_SetObject(PyExc_StopIteration, statuses);
+    Py_DECREF(statuses);
+    return NULL;
+
+    clean_up:
+        SQLFreeStmt(self->handle, SQL_CLOSE);
+        release_slot(self->conn);
+        end_batches(self);
+        self->state = OPENED;
+        return NULL;
+}
+
+
+/*
+    The worker sends the current chunks of the streamed parameters
+*/
+static int submit_put_data(Cursor *self)
+{
+    PRINT_DEBUG_MESSAGE(__FUNCTION__);
+
+    #ifdef _WIN32
+    // the statement is synchronous after the execution
+    Py_BEGIN_ALLOW_THREADS
+    put_streams(self);
+    Py_END_ALLOW_THREADS
+    self->event_status = WAIT_OBJECT_0;
+
+    #elif __linux__
+    self->event = create_t_event();
     self->event_status = 258;
-    CHECK_EVENT_ERROR(self->event, "prepare_execute::CreateEvent");
+    CHECK_EVENT_ERROR(self->event, "submit_put_data::create_t_event");
+
+    self->event->obj = self;
+
+    if (thread_pool_submit(self->conn->pool, t_sql_put_data, self->event) == -1) {
+        close_event(&self->event, &self->event_status);
+        PyErr_Format(PyExc_Exception, "(%s) The worker pool can't accept the task", __FUNCTION__);
+        return -1;
+    }
+    #endif
+
+    return 0;
+}
+
+
+/*
+    The execution asks for the data of the streamed parameters: the loop reads the next chunk of a file
+    or an iterator and the worker sends it, until the statement is executed.
+    Returns EVENT_WAIT with the waiter of the worker or the asynchronous reading
+*/
+static int send_streams(Cursor *self, PyObject **waiter)
+{
+    PRINT_DEBUG_MESSAGE(__FUNCTION__);
+
+    for (;;) {
+        if (self->event != NULL) {
+            int code = wait_for_worker(self, waiter);
+            if (code != EVENT_READY) {
+                return code;
+            }
+            close_event(&self->event, &self->event_status);
+        }
+
+        if (self->retcode != SQL_NEED_DATA) {
+            return EVENT_READY;
+        }
+
+        int code = read_chunk(self->p_info.streamed->stream, waiter);
+        if (code != EVENT_READY) {
+            return code;
+        }
+
+        if (submit_put_data(self) == -1) {
+            return -1;
+        }
+    }
+}
+
+
+static PyObject* Cursor_Next(Cursor *self)
+{
+    PRINT_DEBUG_MESSAGE(__FUNCTION__);
+
+    PyObject *waiter = NULL;
+
+    if (self->conn->state != CONNECTED ) {
+        PyErr_Format(PyExc_Exception, "(%s) The connection isn't established", __FUNCTION__);
+        return NULL;
+    }
+
+    if (self->state == EXECUTED) {
+        PyErr_Format(PyExc_Exception, "(%s) The cursor is already executed, You need to take results", __FUNCTION__);
+        return NULL;
+    }
+
+    if (self->state == CLOSED) {
+        PyErr_Format(PyExc_Exception, "(%s) The cursor is already closed", __FUNCTION__);
+        return NULL;
+    }
+
+    if (self->state == TO_EXECUTE) {
+        #ifdef _WIN32
+        check_timer_entry(&self->timer);
+        #endif
+
+        if (!self->p_info.is_putting) {
+            switch (wait_for_worker(self, &waiter)) {
+                case EVENT_READY:
+                    break;
+                case EVENT_WAIT:
+                    return waiter;
+                default:
+                    return NULL;
+            }
+
+            if (self->is_queued) {
+                // the statement is woken without the start after the release of a slot
+                drop_queued(self);
+                PyErr_Format(PyExc_Exception, "(%s) Failed to start the queued statement", __FUNCTION__);
+                return NULL;
+            }
+
+            #ifdef _WIN32
+            // the preparing is synchronous, SQLMoreResults too
+            if (
+                self->exec_mode != EXEC_PREPARE && self->exec_mode != EXEC_NONE && self->exec_mode != EXEC_MORE_RESULTS
+            ) {
+                SQLCompleteAsync(self->handle_type, self->handle, &self->retcode);
+                PRINT_DEBUG_MESSAGE("SQLCompleteAsync");
+            }
+
+            if (self->retcode == SQL_NEED_DATA && self->p_info.stream_count) {
+                SQLSetStmtAttr(self->handle, SQL_ATTR_ASYNC_ENABLE, (SQLPOINTER)SQL_ASYNC_ENABLE_OFF, SQL_IS_INTEGER);
+                close_event(&self->event, &self->event_status);
+                self->p_info.is_putting = 1;
+                Py_BEGIN_ALLOW_THREADS
+                put_streams(self);
+                Py_END_ALLOW_THREADS
+            }
+            #elif __linux__
+            if (self->retcode == SQL_NEED_DATA && self->p_info.stream_count) {
+                close_event(&self->event, &self->event_status);
+                self->p_info.is_putting = 1;
+            }
+            #endif
+        }
+
+        if (self->p_info.is_putting) {
+            switch (send_streams(self, &waiter)) {
+                case EVENT_READY:
+                    break;
+                case EVENT_WAIT:
+                    return waiter;
+                default:
+                    if (self->event != NULL) {
+                        return NULL;  // the worker is running
+                    }
+
+                    // the execution waits for the data, it's cancelled
+                    SQLCancel(self->handle);
+                    stop_deadline(self->conn, &self->timer);
+                    release_streams(&self->p_info);
+                    release_views(&self->p_info);
+                    end_batches(self);
+                    forget_failed_prepare(self);
+                    release_slot(self->conn);
+                    self->state = OPENED;
+                    return NULL;
+            }
+        }
+        release_streams(&self->p_info);
+        release_views(&self->p_info);
+
+        self->state = EXECUTED;
+
+        close_event(&self->event, &self->event_status);
+        PRINT_DEBUG_MESSAGE("Cursor_Next::Close Handle");
+        end_polling(self);
+
+        stop_deadline(self->conn, &self->timer);
+        if (self->exec_mode == EXEC_MORE_RESULTS) {
+            return complete_nextset(self);
+        }
+
+        if (self->timer.is_fired && !SQL_SUCCEEDED(self->retcode)) {
+            // the statement is canceled by SQLCancel
+            self->timer.is_fired = 0;
+            end_batches(self);
+            forget_failed_prepare(self);
+            release_slot(self->conn);
+            self->state = OPENED;
+            PyErr_Format(PyExc_TimeoutError, "(%s) The query timeout expired", __FUNCTION__);
+            return NULL;
+        }
+
+        if (self->retcode == SQL_NO_DATA) {
+            self->retcode = SQL_SUCCESS;  // e.g. UPDATE without the affected rows
+        }
+
+        if (check_error((PyObject *)self, "Cursor_Next::SQLCompleteAsync")) {
+            if (self->batch_size > 1 && !is_batch_error(self) && keep_first_error(self) == 0) {
+                // the error of the first statement of the batch is its result, fetch_all_sets reads the next ones
+                PyErr_SetObject(PyExc_StopIteration, (PyObject *)self);
+                return NULL;
+            }
+
+            // the failed statement doesn't keep the connection busy
+            end_batches(self);
+            forget_failed_prepare(self);
+            release_slot(self->conn);
+            self->state = OPENED;
+            return NULL;
+        }
+
+        if (self->many != NULL) {
+            return complete_batch(self);
+        }
+
+        if (self->exec_mode == EXEC_PREPARE || self->exec_mode == EXEC_NONE) {
+            // the statement is only prepared, there are no results
+            if (self->exec_mode == EXEC_PREPARE) {
+                release_slot(self->conn);
+            }
+            self->state = OPENED;
+        } else {
+            read_row_count(self);
+        }
+
+        PyErr_SetObject(PyExc_StopIteration, (PyObject *)self);
+        return NULL;
+    }
+
+    if (self->state == TO_FETCH) {
+        if (self->prefetch != NULL) {
+            return next_prefetched(self);
+        }
+
+        switch (wait_for_worker(self, &waiter)) {
+            case EVENT_READY:
+                break;
+            case EVENT_WAIT:
+                return waiter;
+            default:
+                return NULL;
+        }
+
+        return complete_fetch(self);
+    }
+
+    PyErr_Format(PyExc_TypeError, "(%s) A coroutine was expected", __FUNCTION__);
+    return NULL;
+}
+
+
+static void Cursor_Dealloc(Cursor *self)
+{
+    PRINT_DEBUG_MESSAGE(__FUNCTION__);
+
+    Connection *conn = self->conn;
+    int is_kept = 0;
+
+    // the slot, the free lists and the statement cache belong to the connection, the dealloc runs on any thread
+    Py_BEGIN_CRITICAL_SECTION(conn);
+    if (self->prefetch != NULL) {
+        end_prefetch(self);
+    }
+
+    if (self->state == TO_EXECUTE || self->state == TO_FETCH) {
+        abort_operation(self);
+    }
+
+    stop_deadline(conn, &self->timer);
+
+    // the statement handle is already released with the connection
+    if (conn->state == CONNECTED && (self->state == OPENED || self->state == EXECUTED)) {
+        free_cursor(self);
+    }
+
+    close_event(&self->event, &self->event_status);
+    free_batch(self, self->batch);
+    free_columns(self);
+    end_batches(self);
+    free_parameters(self);
+    arena_free(&self->memory);
+    Py_CLEAR(self->sets);
+    PY_MEM_FREE_TO_NULL(self->prepared_query);
+
+    // the memory is kept by the connection for the next cursor, it's freed with the connection
+    if (conn->state == CONNECTED && conn->free_cursor_count < FREE_LIST_SIZE) {
+        conn->free_cursors[conn->free_cursor_count++] = self;
+        is_kept = 1;
+    }
+    Py_END_CRITICAL_SECTION();
+
+    PyTypeObject *type = Py_TYPE(self);
+    if (!is_kept) {
+        type->tp_free((PyObject *)self);
+    }
+    Py_DECREF(conn);
+    Py_DECREF(type);  // the instances of a heap type keep it
+}
+
+
+static PyObject* Cursor_ANext(Cursor *self)
+{
+    PRINT_DEBUG_MESSAGE(__FUNCTION__);
+
+    if (self->prefetch == NULL) {
+        PyErr_Format(PyExc_TypeError, "(%s) The cursor isn't prefetching, You need to call prefetch", __FUNCTION__);
+        return NULL;
+    }
+
+    Py_INCREF(self);
+    return (PyObject *)self;
+}
+
+
+static PyObject* Cursor_Close(Cursor *self)
+{
+    PRINT_DEBUG_MESSAGE(__FUNCTION__);
+
+    if (free_cursor(self) == -1) {
+        return NULL;
+    }
+
+    Py_RETURN_NONE;
+}
+
+
+static PyObject* Cursor_Exit(Cursor *self, PyObject* args)
+{
+    PRINT_DEBUG_MESSAGE(__FUNCTION__);
+
+    PyObject *none = Cursor_Close(self);
+
+    PyObject *type, *value, *traceback;
+    if (PyArg_ParseTuple(args, "OOO", &type, &value, &traceback) && type != Py_None) {
+        return NULL;
+    }
+
+    return none;
+}
+
+
+#ifdef __linux__
+/*
+    The query is converted to UTF-16 of SQLWCHAR in the memory of the statement
+*/
+static char16_t* convert_query(Cursor *self)
+{
+    size_t length = wcslen(self->query);
+
+    // the code points above U+FFFF take two units
+    char16_t *query = (char16_t *)arena_alloc(&self->memory, sizeof(char16_t) * (length * 2 + 1));
+    if (query == NULL) {
+        return NULL;
+    }
+
+    size_t out = 0;
+    for (size_t i = 0; i < length; i++) {
+        unsigned int ch = (unsigned int)self->query[i];
+        if (ch > 0xFFFF) {
+            ch -= 0x10000;
+            query[out++] = (char16_t)(0xD800 + (ch >> 10));
+            query[out++] = (char16_t)(0xDC00 + (ch & 0x3FF));
+        } else {
+            query[out++] = (char16_t)ch;
+        }
+    }
+    query[out++] = 0;
+
+    arena_trim(&self->memory, query, sizeof(char16_t) * out);
+    return query;
+}
+
+
+void* t_sql_execute(void *handle)
+{
+    PRINT_DEBUG_MESSAGE(__FUNCTION__);
+    
+    HANDLE event = (HANDLE)handle;
+
+    Cursor *cursor = event->obj;
+    char16_t *query = NULL;
+
+    // the prepared statement is executed without its text
+    if (cursor->exec_mode != EXEC_EXECUTE) {
+        query = convert_query(cursor);
+        if (query == NULL) {
+            cursor->retcode = -1;
+            goto clean_up;
+        }
+    }
+
+    switch (cursor->exec_mode) {
+        case EXEC_DIRECT:
+            cursor->retcode = SQLExecDirectW(cursor->handle, (SQLWCHAR *)query, SQL_NTS);
+            break;
+        case EXEC_PREPARE:
+        case EXEC_PREPARE_EXECUTE:
+            cursor->retcode = SQLPrepareW(cursor->handle, (SQLWCHAR *)query, SQL_NTS);
+            if (cursor->exec_mode == EXEC_PREPARE || !SQL_SUCCEEDED(cursor->retcode)) {
+                break;
+            }
+            // fall through
+        case EXEC_EXECUTE:
+            cursor->retcode = SQLExecute(cursor->handle);
+            break;
+    }
+
+    if (cursor->retcode == SQL_NEED_DATA) {
+        put_streams(cursor);
+    }
+
+    clean_up:
+        set_t_event(event);
+        return NULL;
+}
+
+
+/*
+    The poller calls it until the driver stops returning SQL_STILL_EXECUTING
+*/
+int t_sql_exec_direct_poll(poll_entry *entry)
+{
+    HANDLE event = (HANDLE)entry->arg;
+
+    Cursor *cursor = event->obj;
+
+    SQLRETURN retcode = SQLExecDirectW(cursor->handle, (SQLWCHAR *)cursor->polled_query, SQL_NTS);
+    if (retcode == SQL_STILL_EXECUTING) {
+        return 1;
+    }
+
+    cursor->retcode = retcode;
+    set_t_event(event);
+    return 0;
+}
+
+
+void* t_sql_put_data(void *handle)
+{
+    PRINT_DEBUG_MESSAGE(__FUNCTION__);
+
+    HANDLE event = (HANDLE)handle;
+
+    Cursor *cursor = event->obj;
+    put_streams(cursor);
+
+    set_t_event(event);
+    return NULL;
+}
+
+
+void* t_sql_fetch(void *handle)
+{
+    PRINT_DEBUG_MESSAGE(__FUNCTION__);
+
+    HANDLE event = (HANDLE)handle;
+
+    Cursor *cursor = event->obj;
+    fetch_rows(cursor, cursor->batch);
+
+    set_t_event(event);
+    return NULL;
+}
+
+
+void* t_sql_more_results(void *handle)
+{
+    PRINT_DEBUG_MESSAGE(__FUNCTION__);
+
+    HANDLE event = (HANDLE)handle;
+
+    Cursor *cursor = event->obj;
+    cursor->retcode = SQLMoreResults(cursor->handle);
+
+    set_t_event(event);
+    return NULL;
+}
+
+
+/*
+    The statement is asynchronous only for the execution, the results are fetched by the worker pool.
+    Returns -1 if the driver refuses the asynchronous mode
+*/
+static int start_polling(Cursor *self)
+{
+    PRINT_DEBUG_MESSAGE(__FUNCTION__);
+
+    self->polled_query = convert_query(self);
+    if (self->polled_query == NULL) {
+        return -1;
+    }
+
+    SQLRETURN retcode = SQLSetStmtAttr(
+        self->handle, SQL_ATTR_ASYNC_ENABLE, (SQLPOINTER)SQL_ASYNC_ENABLE_ON, SQL_IS_INTEGER
+    );
+    if (!SQL_SUCCEEDED(retcode)) {
+        self->polled_query = NULL;
+        return -1;
+    }
+
+    self->poll.arg = self->event;
+    self->is_polled = 1;
+    return 0;
+}
+#endif
+
+
+static void end_polling(Cursor *self)
+{
+    #ifdef __linux__
+    if (!self->is_polled) {
+        return;
+    }
+
+    SQLSetStmtAttr(self->handle, SQL_ATTR_ASYNC_ENABLE, (SQLPOINTER)SQL_ASYNC_ENABLE_OFF, SQL_IS_INTEGER);
+    self->polled_query = NULL;  // it's freed with the memory of the statement
+    self->is_polled = 0;
+    #endif
+}
+
+
+static int has_free_slot(Connection *conn)
+{
+    return conn->mca == 0 || conn->runned_cursors < conn->mca;
+}
+
+
+/*
+    The statements above the max concurrent activities of the connection wait in its queue
+*/
+static void enqueue_cursor(Cursor *self)
+{
+    Connection *conn = self->conn;
+
+    self->next_queued = NULL;
+    if (conn->queue_tail != NULL) {
+        conn->queue_tail->next_queued = self;
+    } else {
+        conn->queue_head = self;
+    }
+    conn->queue_tail = self;
+    self->is_queued = 1;
+}
+
+
+static Cursor* dequeue_cursor(Connection *conn)
+{
+    Cursor *cursor = conn->queue_head;
+
+    conn->queue_head = cursor->next_queued;
+    if (conn->queue_head == NULL) {
+        conn->queue_tail = NULL;
+    }
+    cursor->next_queued = NULL;
+
+    return cursor;
+}
+
+
+/*
+    The statement is dropped before its start, so it doesn't hold a slot
+*/
+static void drop_queued(Cursor *self)
+{
+    PRINT_DEBUG_MESSAGE(__FUNCTION__);
+
+    Connection *conn = self->conn;
+    Cursor *prev = NULL;
+
+    // a woken one has already left the queue
+    for (Cursor *cursor = conn->queue_head; cursor != NULL; prev = cursor, cursor = cursor->next_queued) {
+        if (cursor == self) {
+            if (prev != NULL) {
+                prev->next_queued = self->next_queued;
+            } else {
+                conn->queue_head = self->next_queued;
+            }
+            if (conn->queue_tail == self) {
+                conn->queue_tail = prev;
+            }
+            break;
+        }
+    }
+
+    self->next_queued = NULL;
+    self->is_queued = 0;
+    self->is_cancelled = 0;
+    close_event(&self->event, &self->event_status);
+    end_batches(self);
+    forget_failed_prepare(self);
+    self->state = OPENED;
+}
+
+
+/*
+    Wakes the awaitable of a queued statement without its start, the awaitable raises an error
+*/
+static void wake_queued(Cursor *self)
+{
+    #ifdef _WIN32
+    SetEvent(self->event);
+    #elif __linux__
+    set_t_event(self->event);
+    #endif
+}
+
+
+/*
+    A finished statement gives its slot to the first queued one
+*/
+void release_slot(Connection *conn)
+{
+    PRINT_DEBUG_MESSAGE(__FUNCTION__);
+
+    conn->runned_cursors--;
+
+    if (conn->queue_head == NULL) {
+        return;
+    }
+
+    // the slot can be released on the error path of another statement
+    PyObject *type, *value, *traceback;
+    PyErr_Fetch(&type, &value, &traceback);
+
+    while (conn->queue_head != NULL && has_free_slot(conn)) {
+        Cursor *cursor = dequeue_cursor(conn);
+
+        if (start_execute(cursor) == -1) {
+            PyErr_Clear();
+            wake_queued(cursor);
+        } else {
+            cursor->is_queued = 0;
+        }
+    }
+
+    PyErr_Restore(type, value, traceback);
+}
+
+
+void fail_queued_cursors(Connection *conn)
+{
+    PRINT_DEBUG_MESSAGE(__FUNCTION__);
+
+    while (conn->queue_head != NULL) {
+        wake_queued(dequeue_cursor(conn));
+    }
+}
+
+
+/*
+    Chooses how the statement is executed, the handle prepared for the query is taken from the cache.
+    The handle prepared for another query returns to the cache
+*/
+static int select_statement(Cursor *self, const wchar_t *query, int is_prepare_only)
+{
+    PRINT_DEBUG_MESSAGE(__FUNCTION__);
+
+    Connection *conn = self->conn;
+
+    if (self->prepared_query != NULL && wcscmp(self->prepared_query, query) == 0) {
+        conn->cache.hits++;
+        self->exec_mode = is_prepare_only ? EXEC_NONE : EXEC_EXECUTE;
+        return 0;
+    }
+
+    // the batches of executemany execute one prepared statement
+    if (!is_prepare_only && !conn->cache.max_size && self->many == NULL) {
+        // SQLExecDirectW replaces the prepared statement of the handle
+        PY_MEM_FREE_TO_NULL(self->prepared_query);
+        self->exec_mode = EXEC_DIRECT;
+        return 0;
+    }
+
+    const wchar_t *key;
+    SQLHSTMT handle = take_prepared_statement(conn, query, &key);
+
+    if (handle != SQL_NULL_HSTMT) {
+        self->exec_mode = is_prepare_only ? EXEC_NONE : EXEC_EXECUTE;
+    } else {
+        size_t size = (wcslen(query) + 1) * sizeof(wchar_t);
+        wchar_t *copy = PyMem_Malloc(size);
+        if (copy == NULL) {
+            PyErr_NoMemory();
+            return -1;
+        }
+        memcpy(copy, query, size);
+        key = copy;
+        self->exec_mode = is_prepare_only ? EXEC_PREPARE : EXEC_PREPARE_EXECUTE;
+
+        if (self->prepared_query == NULL) {
+            // the handle isn't prepared, so it's prepared for the query
+            self->prepared_query = key;
+            return 0;
+        }
+
+        // the handle stays prepared for its query in the cache
+        SQLRETURN retcode = take_statement(conn, &handle);
+        if (!SQL_SUCCEEDED(retcode)) {
+            PyMem_Free(copy);
+            conn->retcode = retcode;
+            check_error((PyObject *)conn, "select_statement::SQLAllocHandle::SQL_HANDLE_STMT");
+            return -1;
+        }
+    }
+
+    // the bindings stay with the handle, the next cursor of the handle binds its own parameters
+    free_parameters(self);
+    keep_statement(conn, self->handle, self->prepared_query);
+    self->handle = handle;
+    self->prepared_query = key;
+    return 0;
+}
+
+
+static int check_execute_state(Cursor *self, const char *fn_name)
+{
+    if (self->conn->state != CONNECTED ) {
+        PyErr_Format(PyExc_Exception, "(%s) The connection isn't established", fn_name);
+        return -1;
+    }
+
+    if (self->state == TO_OPEN || self->state == CLOSED) {
+        PyErr_Format(PyExc_Exception, "(%s) The cursor isn't opened", fn_name);
+        return -1;
+    }
+
+    if (self->is_cancelled) {
+        abort_operation(self);  // the cancelled worker is still finishing
+    }
+
+    if (self->state == TO_EXECUTE || self->state == TO_FETCH) {
+        PyErr_Format(PyExc_Exception, "(%s) The cursor is busy, You need to await it", fn_name);
+        return -1;
+    }
+
+    return 0;
+}
+
+
+/*
+    Binds the next rows of executemany by column, the driver executes them by one SQLExecute
+*/
+static int bind_batch(Cursor *self)
+{
+    PRINT_DEBUG_MESSAGE(__FUNCTION__);
+
+    batch_info *many = self->many;
+    PyObject **rows = many->rows != NULL ? &PyTuple_GET_ITEM(many->rows, many->offset) : NULL;
+
+    free_parameter_arrays(many);
+    free_parameters(self);  // the arrays replace the bindings of the single parameters
+    many->count = many->total - many->offset;
+    if (many->count > many->size) {
+        many->count = many->size;
+    }
+    many->processed = 0;
+
+    self->retcode = SQLSetStmtAttr(
+        self->handle, SQL_ATTR_PARAM_BIND_TYPE, (SQLPOINTER)SQL_PARAM_BIND_BY_COLUMN, SQL_IS_INTEGER
+    );
+    CHECK_ERROR("bind_batch::SQLSetStmtAttr::SQL_ATTR_PARAM_BIND_TYPE");
+
+    self->retcode = SQLSetStmtAttr(
+        self->handle, SQL_ATTR_PARAMSET_SIZE, (SQLPOINTER)(SQLULEN)many->count, SQL_IS_INTEGER
+    );
+    CHECK_ERROR("bind_batch::SQLSetStmtAttr::SQL_ATTR_PARAMSET_SIZE");
+
+    self->retcode = SQLSetStmtAttr(self->handle, SQL_ATTR_PARAM_STATUS_PTR, many->status, SQL_IS_POINTER);
+    CHECK_ERROR("bind_batch::SQLSetStmtAttr::SQL_ATTR_PARAM_STATUS_PTR");
+
+    self->retcode = SQLSetStmtAttr(self->handle, SQL_ATTR_PARAMS_PROCESSED_PTR, &many->processed, SQL_IS_POINTER);
+    CHECK_ERROR("bind_batch::SQLSetStmtAttr::SQL_ATTR_PARAMS_PROCESSED_PTR");
+
+    if (many->params_length) {
+        many->arrays = PyMem_Calloc(many->params_length, sizeof(parameter_array));
+        if (many->arrays == NULL) {
+            PyErr_NoMemory();
+            return -1;
+        }
+    }
+
+    for (Py_ssize_t parameter_number = 0; parameter_number < many->params_length; parameter_number++) {
+        parameter_array *array = &many->arrays[parameter_number];
+        int result = many->columns != NULL
+            ? bind_column_array(self, parameter_number, &many->columns[parameter_number], many->offset, many->count, array)
+            : bind_parameter_array(self, parameter_number, rows, many->count, array);
+        if (result == -1) {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+
+int prepare_execute(
+    Cursor *self, const wchar_t *query, PyObject *params, Py_ssize_t params_length, double timeout, int is_prepare_only
+)
+{
+    PRINT_DEBUG_MESSAGE(__FUNCTION__);
+
+    if (check_execute_state(self, __FUNCTION__) == -1) {
+        return -1;
+    }
+
+    arena_reset(&self->memory);  // the buffers of the previous statement
+    release_streams(&self->p_info);
+    release_views(&self->p_info);
+
+    Py_CLEAR(self->sets);  // the kept error of the first statement of a batch
+
+    if (self->state == EXECUTED || self->r_info.is_end) {
+        // the rows, which weren't taken, and the next result sets are discarded
+        SQLFreeStmt(self->handle, SQL_CLOSE);
+        if (self->state == EXECUTED) {
+            release_slot(self->conn);
+        }
+        self->state = OPENED;
+    }
+
+    // the parameters are bound to the selected handle
+    if (select_statement(self, query, is_prepare_only) == -1) {
+        return -1;
+    }
+
+    if (self->many != NULL && bind_batch(self) == -1) {
+        return -1;
+    }
+
+    // the parameters of the last execution of the handle keep their bindings, only the new values are written
+    if (params_length != self->p_info.params_length) {
+        free_parameters(self);
+    }
+
+    if (params_length && self->p_info.parameters == NULL) {
+        self->p_info.parameters = (parameter *)calloc(params_length, sizeof(parameter));
+        if (self->p_info.parameters == NULL) {
+            PyErr_NoMemory();
+            return -1;
+        }
+        self->p_info.params_length = params_length;
+    }
+
+    if (params_length) {
+        parameter *parameters = self->p_info.parameters;
+
+        for (Py_ssize_t parameter_number = 0; parameter_number < params_length; parameter_number++) {
+            parameters[parameter_number].indicator = SQL_NTS;
+            PyObject *param = PyTuple_GetItem(params, parameter_number);
+            if (bind_parameter(self, parameter_number, param, &parameters[parameter_number]) == -1) {
+                if (!PyErr_Occurred()) {
+                    PyErr_Format(
+                        PyExc_TypeError,
+                        "(%s) The parameter type %lld in the query isn't supported for passing to SQL",
+                        __FUNCTION__, parameter_number + 1
+                    );
+                }
+                return -1;
+            }
+        }
+    }
+    free_columns(self);  // the next result set has its own columns
+
+    PY_MEM_FREE_TO_NULL(self->query);  // the query of the previous execution
+    self->query = query;
+    self->timeout = timeout;
+
+    // the driver takes whole seconds, the deadline cancels the statement exactly
+    self->retcode = SQLSetStmtAttr(
+        self->handle, SQL_ATTR_QUERY_TIMEOUT, (SQLPOINTER)(SQLULEN)ceil(self->timeout), SQL_IS_INTEGER
+    );
+    CHECK_ERROR("prepare_execute::SQLSetStmtAttr::SQL_ATTR_QUERY_TIMEOUT ");
+
+    if (self->exec_mode == EXEC_NONE) {
+        // the statement is already prepared, the awaitable completes at once without a slot
+        self->retcode = SQL_SUCCESS;
+        self->event_status = WAIT_OBJECT_0;
+        self->state = TO_EXECUTE;
+        return 0;
+    }
+
+    if (submit_execute(self) == -1) {
+        forget_failed_prepare(self);
+        return -1;
+    }
+
+    self->state = TO_EXECUTE;
+    return 0;
+}
+
+
+/*
+    The statement waits for a slot in the queue of the connection or starts at once
+*/
+static int submit_execute(Cursor *self)
+{
+    PRINT_DEBUG_MESSAGE(__FUNCTION__);
+
+    #ifdef _WIN32
+    self->event = CreateEvent(NULL, FALSE, FALSE, NULL);
+    self->event_status = 258;
+    CHECK_EVENT_ERROR(self->event, "prepare_execute::CreateEvent");
+
+    #elif __linux__
+    self->event = create_t_event();
+    self->event_status = 258;
+    CHECK_EVENT_ERROR(self->event, "prepare_execute::create_t_event");
+
+    self->event->obj = self;
+    #endif
+
+    if (self->conn->queue_head != NULL || !has_free_slot(self->conn)) {
+        // the awaitable waits for the event like for a running statement
+        enqueue_cursor(self);
+        return 0;
+    }
+
+    if (start_execute(self) == -1) {
+        close_event(&self->event, &self->event_status);
+        return -1;
+    }
+
+    return 0;
+}
+
+
+/*
+    Starts the prepared statement on a slot of the connection
+*/
+static int start_execute(Cursor *self)
+{
+    PRINT_DEBUG_MESSAGE(__FUNCTION__);
+
+    // the deadline doesn't count the waiting in the queue
+    if (self->timeout && start_deadline(self->conn, &self->timer, self->timeout) == -1) {
+        return -1;
+    }
+
+    #ifdef _WIN32
+    if (self->exec_mode == EXEC_PREPARE || self->exec_mode == EXEC_PREPARE_EXECUTE) {
+        // the preparing is synchronous, the drivers usually defer it to the execution
+        self->retcode = SQLSetStmtAttr(
+            self->handle, SQL_ATTR_ASYNC_ENABLE, (SQLPOINTER)SQL_ASYNC_ENABLE_OFF, SQL_IS_INTEGER
+        );
+        CHECK_ERROR("start_execute::SQLSetStmtAttr::SQL_ATTR_ASYNC_ENABLE");
+
+        self->retcode = SQLPrepareW(self->handle, (SQLWCHAR *)self->query, SQL_NTS);
+        CHECK_ERROR("start_execute::SQLPrepareW");
+
+        if (self->exec_mode == EXEC_PREPARE) {
+            SetEvent(self->event);
+            self->conn->runned_cursors++;
+            return 0;
+        }
+    }
+
+    self->retcode = SQLSetStmtAttr(self->handle, SQL_ATTR_ASYNC_ENABLE, (SQLPOINTER)SQL_ASYNC_ENABLE_ON, SQL_IS_INTEGER);
+    CHECK_ERROR("start_execute::SQLSetStmtAttr::SQL_ATTR_ASYNC_ENABLE");
+
+    self->retcode = SQLSetStmtAttr(self->handle, SQL_ATTR_ASYNC_STMT_EVENT, self->event, SQL_IS_POINTER);
+    CHECK_ERROR("start_execute::SQLSetStmtAttr::SQL_ATTR_ASYNC_STMT_EVENT");
+
+    if (self->exec_mode == EXEC_DIRECT) {
+        self->retcode = SQLExecDirectW(self->handle, (SQLWCHAR *)self->query, SQL_NTS);
+        CHECK_ERROR("start_execute::SQLExecDirectW");
+    } else {
+        self->retcode = SQLExecute(self->handle);
+        CHECK_ERROR("start_execute::SQLExecute");
+    }
+
+    #elif __linux__
+    // only SQLExecDirectW is polled, the streamed parameters are sent by the workers
+    if (
+        self->exec_mode == EXEC_DIRECT && !self->p_info.stream_count && self->conn->poller != NULL
+        && start_polling(self) == 0
+    ) {
+        if (poller_submit(self->conn->poller, &self->poll) == -1) {
+            end_polling(self);
+            stop_deadline(self->conn, &self->timer);
+            PyErr_Format(PyExc_Exception, "(%s) Failed to start the poller thread", __FUNCTION__);
+            return -1;
+        }
+    } else if (thread_pool_submit(self->conn->pool, t_sql_execute, self->event) == -1) {
+        stop_deadline(self->conn, &self->timer);
+        PyErr_Format(PyExc_Exception, "(%s) The worker pool can't accept the task", __FUNCTION__);
+        return -1;
+    }
+    #endif
+
+    self->conn->runned_cursors++;
+    return 0;
+}
+
+
+static PyObject* Cursor_Execute(Cursor *self, PyObject *args, PyObject *kwargs)
+{
+    PRINT_DEBUG_MESSAGE(__FUNCTION__);
+
+    static char *kwlist[] = {"query", "params", "timeout", NULL};
+    PyObject *py_query = NULL;
+    PyObject *params = Py_None;
+    double timeout = 0;
+    const wchar_t *query;
+    Py_ssize_t params_length = 0;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|Od", kwlist, &py_query, &params, &timeout)) {
+        return NULL;
+    }
+
+    if (!PyUnicode_Check(py_query)) {
+        PyErr_Format(PyExc_AttributeError, "(%s) The query must be an Unicode string", __FUNCTION__);
+        return NULL;
+    }
+
+    if (timeout < 0) {
+        PyErr_Format(PyExc_AttributeError, "(%s) The value must be nonnegative", __FUNCTION__);
+        return NULL;
+    }
+
+    if (timeout > 2147483647) {
+        PyErr_Format(PyExc_AttributeError, "(%s) The value must be less than 2147483648", __FUNCTION__);
+        return NULL;
+    }
+
+    // the parsed query is cached, the named params are taken in the order of the markers
+    PyObject *parsed = parse_query(self->conn, py_query);
+    if (parsed == NULL) {
+        return NULL;
+    }
+
+    params = order_parameters(get_parsed_query(parsed), params, __FUNCTION__);
+    if (params == NULL) {
+        Py_DECREF(parsed);
+        return NULL;
+    }
+
+    query = copy_parsed_query(get_parsed_query(parsed));
+    Py_DECREF(parsed);
+    if (query == NULL) {
+        Py_DECREF(params);
+        return NULL;
+    }
+
+    if (params != Py_None) {
+        params_length = PyTuple_GET_SIZE(params);
+    }
+
+    if (prepare_execute((Cursor *)self, query, params, params_length, timeout, 0) == -1) {
+        Py_XDECREF(params);
+        if (self->query == query) {
+            PY_MEM_FREE_TO_NULL(self->query);
+        } else {
+            PyMem_Free((void *)query);  // it's failed before the query is taken
+        }
+
+        return NULL;
+    }
+    Py_XDECREF(params);
+
+    Py_INCREF(self);
+    return (PyObject *)self;
+}
+
+
+static int check_batch_arguments(PyObject *py_query, Py_ssize_t batch_size, double timeout, const char *fn_name)
+{
+    if (!PyUnicode_Check(py_query)) {
+        PyErr_Format(PyExc_AttributeError, "(%s) The query must be an Unicode string", fn_name);
+        return -1;
+    }
+
+    if (batch_size < 1) {
+        PyErr_Format(PyExc_AttributeError, "(%s) The batch size must be positive", fn_name);
+        return -1;
+    }
+
+    if (timeout < 0) {
+        PyErr_Format(PyExc_AttributeError, "(%s) The value must be nonnegative", fn_name);
+        return -1;
+    }
+
+    if (timeout > 2147483647) {
+        PyErr_Format(PyExc_AttributeError, "(%s) The value must be less than 2147483648", fn_name);
+        return -1;
+    }
+
+    return 0;
+}
+
+
+/*
+    The cursor takes the batches and the query, the first batch is executed by prepare_execute
+*/
+static int execute_batches(Cursor *self, const wchar_t *query, batch_info *many, Py_ssize_t batch_size, double timeout)
+{
+    self->many = many;
+
+    many->size = batch_size < many->total ? batch_size : many->total;
+    many->status = PyMem_Malloc(sizeof(SQLUSMALLINT) * many->size);
+    many->statuses = PyList_New(0);
+    if (many->status == NULL || many->statuses == NULL) {
+        end_batches(self);
+        PyMem_Free((void *)query);
+        PyErr_NoMemory();
+        return -1;
+    }
+
+    if (prepare_execute(self, query, NULL, 0, timeout, 0) == -1) {
+        end_batches(self);
+        if (self->query == query) {
+            PY_MEM_FREE_TO_NULL(self->query);
+        } else {
+            PyMem_Free((void *)query);  // it's failed before the query is taken
+        }
+
+        return -1;
+    }
+
+    return 0;
+}
+
+
+/*
+    Executes the query for each tuple of the parameters, the rows are bound by batches of batch_size.
+    The awaitable returns the statuses of the rows
+*/
+static PyObject* Cursor_Executemany(Cursor *self, PyObject *args, PyObject *kwargs)
+{
+    PRINT_DEBUG_MESSAGE(__FUNCTION__);
+
+    static char *kwlist[] = {"query", "seq_of_params", "batch_size", "timeout", NULL};
+    PyObject *py_query = NULL;
+    PyObject *seq_of_params = NULL;
+    Py_ssize_t batch_size = 1000;
+    double timeout = 0;
+    const wchar_t *query = NULL;
+    PyObject *ordered_rows = NULL;
+
+    if (!PyArg_ParseTupleAndKeywords(
+        args, kwargs, "OO|nd", kwlist, &py_query, &seq_of_params, &batch_size, &timeout
+    )) {
+        return NULL;
+    }
+
+    if (check_batch_arguments(py_query, batch_size, timeout, __FUNCTION__) == -1
+        || check_execute_state(self, __FUNCTION__) == -1) {
+        return NULL;
+    }
+
+    // the rows are copied into a tuple, so they aren't changed between the batches
+    PyObject *rows = PySequence_Tuple(seq_of_params);
+    if (rows == NULL) {
+        return NULL;
+    }
+
+    Py_ssize_t row_count = PyTuple_GET_SIZE(rows);
+    if (row_count == 0) {
+        Py_DECREF(rows);
+        PyErr_Format(PyExc_AttributeError, "(%s) The sequence of params is empty", __FUNCTION__);
+        return NULL;
+    }
+
+    PyObject *parsed = parse_query(self->conn, py_query);
+    if (parsed == NULL) {
+        Py_DECREF(rows);
+        return NULL;
+    }
+
+    // the named params of the rows are taken in the order of the markers
+    ordered_rows = PyTuple_New(row_count);
+    if (ordered_rows == NULL) {
+        goto clean_up;
+    }
+
+    for (Py_ssize_t i = 0; i < row_count; i++) {
+        PyObject *row = PyTuple_GET_ITEM(rows, i);
+        PyObject *ordered = row != Py_None ? order_parameters(get_parsed_query(parsed), row, __FUNCTION__) : NULL;
+        if (ordered == NULL) {
+            if (!PyErr_Occurred()) {
+                PyErr_Format(PyExc_TypeError, "(%s) Params must be in a tuple", __FUNCTION__);
+            }
+            goto clean_up;
+        }
+        PyTuple_SET_ITEM(ordered_rows, i, ordered);
+    }
+
+    query = copy_parsed_query(get_parsed_query(parsed));
+    if (query == NULL) {
+        goto clean_up;
+    }
+
+    batch_info *many = PyMem_Calloc(1, sizeof(batch_info));
+    if (many == NULL) {
+        PyErr_NoMemory();
+        goto clean_up;
+    }
+
+    many->rows = ordered_rows;
+    many->total = row_count;
+    many->params_length = get_parsed_query(parsed)->parameter_count;
+    Py_DECREF(rows);
+    Py_DECREF(parsed);
+
+    if (execute_batches(self, query, many, batch_size, timeout) == -1) {
+        return NULL;
+    }
+
+    Py_INCREF(self);
+    return (PyObject *)self;
+
+    clean_up:
+        Py_DECREF(rows);
+        Py_XDECREF(ordered_rows);
+        Py_DECREF(parsed);
+        PyMem_Free((void *)query);
+        return NULL;
+}
+
+
+/*
+    Executes the query for the rows of the columns, the parameters are bound from the buffers of the objects
+    without PyObject per value. The awaitable returns the statuses of the rows
+*/
+static PyObject* Cursor_InsertColumns(Cursor *self, PyObject *args, PyObject *kwargs)
+{
+    PRINT_DEBUG_MESSAGE(__FUNCTION__);
+
+    static char *kwlist[] = {"query", "columns", "batch_size", "timeout", NULL};
+    PyObject *py_query = NULL;
+    PyObject *columns = NULL;
+    Py_ssize_t batch_size = 1000;
+    double timeout = 0;
+    const wchar_t *query;
+    PyObject *named_columns = NULL;
+
+    if (!PyArg_ParseTupleAndKeywords(
+        args, kwargs, "OO!|nd", kwlist, &py_query, &PyDict_Type, &columns, &batch_size, &timeout
+    )) {
+        return NULL;
+    }
+
+    if (check_batch_arguments(py_query, batch_size, timeout, __FUNCTION__) == -1
+        || check_execute_state(self, __FUNCTION__) == -1) {
+        return NULL;
+    }
+
+    PyObject *parsed = parse_query(self->conn, py_query);
+    if (parsed == NULL) {
+        return NULL;
+    }
+
+    // the columns of the named markers are taken by their names
+    parsed_query *parsed_data = get_parsed_query(parsed);
+    if (parsed_data->names != NULL) {
+        named_columns = order_parameters(parsed_data, columns, __FUNCTION__);
+        if (named_columns == NULL) {
+            Py_DECREF(parsed);
+            return NULL;
+        }
+    } else if (check_parameters_equality(parsed_data, PyDict_GET_SIZE(columns)) == -1) {
+        Py_DECREF(parsed);
+        return NULL;
+    }
+
+    Py_ssize_t column_count = parsed_data->parameter_count;
+    query = copy_parsed_query(parsed_data);
+    if (query == NULL) {
+        Py_XDECREF(named_columns);
+        Py_DECREF(parsed);
+        return NULL;
+    }
+
+    batch_info *many = PyMem_Calloc(1, sizeof(batch_info));
+    if (many == NULL || (column_count && (many->columns = PyMem_Calloc(column_count, sizeof(column_source))) == NULL)) {
+        PyMem_Free(many);
+        PyMem_Free((void *)query);
+        Py_XDECREF(named_columns);
+        Py_DECREF(parsed);
+        return PyErr_NoMemory();
+    }
+    many->params_length = column_count;
+    many->total = -1;
+
+    // the columns are bound in the order of the markers, the buffers are kept until the end of the execution
+    PyObject *key, *column;
+    Py_ssize_t position = 0;
+    for (Py_ssize_t i = 0; i < column_count; i++) {
+        column_source *source = &many->columns[i];
+
+        if (named_columns != NULL) {
+            key = PyTuple_GET_ITEM(parsed_data->names, i);
+            column = PyTuple_GET_ITEM(named_columns, i);
+        } else {
+            PyDict_Next(columns, &position, &key, &column);
+        }
+
+        if (open_column_source(key, column, source) == -1) {
+            goto clean_up;
+        }
+
+        if (many->total != -1 && source->row_count != many->total) {
+            PyErr_Format(PyExc_ValueError, "(%s) The columns must have the same number of rows", __FUNCTION__);
+            goto clean_up;
+        }
+        many->total = source->row_count;
+    }
+    Py_CLEAR(named_columns);  // the sources keep the buffers
+    Py_CLEAR(parsed);
+
+    if (many->total < 1) {
+        PyErr_Format(PyExc_AttributeError, "(%s) The columns are empty", __FUNCTION__);
+        goto clean_up;
+    }
+
+    if (execute_batches(self, query, many, batch_size, timeout) == -1) {
+        return NULL;
+    }
+
+    Py_INCREF(self);
+    return (PyObject *)self;
+
+    clean_up:
+        self->many = many;
+        end_batches(self);
+        PyMem_Free((void *)query);
+        Py_XDECREF(named_columns);
+        Py_XDECREF(parsed);
+        return NULL;
+}
+
+
+/*
+    Prepares the statement on the handle of the cursor without its execution,
+    the next execute of the same query only binds the parameters and calls SQLExecute
+*/
+static PyObject* Cursor_Prepare(Cursor *self, PyObject *args, PyObject *kwargs)
+{
+    PRINT_DEBUG_MESSAGE(__FUNCTION__);
+
+    static char *kwlist[] = {"query", "timeout", NULL};
+    PyObject *py_query = NULL;
+    double timeout = 0;
+    const wchar_t *query;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|d", kwlist, &py_query, &timeout)) {
+        return NULL;
+    }
+
+    if (!PyUnicode_Check(py_query)) {
+        PyErr_Format(PyExc_AttributeError, "(%s) The query must be an Unicode string", __FUNCTION__);
+        return NULL;
+    }
+
+    if (timeout < 0) {
+        PyErr_Format(PyExc_AttributeError, "(%s) The value must be nonnegative", __FUNCTION__);
+        return NULL;
+    }
+
+    if (timeout > 2147483647) {
+        PyErr_Format(PyExc_AttributeError, "(%s) The value must be less than 2147483648", __FUNCTION__);
+        return NULL;
+    }
+
+    // the statement is prepared for the query of the execution with the positional markers
+    PyObject *parsed = parse_query(self->conn, py_query);
+    if (parsed == NULL) {
+        return NULL;
+    }
+
+    query = copy_parsed_query(get_parsed_query(parsed));
+    Py_DECREF(parsed);
+    if (query == NULL) {
+        return NULL;
+    }
+
+    if (prepare_execute(self, query, NULL, 0, timeout, 1) == -1) {
+        if (self->query == query) {
+            PY_MEM_FREE_TO_NULL(self->query);
+        } else {
+            PyMem_Free((void *)query);  // it's failed before the query is taken
+        }
+
+        return NULL;
+    }
+
+    Py_INCREF(self);
+    return (PyObject *)self;
+}
+
+
+/*
+    Returns 1 if all rows of the result were taken, 0 if the cursor can fetch and -1 on error
+*/
+static int check_fetch_state(Cursor *self, const char *fn_name)
+{
+    if (self->conn->state != CONNECTED ) {
+        PyErr_Format(PyExc_Exception, "(%s) The connection isn't established", fn_name);
+        return -1;
+    }
+
+    if (self->state == TO_OPEN || self->state == CLOSED) {
+        PyErr_Format(PyExc_Exception, "(%s) The cursor isn't opened", fn_name);
+        return -1;
+    }
+
+    if (self->state == TO_FETCH) {
+        PyErr_Format(PyExc_Exception, "(%s) The cursor is already fetching results", fn_name);
+        return -1;
+    }
+
+    if (self->state == OPENED && self->r_info.is_end) {
+        return 1;  // there aren't more rows
+    }
+
+    if (self->state != EXECUTED) {
+        PyErr_Format(PyExc_Exception, "(%s) The cursor wasn't executed", fn_name);
+        return -1;
+    }
+
+    return 0;
+}
+
+
+static int parse_fetch_size(PyObject *args, PyObject *kwargs, Py_ssize_t *size, const char *fn_name)
+{
+    static char *kwlist[] = {"size", NULL};
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "n", kwlist, size)) {
+        return -1;
+    }
+
+    if (*size <= 0) {
+        PyErr_Format(PyExc_AttributeError, "(%s) The size must be positive", fn_name);
+        return -1;
+    }
+
+    return 0;
+}
+
+
+/*
+    Takes up to limit rows (0 - all rows) on the calling thread
+*/
+static PyObject* fetch_results(Cursor *self, size_t limit)
+{
+    PRINT_DEBUG_MESSAGE(__FUNCTION__);
+
+    const char *failed_fn = NULL;
+    PyObject *results = NULL;
+    PyObject *row = NULL;
+    int is_end = 0;
+
+    int code = describe_columns(self, &failed_fn);
+    if (code) {
+        raise_read_error(self, code, failed_fn);
+        goto clean_up;
+    }
+
+    if (create_column_keys(self) == -1) {
+        goto clean_up;
+    }
+
+    results = PyList_New(0);
+    if (results == NULL) {
+        PyErr_Format(PyExc_Exception, "(%s) Failed to create List", __FUNCTION__);
+        goto clean_up;
+    }
+
+    if (!self->r_info.column_count) {
+        is_end = 1;  // there isn't a result set
+        goto clean_up;
+    }
+
+    while (!limit || (size_t)PyList_GET_SIZE(results) < limit) {
+        self->retcode = SQLFetch(self->handle);
+        if (self->retcode == SQL_NO_DATA) {
+            is_end = 1;
+            break;
+        }
+
+        if (check_error((PyObject *)self, "fetch_results::SQLFetch")) {
+            goto clean_up;
+        }
+
+        row = get_row(self);
+        if (row == NULL) {
+            goto clean_up;
+        }
+
+        if (PyList_Append(results, row) == -1) {
+            PyErr_Format(PyExc_Exception, "(%s) Failed to add a element into List", __FUNCTION__);
+            goto clean_up;
+        }
+        Py_CLEAR(row);
+    }
+
+    clean_up:
+        if (PyErr_Occurred()) {
+            finish_fetch(self, 1);
+            Py_XDECREF(row);
+            Py_XDECREF(results);
+            return NULL;
+        } else {
+            finish_fetch(self, is_end);
+            if (is_end) {
+                self->r_info.is_end = 1;
+            }
+            return results;
+        }
+}
+
+
+static PyObject* Cursor_Fetchall(Cursor *self)
+{
+    PRINT_DEBUG_MESSAGE(__FUNCTION__);
+
+    switch (check_fetch_state(self, __FUNCTION__)) {
+        case 0:
+            return fetch_results(self, 0);
+        case 1:
+            return PyList_New(0);
+        default:
+            return NULL;
+    }
+}
+
+
+static PyObject* Cursor_Fetchmany(Cursor *self, PyObject *args, PyObject *kwargs)
+{
+    PRINT_DEBUG_MESSAGE(__FUNCTION__);
+
+    Py_ssize_t size;
+
+    if (parse_fetch_size(args, kwargs, &size, __FUNCTION__) == -1) {
+        return NULL;
+    }
 
-    self->retcode = SQLSetStmtAttr(self->handle, SQL_ATTR_ASYNC_STMT_EVENT, self->event, SQL_IS_POINTER);
-    CHECK_ERROR("prepare_execute::SQLSetStmtAttr::SQL_ATTR_ASYNC_STMT_EVENT");
+    switch (check_fetch_state(self, __FUNCTION__)) {
+        case 0:
+            return fetch_results(self, (size_t)size);
+        case 1:
+            return PyList_New(0);
+        default:
+            return NULL;
+    }
+}
+
+
+/*
+    SQLFetch and SQLGetData are called by a worker, the awaitable converts the rows on the event loop thread
+*/
+static int prepare_fetch(Cursor *self, size_t limit, int is_end)
+{
+    PRINT_DEBUG_MESSAGE(__FUNCTION__);
+
+    self->batch = create_batch(limit);
+    if (self->batch == NULL) {
+        PyErr_NoMemory();
+        return -1;
+    }
+
+    if (is_end) {
+        // the awaitable completes at once with an empty list
+        self->batch->is_end = 1;
+        self->event_status = WAIT_OBJECT_0;
+        self->state = TO_FETCH;
+        return 0;
+    }
 
-    self->retcode = SQLExecDirectW(self->handle, (SQLWCHAR *)self->query, SQL_NTS);
-    CHECK_ERROR("prepare_execute::SQLExecDirectW");
+    #ifdef _WIN32
+    // the statement is in the asynchronous mode only for the execution
+    fetch_rows(self, self->batch);
+    self->event_status = WAIT_OBJECT_0;
 
     #elif __linux__
     self->event = create_t_event();
     self->event_status = 258;
-    CHECK_EVENT_ERROR(self->event, "prepare_execute::create_t_event");
+    if (self->event == NULL) {
+        free_batch(self, self->batch);
+        self->batch = NULL;
+        PyErr_SetString(PyExc_Exception, "prepare_fetch::create_t_event");
+        return -1;
+    }
 
     self->event->obj = self;
 
-    pthread_create(&self->event->thread, NULL, t_sql_exec_direct_w, self->event);
-    pthread_detach(self->event->thread);
+    if (thread_pool_submit(self->conn->pool, t_sql_fetch, self->event) == -1) {
+        close_event(&self->event, &self->event_status);
+        free_batch(self, self->batch);
+        self->batch = NULL;
+        PyErr_Format(PyExc_Exception, "(%s) The worker pool can't accept the task", __FUNCTION__);
+        return -1;
+    }
     #endif
 
-    self->conn->runned_cursors++;
-    self->state = TO_EXECUTE;
-    if (timeout) {
-        self->start_time = clock() / CLOCKS_PER_SEC;
-    }
+    self->state = TO_FETCH;
     return 0;
 }
 
 
-static PyObject* Cursor_Execute(Cursor *self, PyObject *args, PyObject *kwargs)
+static PyObject* Cursor_FetchallAsync(Cursor *self)
 {
     PRINT_DEBUG_MESSAGE(__FUNCTION__);
 
-    static char *kwlist[] = {"query", "params", "timeout", NULL};
-    PyObject *py_query = NULL;
-    PyObject *params = NULL;
-    long long timeout = 0;
-    const wchar_t *query;
-    Py_ssize_t string_length;
-    Py_ssize_t params_length = 0;
+    int code = check_fetch_state(self, __FUNCTION__);
+    if (code == -1) {
+        return NULL;
+    }
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|OL", kwlist, &py_query, &params, &timeout)) {
+    if (prepare_fetch(self, 0, code) == -1) {
         return NULL;
     }
 
-    if (!PyUnicode_Check(py_query)) {
-        PyErr_Format(PyExc_AttributeError, "(%s) The query must be an Unicode string", __FUNCTION__);
+    Py_INCREF(self);
+    return (PyObject *)self;
+}
+
+
+static PyObject* Cursor_FetchmanyAsync(Cursor *self, PyObject *args, PyObject *kwargs)
+{
+    PRINT_DEBUG_MESSAGE(__FUNCTION__);
+
+    Py_ssize_t size;
+
+    if (parse_fetch_size(args, kwargs, &size, __FUNCTION__) == -1) {
         return NULL;
     }
 
-    if (timeout < 0) {
-        PyErr_Format(PyExc_AttributeError, "(%s) The value must be nonnegative", __FUNCTION__);
+    int code = check_fetch_state(self, __FUNCTION__);
+    if (code == -1) {
         return NULL;
     }
 
-    if (timeout > 2147483647) {
-        PyErr_Format(PyExc_AttributeError, "(%s) The value must be less than 2147483648", __FUNCTION__);
+    if (prepare_fetch(self, (size_t)size, code) == -1) {
         return NULL;
     }
 
-    if (params && params != Py_None) {
-        if (!PyTuple_Check(params)) {
-            PyErr_Format(PyExc_TypeError, "(%s) Params must be in a tuple", __FUNCTION__);
-            return NULL;
-        } else {
-            Py_INCREF(params);
-            params_length = PyTuple_GET_SIZE(params);
-        }
+    Py_INCREF(self);
+    return (PyObject *)self;
+}
+
+
+static PyObject* Cursor_Prefetch(Cursor *self, PyObject *args, PyObject *kwargs)
+{
+    PRINT_DEBUG_MESSAGE(__FUNCTION__);
+
+    static char *kwlist[] = {"size", "depth", NULL};
+    Py_ssize_t size;
+    Py_ssize_t depth = PREFETCH_DEFAULT_DEPTH;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "n|n", kwlist, &size, &depth)) {
+        return NULL;
     }
 
-    string_length = PyUnicode_GET_LENGTH(py_query);
-    query = (const wchar_t *)PyUnicode_AsWideCharString(py_query, &string_length);
-    if (query == NULL) {
+    if (size <= 0 || depth <= 0) {
+        PyErr_Format(PyExc_AttributeError, "(%s) The size and the depth must be positive", __FUNCTION__);
+        return NULL;
+    }
+
+    int code = check_fetch_state(self, __FUNCTION__);
+    if (code == -1) {
+        return NULL;
+    }
+
+    prefetch_info *prefetch = create_prefetch((size_t)size, (size_t)depth);
+    if (prefetch == NULL) {
         PyErr_NoMemory();
         return NULL;
     }
-    
-    if (check_parameters_equality(query, params_length) == -1) {
-        Py_XDECREF(params);
-        PyMem_Free((void *)query);
+    prefetch->is_end = code == 1;
+
+    #ifdef __linux__
+    self->event = create_t_event();
+    self->event_status = 258;
+    if (self->event == NULL) {
+        free_prefetch(self, prefetch);
+        PyErr_SetString(PyExc_Exception, "Cursor_Prefetch::create_t_event");
         return NULL;
     }
 
-    if (prepare_execute((Cursor *)self, query, params, params_length, timeout) == -1) {
-        Py_XDECREF(params);
-        PY_MEM_FREE_TO_NULL(self->query);
+    self->event->obj = self;
+    #endif
 
+    self->prefetch = prefetch;
+    self->state = TO_FETCH;
+
+    // the worker starts filling before the first batch is awaited
+    if (fill_batches(self) == -1) {
+        end_prefetch(self);
         return NULL;
     }
-    Py_XDECREF(params);
 
     Py_INCREF(self);
     return (PyObject *)self;
 }
 
 
-static PyObject* Cursor_Fetchall(Cursor *self)
+static int check_nextset_state(Cursor *self, const char *fn_name)
 {
-    PRINT_DEBUG_MESSAGE(__FUNCTION__);
+    if (self->conn->state != CONNECTED ) {
+        PyErr_Format(PyExc_Exception, "(%s) The connection isn't established", fn_name);
+        return -1;
+    }
 
-    SQLSMALLINT column_count;
-    SQLWCHAR column_name[256];
-    SQLSMALLINT name_length;
-    SQLSMALLINT sql_type;
-    SQLULEN column_size;
-    SQLSMALLINT decimal_digits;
-    SQLSMALLINT nullable;
+    if (self->state == TO_OPEN || self->state == CLOSED) {
+        PyErr_Format(PyExc_Exception, "(%s) The cursor isn't opened", fn_name);
+        return -1;
+    }
 
-    PyObject *results = NULL;
-    PyObject *row = NULL;
-    PyObject *value = NULL;
-    PyObject *key = NULL;
+    if (self->state == TO_EXECUTE || self->state == TO_FETCH) {
+        PyErr_Format(PyExc_Exception, "(%s) The cursor is busy, You need to await it", fn_name);
+        return -1;
+    }
 
-    wchar_t *w_column_name;
+    // the rows of the current result set are taken or not, the driver discards the rest of them
+    if (self->state == OPENED && !self->r_info.is_end) {
+        PyErr_Format(PyExc_Exception, "(%s) The cursor wasn't executed", fn_name);
+        return -1;
+    }
 
-    if (self->conn->state != CONNECTED ) {
-        PyErr_Format(PyExc_Exception, "(%s) The connection isn't established", __FUNCTION__);
-        goto clean_up;
+    return 0;
+}
+
+
+/*
+    The connection is busy until SQLMoreResults returns SQL_NO_DATA,
+    so the slot released after the rows of the previous result set is taken again
+*/
+static void begin_more_results(Cursor *self)
+{
+    if (self->state == OPENED) {
+        self->conn->runned_cursors++;
     }
 
-    if (self->state == TO_OPEN || self->state == CLOSED) {
-        PyErr_Format(PyExc_Exception, "(%s) The cursor isn't opened", __FUNCTION__);
-        goto clean_up;
+    free_columns(self);  // the next result set has its own columns
+    self->state = EXECUTED;
+}
+
+
+static int start_more_results(Cursor *self)
+{
+    PRINT_DEBUG_MESSAGE(__FUNCTION__);
+
+    begin_more_results(self);
+    self->exec_mode = EXEC_MORE_RESULTS;
+
+    #ifdef _WIN32
+    // like the fetching, the statement is in the asynchronous mode only for the execution
+    self->retcode = SQLMoreResults(self->handle);
+    self->event_status = WAIT_OBJECT_0;
+
+    #elif __linux__
+    self->event = create_t_event();
+    self->event_status = 258;
+    if (self->event == NULL) {
+        finish_fetch(self, 1);
+        PyErr_SetString(PyExc_Exception, "start_more_results::create_t_event");
+        return -1;
     }
 
-    if (self->state != EXECUTED) {
-        PyErr_Format(PyExc_Exception, "(%s) The cursor wasn't executed", __FUNCTION__);
-        goto clean_up;
+    self->event->obj = self;
+
+    if (thread_pool_submit(self->conn->pool, t_sql_more_results, self->event) == -1) {
+        close_event(&self->event, &self->event_status);
+        finish_fetch(self, 1);
+        PyErr_Format(PyExc_Exception, "(%s) The worker pool can't accept the task", __FUNCTION__);
+        return -1;
     }
+    #endif
 
-    self->retcode = SQLNumResultCols(self->handle, &column_count);
-    if (check_error((PyObject *)self, "Cursor_Fetchall::SQLNumResultCols")) {
-        goto clean_up;
+    self->state = TO_EXECUTE;
+    return 0;
+}
+
+
+static PyObject* Cursor_Nextset(Cursor *self)
+{
+    PRINT_DEBUG_MESSAGE(__FUNCTION__);
+
+    if (check_nextset_state(self, __FUNCTION__) == -1) {
+        return NULL;
     }
 
-    results = PyList_New(0);
-    if (results == NULL) {
-        PyErr_Format(PyExc_Exception, "(%s) Failed to create List", __FUNCTION__);
-        goto clean_up;
+    // it's called on the calling thread like fetchall
+    begin_more_results(self);
+    self->retcode = SQLMoreResults(self->handle);
+
+    switch (complete_more_results(self, "Cursor_Nextset::SQLMoreResults")) {
+        case 1:
+            Py_RETURN_TRUE;
+        case 0:
+            Py_RETURN_FALSE;
+        default:
+            return NULL;
     }
+}
 
-    while (SQL_SUCCEEDED(SQLFetch(self->handle))) {
-        row = PyDict_New();
-        if (row == NULL) {
-            PyErr_Format(PyExc_Exception, "(%s) Failed to create Dict", __FUNCTION__);
-            goto clean_up;
-        }
 
-        for (SQLUSMALLINT i = 0; i < column_count; i++) {
-            self->retcode = SQLDescribeColW(
-                self->handle,
-                (SQLUSMALLINT)(i + 1),
-                column_name,
-                sizeof(column_name),
-                &name_length,
-                &sql_type,
-                &column_size,
-                &decimal_digits,
-                &nullable
-            );
-
-            if (check_error((PyObject *)self, "(%s) Cursor_Fetchall::SQLDescribeColW")) {
-                goto clean_up;
-            }
+static PyObject* Cursor_NextsetAsync(Cursor *self)
+{
+    PRINT_DEBUG_MESSAGE(__FUNCTION__);
 
-            value = get_data(self, i, sql_type);
-            if (value == NULL) {
-                goto clean_up;
-            }
+    if (check_nextset_state(self, __FUNCTION__) == -1 || start_more_results(self) == -1) {
+        return NULL;
+    }
 
-            #ifdef _WIN32
-            w_column_name = (wchar_t *)malloc(sizeof(column_name));
-            if (w_column_name == NULL) {
-                PyErr_NoMemory();
-                goto clean_up;
-            }
-            wcscpy(w_column_name, (wchar_t *)column_name);
+    Py_INCREF(self);
+    return (PyObject *)self;
+}
 
-            #elif __linux__
-            w_column_name = uctowc(column_name);
-            if (w_column_name == NULL) {
-                PyErr_NoMemory();
-                goto clean_up;
-            }
-            #endif
 
-            key = PyUnicode_FromWideChar(w_column_name, -1);
-            free(w_column_name);
+/*
+    The awaitable fetches the rows of the current result set and of the next ones by the workers
+*/
+static PyObject* Cursor_FetchAllSets(Cursor *self)
+{
+    PRINT_DEBUG_MESSAGE(__FUNCTION__);
 
-            if (key == NULL) {
-                PyErr_Format(PyExc_Exception, "(%s) Failed to get FieldName", __FUNCTION__);
-                goto clean_up;
-            }
+    if (check_nextset_state(self, __FUNCTION__) == -1) {
+        return NULL;
+    }
 
-            if (PyDict_SetItem(row, key, value) == -1) {
-                PyErr_Format(PyExc_Exception, "(%s) Failed to set KeyValue", __FUNCTION__);
-                goto clean_up;
-            }
-            Py_DECREF(key);
-            Py_DECREF(value);
+    int code;
+    if (self->sets != NULL) {
+        // the error of the first statement of the batch is its result set
+        code = start_more_results(self);
+    } else {
+        self->sets = PyList_New(0);
+        if (self->sets == NULL) {
+            return NULL;
         }
 
-        if (PyList_Append(results, row) == -1) {
-            PyErr_Format(PyExc_Exception, "(%s) Failed to add a element into List", __FUNCTION__);
-            goto clean_up;
-        }
-        Py_DECREF(row);
+        // the rows of the current result set can be already taken
+        code = self->state == EXECUTED ? prepare_fetch(self, 0, 0) : start_more_results(self);
+    }
+    if (code == -1) {
+        Py_CLEAR(self->sets);
+        return NULL;
     }
 
-    clean_up:
-        self->conn->runned_cursors--;
-        self->state = OPENED;
+    Py_INCREF(self);
+    return (PyObject *)self;
+}
 
-        if (PyErr_Occurred()) {
-            Py_XDECREF(key);
-            Py_XDECREF(value);
-            Py_XDECREF(row);
-            Py_XDECREF(results);
-            return NULL;
-        } else {
-            return results;
-        }
+
+static PyObject* Cursor_GetRowcount(Cursor *self, void *closure)
+{
+    return PyLong_FromSsize_t((Py_ssize_t)self->r_info.row_count);
+}
+
+
+/*
+    The methods lock the cursor and its connection, it matters only for the free-threaded build
+*/
+static PyObject* Cursor_Next_locked(Cursor *self)
+{
+    PyObject *result;
+    Py_BEGIN_CRITICAL_SECTION2(self, self->conn);
+    result = Cursor_Next(self);
+    Py_END_CRITICAL_SECTION2();
+    return result;
+}
+
+
+static PyObject* Cursor_ANext_locked(Cursor *self)
+{
+    PyObject *result;
+    Py_BEGIN_CRITICAL_SECTION2(self, self->conn);
+    result = Cursor_ANext(self);
+    Py_END_CRITICAL_SECTION2();
+    return result;
+}
+
+
+static PyObject* Cursor_Close_locked(Cursor *self)
+{
+    PyObject *result;
+    Py_BEGIN_CRITICAL_SECTION2(self, self->conn);
+    result = Cursor_Close(self);
+    Py_END_CRITICAL_SECTION2();
+    return result;
+}
+
+
+static PyObject* Cursor_Exit_locked(Cursor *self, PyObject* args)
+{
+    PyObject *result;
+    Py_BEGIN_CRITICAL_SECTION2(self, self->conn);
+    result = Cursor_Exit(self, args);
+    Py_END_CRITICAL_SECTION2();
+    return result;
+}
+
+
+static PyObject* Cursor_Execute_locked(Cursor *self, PyObject *args, PyObject *kwargs)
+{
+    PyObject *result;
+    Py_BEGIN_CRITICAL_SECTION2(self, self->conn);
+    result = Cursor_Execute(self, args, kwargs);
+    Py_END_CRITICAL_SECTION2();
+    return result;
+}
+
+
+static PyObject* Cursor_Fetchall_locked(Cursor *self)
+{
+    PyObject *result;
+    Py_BEGIN_CRITICAL_SECTION2(self, self->conn);
+    result = Cursor_Fetchall(self);
+    Py_END_CRITICAL_SECTION2();
+    return result;
+}
+
+
+static PyObject* Cursor_Fetchmany_locked(Cursor *self, PyObject *args, PyObject *kwargs)
+{
+    PyObject *result;
+    Py_BEGIN_CRITICAL_SECTION2(self, self->conn);
+    result = Cursor_Fetchmany(self, args, kwargs);
+    Py_END_CRITICAL_SECTION2();
+    return result;
+}
+
+
+static PyObject* Cursor_FetchallAsync_locked(Cursor *self)
+{
+    PyObject *result;
+    Py_BEGIN_CRITICAL_SECTION2(self, self->conn);
+    result = Cursor_FetchallAsync(self);
+    Py_END_CRITICAL_SECTION2();
+    return result;
+}
+
+
+static PyObject* Cursor_FetchmanyAsync_locked(Cursor *self, PyObject *args, PyObject *kwargs)
+{
+    PyObject *result;
+    Py_BEGIN_CRITICAL_SECTION2(self, self->conn);
+    result = Cursor_FetchmanyAsync(self, args, kwargs);
+    Py_END_CRITICAL_SECTION2();
+    return result;
+}
+
+
+static PyObject* Cursor_Prefetch_locked(Cursor *self, PyObject *args, PyObject *kwargs)
+{
+    PyObject *result;
+    Py_BEGIN_CRITICAL_SECTION2(self, self->conn);
+    result = Cursor_Prefetch(self, args, kwargs);
+    Py_END_CRITICAL_SECTION2();
+    return result;
+}
+
+
+static PyObject* Cursor_Executemany_locked(Cursor *self, PyObject *args, PyObject *kwargs)
+{
+    PyObject *result;
+    Py_BEGIN_CRITICAL_SECTION2(self, self->conn);
+    result = Cursor_Executemany(self, args, kwargs);
+    Py_END_CRITICAL_SECTION2();
+    return result;
+}
+
+
+static PyObject* Cursor_InsertColumns_locked(Cursor *self, PyObject *args, PyObject *kwargs)
+{
+    PyObject *result;
+    Py_BEGIN_CRITICAL_SECTION2(self, self->conn);
+    result = Cursor_InsertColumns(self, args, kwargs);
+    Py_END_CRITICAL_SECTION2();
+    return result;
+}
+
+
+static PyObject* Cursor_Nextset_locked(Cursor *self)
+{
+    PyObject *result;
+    Py_BEGIN_CRITICAL_SECTION2(self, self->conn);
+    result = Cursor_Nextset(self);
+    Py_END_CRITICAL_SECTION2();
+    return result;
+}
+
+
+static PyObject* Cursor_NextsetAsync_locked(Cursor *self)
+{
+    PyObject *result;
+    Py_BEGIN_CRITICAL_SECTION2(self, self->conn);
+    result = Cursor_NextsetAsync(self);
+    Py_END_CRITICAL_SECTION2();
+    return result;
+}
+
+
+static PyObject* Cursor_FetchAllSets_locked(Cursor *self)
+{
+    PyObject *result;
+    Py_BEGIN_CRITICAL_SECTION2(self, self->conn);
+    result = Cursor_FetchAllSets(self);
+    Py_END_CRITICAL_SECTION2();
+    return result;
+}
+
+
+static PyObject* Cursor_Prepare_locked(Cursor *self, PyObject *args, PyObject *kwargs)
+{
+    PyObject *result;
+    Py_BEGIN_CRITICAL_SECTION2(self, self->conn);
+    result = Cursor_Prepare(self, args, kwargs);
+    Py_END_CRITICAL_SECTION2();
+    return result;
 }
 
 
 static PyMethodDef Cursor_Methods[] = {
     {"__enter__", (PyCFunction)Cursor_Iter, METH_NOARGS, "Open a cursor"},
-    {"__exit__", (PyCFunction)Cursor_Exit, METH_VARARGS, "Close a cursor"},
-    {"execute", (PyCFunction)Cursor_Execute, METH_VARARGS|METH_KEYWORDS, "Asynchronous execution"},
-    {"fetchall", (PyCFunction)Cursor_Fetchall, METH_NOARGS, "Fetchall results"},
-    {"close", (PyCFunction)Cursor_Close, METH_NOARGS, "Close a cursor"},
+    {"__exit__", (PyCFunction)Cursor_Exit_locked, METH_VARARGS, "Close a cursor"},
+    {"execute", (PyCFunction)Cursor_Execute_locked, METH_VARARGS|METH_KEYWORDS, "Asynchronous execution"},
+    {"executemany", (PyCFunction)Cursor_Executemany_locked, METH_VARARGS|METH_KEYWORDS, "Asynchronous execution of the batches"},
+    {"insert_columns", (PyCFunction)Cursor_InsertColumns_locked, METH_VARARGS|METH_KEYWORDS, "Asynchronous execution of the columns"},
+    {"prepare", (PyCFunction)Cursor_Prepare_locked, METH_VARARGS|METH_KEYWORDS, "Asynchronous preparing"},
+    {"fetchall", (PyCFunction)Cursor_Fetchall_locked, METH_NOARGS, "Fetchall results"},
+    {"fetchmany", (PyCFunction)Cursor_Fetchmany_locked, METH_VARARGS|METH_KEYWORDS, "Fetch the next rows"},
+    {"fetchall_async", (PyCFunction)Cursor_FetchallAsync_locked, METH_NOARGS, "Asynchronous fetchall"},
+    {"fetchmany_async", (PyCFunction)Cursor_FetchmanyAsync_locked, METH_VARARGS|METH_KEYWORDS, "Asynchronous fetching of the next rows"},
+    {"prefetch", (PyCFunction)Cursor_Prefetch_locked, METH_VARARGS|METH_KEYWORDS, "Stream results with the prefetching"},
+    {"nextset", (PyCFunction)Cursor_Nextset_locked, METH_NOARGS, "Go to the next result set"},
+    {"nextset_async", (PyCFunction)Cursor_NextsetAsync_locked, METH_NOARGS, "Asynchronous going to the next result set"},
+    {"fetch_all_sets", (PyCFunction)Cursor_FetchAllSets_locked, METH_NOARGS, "Asynchronous fetching of all result sets"},
+    {"close", (PyCFunction)Cursor_Close_locked, METH_NOARGS, "Close a cursor"},
     {NULL, NULL, 0, NULL}
 };
 
 
-PyTypeObject Cursor_Type = {
-    PyVarObject_HEAD_INIT(NULL, 0)
-    .tp_name = "pyaodbc.Cursor",
-    .tp_doc = PyDoc_STR("Asynchronous Cursor Class"),
-    .tp_basicsize = sizeof(Cursor),
-    .tp_itemsize = 0,
-    .tp_flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE,
-    .tp_iter = (getiterfunc)Cursor_Iter,
-    .tp_iternext = (iternextfunc)Cursor_Next,
-    .tp_dealloc = (destructor)Cursor_Dealloc,
-    .tp_as_async = &Cursor_Awaitable,
-    .tp_methods = Cursor_Methods
+static PyGetSetDef Cursor_GetSet[] = {
+    {"rowcount", (getter)Cursor_GetRowcount, NULL, "The rows affected by the statement of the current result, -1 if it's unknown", NULL},
+    {NULL, NULL, NULL, NULL, NULL}
+};
+
+
+static PyType_Slot Cursor_Slots[] = {
+    {Py_tp_doc, (void *)PyDoc_STR("Asynchronous Cursor Class")},
+    {Py_tp_iter, (void *)Cursor_Iter},
+    {Py_tp_iternext, (void *)Cursor_Next_locked},
+    {Py_tp_dealloc, (void *)Cursor_Dealloc},
+    {Py_am_await, (void *)Cursor_Iter},
+    {Py_am_aiter, (void *)Cursor_Iter},
+    {Py_am_anext, (void *)Cursor_ANext_locked},
+    {Py_tp_methods, Cursor_Methods},
+    {Py_tp_getset, Cursor_GetSet},
+    {0, NULL}
+};
+
+
+PyType_Spec Cursor_Spec = {
+    .name = "pyaodbc.Cursor",
+    .basicsize = sizeof(Cursor),
+    .itemsize = 0,
+    .flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE | TPFLAGS_NO_INSTANTIATION,
+    .slots = Cursor_Slots
 };
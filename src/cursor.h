@@ -5,26 +5,76 @@
 #include "aodbc_types.h"
 
 
-PyTypeObject Cursor_Type;
+PyType_Spec Cursor_Spec;
 
-void free_parameters(parameters_info *p_info);
+void free_parameters(Cursor *self);
 int free_cursor(Cursor *self);
 int allocate_cursor(Cursor *self, Connection *conn);
-Py_ssize_t get_count_query_parameters(const wchar_t *query);
-int check_parameters_equality(const wchar_t *query, Py_ssize_t params_length);
 
 #ifdef __linux__
-void* t_sql_exec_direct_w(void *handle);
-extern short wait_for_single_object(t_event *event, unsigned long milliseconds);
-extern char16_t* wctouc(const wchar_t *wc);
-extern wchar_t* uctowc(char16_t *uc);
+void* t_sql_execute(void *handle);
+int t_sql_exec_direct_poll(poll_entry *entry);
+void* t_sql_put_data(void *handle);
+void* t_sql_fetch(void *handle);
+void* t_sql_more_results(void *handle);
+extern int await_event(HANDLE event, double rate, PyObject **waiter);
 #endif
 
-int prepare_execute(Cursor *self, const wchar_t *query, PyObject *params, Py_ssize_t params_length, long long timeout);
+int prepare_execute(
+    Cursor *self, const wchar_t *query, PyObject *params, Py_ssize_t params_length, double timeout, int is_prepare_only
+);
+void release_slot(Connection *conn);
+void fail_queued_cursors(Connection *conn);
+
+#ifdef __linux__
+void cancel_cursor(Cursor *self, PyObject *future);
+void complete_cancelled_cursor(Cursor *self);
+#endif
 
 extern int check_error(PyObject *self, const char *fn_name);
+extern SQLRETURN take_statement(Connection *conn, SQLHSTMT *handle);
+extern SQLHSTMT take_prepared_statement(Connection *conn, const wchar_t *query, const wchar_t **key);
+extern SQLRETURN keep_statement(Connection *conn, SQLHSTMT handle, const wchar_t *query);
+extern int start_deadline(Connection *conn, timer_entry *entry, double timeout);
+extern void stop_deadline(Connection *conn, timer_entry *entry);
 extern int bind_parameter(Cursor *self, Py_ssize_t parameter_number, PyObject *param, parameter *parameter_data);
-extern PyObject* get_data(Cursor *self, SQLUSMALLINT column_number, SQLSMALLINT sql_type);
+extern void release_views(parameters_info *p_info);
+extern int bind_parameter_array(
+    Cursor *self, Py_ssize_t parameter_number, PyObject **rows, Py_ssize_t row_count, parameter_array *array
+);
+extern int bind_column_array(
+    Cursor *self, Py_ssize_t parameter_number, column_source *source, Py_ssize_t offset, Py_ssize_t row_count,
+    parameter_array *array
+);
+extern int open_column_source(PyObject *key, PyObject *column, column_source *source);
+extern void close_column_source(column_source *source);
+extern int describe_columns(Cursor *self, const char **failed_fn);
+extern int create_column_keys(Cursor *self);
+extern void free_columns(Cursor *self);
+extern int raise_read_error(Cursor *self, int code, const char *failed_fn);
+extern PyObject* get_row(Cursor *self);
+extern row_batch* create_batch(size_t limit);
+extern int fetch_rows(Cursor *self, row_batch *batch);
+extern PyObject* convert_rows(Cursor *self, row_batch *batch);
+extern void free_batch(Cursor *self, row_batch *batch);
+extern prefetch_info* create_prefetch(size_t size, size_t depth);
+extern void free_prefetch(Cursor *self, prefetch_info *prefetch);
+extern row_batch* pop_batch(Cursor *self, int *is_end);
+extern int fill_batches(Cursor *self);
+extern void stop_prefetch(Cursor *self);
+extern PyObject* parse_query(Connection *conn, PyObject *py_query);
+extern parsed_query* get_parsed_query(PyObject *parsed);
+extern const wchar_t* copy_parsed_query(parsed_query *parsed);
+extern int check_parameters_equality(parsed_query *parsed, Py_ssize_t params_length);
+extern PyObject* order_parameters(parsed_query *parsed, PyObject *params, const char *fn_name);
+extern int read_chunk(parameter_stream *stream, PyObject **waiter);
+extern void put_streams(Cursor *self);
+extern void release_streams(parameters_info *p_info);
+extern void arena_init(arena *memory);
+extern void* arena_alloc(arena *memory, size_t size);
+extern void arena_trim(arena *memory, void *last, size_t size);
+extern void arena_reset(arena *memory);
+extern void arena_free(arena *memory);
 
 
 #endif
@@ -0,0 +1,273 @@
+#include "event_loop.h"
+#include "aodbc_types.h"
+
+
+#ifdef __linux__
+
+
+// begin static declarations
+static PyObject* on_event_ready(PyObject *capsule, PyObject *unused);
+static PyMethodDef on_event_ready_def;
+static PyObject* on_future_done(PyObject *owner, PyObject *future);
+static PyMethodDef on_future_done_def;
+// end static declarations
+
+
+static PyObject* on_event_ready(PyObject *capsule, PyObject *unused)
+{
+    PRINT_DEBUG_MESSAGE(__FUNCTION__);
+
+    HANDLE event = (HANDLE)PyCapsule_GetPointer(capsule, "pyaodbc.event");
+    if (event == NULL) {
+        return NULL;
+    }
+
+    // the eventfd stays readable until the awaitable reads it, so the reader is removed at once
+    PyObject *result = PyObject_CallMethod(event->loop, "remove_reader", "i", event->fd);
+    if (result == NULL) {
+        return NULL;
+    }
+    Py_DECREF(result);
+
+    PyObject *done = PyObject_CallMethod(event->future, "done", NULL);
+    if (done == NULL) {
+        return NULL;
+    }
+
+    if (done == Py_False) {
+        result = PyObject_CallMethod(event->future, "set_result", "O", Py_None);
+        if (result == NULL) {
+            Py_DECREF(done);
+            return NULL;
+        }
+        Py_DECREF(result);
+    }
+
+    Py_CLEAR(event->loop);
+    Py_CLEAR(event->future);
+
+    if (done == Py_True) {
+        // nobody awaits the result of the cancelled waiting, the event can be closed here
+        Py_DECREF(done);
+        complete_cancelled_awaitable((PyObject *)event->obj);
+        Py_RETURN_NONE;
+    }
+    Py_DECREF(done);
+
+    Py_RETURN_NONE;
+}
+
+
+static PyMethodDef on_event_ready_def = {
+    "_on_event_ready", (PyCFunction)on_event_ready, METH_NOARGS, "Wake up an awaitable"
+};
+
+
+/*
+    It's bound to the cursor or the connection, so the owner is alive, even if its event is already closed
+*/
+static PyObject* on_future_done(PyObject *owner, PyObject *future)
+{
+    PRINT_DEBUG_MESSAGE(__FUNCTION__);
+
+    PyObject *cancelled = PyObject_CallMethod(future, "cancelled", NULL);
+    if (cancelled == NULL) {
+        return NULL;
+    }
+
+    if (cancelled == Py_True) {
+        cancel_awaitable(owner, future);
+    }
+    Py_DECREF(cancelled);
+
+    Py_RETURN_NONE;
+}
+
+
+static PyMethodDef on_future_done_def = {
+    "_on_future_done", (PyCFunction)on_future_done, METH_O, "Cancel an operation of the cancelled awaitable"
+};
+
+
+/*
+    asyncio.get_running_loop is cached in the state of the module, because each interpreter has its own asyncio
+*/
+static PyObject* get_loop(HANDLE event)
+{
+    module_state *state = get_object_state((PyObject *)event->obj);
+    PyObject *function = atomic_load(&state->get_running_loop);
+
+    if (function == NULL) {
+        PyObject *asyncio = PyImport_ImportModule("asyncio");
+        if (asyncio == NULL) {
+            return NULL;
+        }
+
+        function = PyObject_GetAttrString(asyncio, "get_running_loop");
+        Py_DECREF(asyncio);
+        if (function == NULL) {
+            return NULL;
+        }
+
+        // another thread can be the first without the GIL
+        PyObject *expected = NULL;
+        if (!atomic_compare_exchange_strong(&state->get_running_loop, &expected, function)) {
+            Py_DECREF(function);
+            function = expected;
+        }
+    }
+
+    return PyObject_CallObject(function, NULL);
+}
+
+
+/*
+    Returns EVENT_READY if the worker has already finished.
+    Otherwise returns EVENT_WAIT and a waiter to yield from __next__:
+    a future which is resolved by the eventfd reader of the running loop,
+    or None without a running loop, after the blocking wait for 50 * rate milliseconds
+*/
+int await_event(HANDLE event, double rate, PyObject **waiter)
+{
+    PRINT_DEBUG_MESSAGE(__FUNCTION__);
+
+    if (wait_for_single_object(event, 0) == WAIT_OBJECT_0) {
+        return EVENT_READY;
+    }
+
+    if (event->future != NULL) {
+        PyObject *done = PyObject_CallMethod(event->future, "done", NULL);
+        if (done == NULL) {
+            return -1;
+        }
+
+        if (done == Py_False) {
+            // the same future is yielded again, if the awaitable was resumed before the wakeup
+            Py_DECREF(done);
+            Py_INCREF(event->future);
+            *waiter = event->future;
+            return EVENT_WAIT;
+        }
+
+        // the future of a cancelled waiting
+        Py_DECREF(done);
+        release_event_waiter(event);
+    }
+
+    PyObject *loop = get_loop(event);
+    if (loop == NULL) {
+        if (!PyErr_ExceptionMatches(PyExc_RuntimeError)) {
+            return -1;
+        }
+        PyErr_Clear();
+
+        short state;
+        Py_BEGIN_ALLOW_THREADS
+        state = wait_for_single_object(event, (int)(50 * rate));
+        Py_END_ALLOW_THREADS
+
+        if (state == WAIT_OBJECT_0) {
+            return EVENT_READY;
+        }
+
+        Py_INCREF(Py_None);
+        *waiter = Py_None;
+        return EVENT_WAIT;
+    }
+
+    PyObject *future = PyObject_CallMethod(loop, "create_future", NULL);
+    if (future == NULL) {
+        Py_DECREF(loop);
+        return -1;
+    }
+
+    PyObject *capsule = PyCapsule_New(event, "pyaodbc.event", NULL);
+    if (capsule == NULL) {
+        goto clean_up;
+    }
+
+    PyObject *callback = PyCFunction_New(&on_event_ready_def, capsule);
+    Py_DECREF(capsule);
+    if (callback == NULL) {
+        goto clean_up;
+    }
+
+    PyObject *result = PyObject_CallMethod(loop, "add_reader", "iO", event->fd, callback);
+    Py_DECREF(callback);
+    if (result == NULL) {
+        goto clean_up;
+    }
+    Py_DECREF(result);
+
+    // a task cancels the awaited future, so its callback propagates the cancellation into the driver
+    callback = PyCFunction_New(&on_future_done_def, (PyObject *)event->obj);
+    if (callback == NULL) {
+        goto remove_reader;
+    }
+
+    result = PyObject_CallMethod(future, "add_done_callback", "O", callback);
+    Py_DECREF(callback);
+    if (result == NULL) {
+        goto remove_reader;
+    }
+    Py_DECREF(result);
+
+    // the same as asyncio.Future.__await__ does before yielding
+    if (PyObject_SetAttrString(future, "_asyncio_future_blocking", Py_True) == -1) {
+        goto remove_reader;
+    }
+
+    event->loop = loop;
+    event->future = future;
+
+    Py_INCREF(future);
+    *waiter = future;
+    return EVENT_WAIT;
+
+    remove_reader:
+        event->loop = loop;
+        event->future = future;
+        release_event_waiter(event);
+        return -1;
+
+    clean_up:
+        Py_DECREF(future);
+        Py_DECREF(loop);
+        return -1;
+}
+
+
+void release_event_waiter(HANDLE event)
+{
+    PRINT_DEBUG_MESSAGE(__FUNCTION__);
+
+    if (event->loop == NULL) {
+        return;
+    }
+
+    PyObject *type, *value, *traceback;
+    PyErr_Fetch(&type, &value, &traceback);
+
+    PyObject *result = PyObject_CallMethod(event->loop, "remove_reader", "i", event->fd);
+    if (result == NULL) {
+        PyErr_Clear();  // e.g. the loop is already closed
+    }
+    Py_XDECREF(result);
+
+    // the object is closed while another task awaits it, the task mustn't hang
+    if (event->future != NULL) {
+        result = PyObject_CallMethod(event->future, "cancel", NULL);
+        if (result == NULL) {
+            PyErr_Clear();
+        }
+        Py_XDECREF(result);
+    }
+
+    PyErr_Restore(type, value, traceback);
+
+    Py_CLEAR(event->loop);
+    Py_CLEAR(event->future);
+}
+
+
+#endif
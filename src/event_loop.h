@@ -0,0 +1,25 @@
+#ifndef _EVENT_LOOP_H_
+#define _EVENT_LOOP_H_
+
+
+#include "headers.h"
+
+
+#define EVENT_READY 0
+#define EVENT_WAIT 1
+
+
+#ifdef __linux__
+
+int await_event(HANDLE event, double rate, PyObject **waiter);
+void release_event_waiter(HANDLE event);
+
+extern short wait_for_single_object(t_event *event, int milliseconds);
+extern void cancel_awaitable(PyObject *self, PyObject *future);
+extern void complete_cancelled_awaitable(PyObject *self);
+extern struct module_state* get_object_state(PyObject *self);
+
+#endif
+
+
+#endif
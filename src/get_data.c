@@ -1,677 +1,709 @@
 #include "get_data.h"
 
 
-PyObject* get_integer_smallint(Cursor *self, SQLUSMALLINT column_number)
-{
-    PRINT_DEBUG_MESSAGE(__FUNCTION__);
-
-    SQLLEN is_unsigned;
-    SQLLEN len_or_indicator;
-    SQLINTEGER value;
-    SQLSMALLINT target_type;
-
-    self->retcode = SQLColAttribute(
-        self->handle,
-        (SQLUSMALLINT)(column_number + 1),
-        SQL_DESC_UNSIGNED,
-        0,
-        0,
-        0,
-        &is_unsigned
-    );
-    if (check_error((PyObject *)self, "get_integer_smallint::SQLColAttribute")) {
-        return NULL;
-    }
+#if PY_LITTLE_ENDIAN
+#define SQLWCHAR_BYTEORDER -1
+#else
+#define SQLWCHAR_BYTEORDER 1
+#endif
 
-    target_type = is_unsigned ? SQL_C_ULONG : SQL_C_LONG;
 
-    self->retcode = SQLGetData(
-        self->handle,
-        (SQLUSMALLINT)(column_number + 1),
-        target_type,
-        &value,
-        sizeof(value),
-        &len_or_indicator
-    );
-    if (check_error((PyObject *)self, "get_integer_smallint::SQLGetData")) {
-        return NULL;
-    }
-
-    if (len_or_indicator == SQL_NULL_DATA) {
-        Py_RETURN_NONE;
-    } else if (is_unsigned) {
-        return PyLong_FromUnsignedLong((unsigned long)value);
-    } else {
-        return PyLong_FromLong(value);
+static SQLSMALLINT get_target_type(SQLSMALLINT sql_type, SQLLEN is_unsigned)
+{
+    switch (sql_type) {
+        case SQL_INTEGER:
+        case SQL_SMALLINT:
+            return is_unsigned ? SQL_C_ULONG : SQL_C_LONG;
+        case SQL_BIGINT:
+            return is_unsigned ? SQL_C_UBIGINT : SQL_C_SBIGINT;
+        case SQL_NUMERIC:
+        case SQL_DECIMAL:
+            return SQL_ARD_TYPE;
+        case SQL_BIT:
+            return SQL_C_BIT;
+        case SQL_TINYINT:
+            return is_unsigned ? SQL_C_UTINYINT : SQL_C_STINYINT;
+        case SQL_FLOAT:
+        case SQL_REAL:
+        case SQL_DOUBLE:
+            return SQL_C_DOUBLE;
+        case SQL_TYPE_TIMESTAMP:
+            return SQL_C_TYPE_TIMESTAMP;
+        case SQL_TYPE_DATE:
+            return SQL_C_TYPE_DATE;
+        case SQL_TYPE_TIME:
+        case -154:  // SQL Server 2008+
+            return SQL_C_TYPE_TIME;
+        case -155:  // datetimeoffset
+            return SQL_C_CHAR;
+        case SQL_BINARY:
+        case SQL_VARBINARY:
+        case SQL_LONGVARBINARY:
+            return SQL_C_BINARY;
+        default:
+            // SQL_CHAR, SQL_VARCHAR, SQL_LONGVARCHAR, SQL_WCHAR, SQL_WVARCHAR, SQL_WLONGVARCHAR and others
+            return SQL_C_WCHAR;
     }
 }
 
 
-PyObject* get_bigint(Cursor *self, SQLUSMALLINT column_number)
+static int describe_numeric(Cursor *self, SQLHDESC desc, SQLUSMALLINT column_number, const char **failed_fn)
 {
-    PRINT_DEBUG_MESSAGE(__FUNCTION__);
+    SQLLEN scale;
+    SQLLEN precision;
 
-    SQLLEN is_unsigned;
-    SQLLEN len_or_indicator;
-    SQLBIGINT value;
-    SQLSMALLINT target_type;
+    self->retcode = SQLColAttribute(self->handle, column_number, SQL_DESC_SCALE, 0, 0, 0, &scale);
+    if (!SQL_SUCCEEDED(self->retcode)) {
+        *failed_fn = "describe_numeric::SQLColAttribute::SQL_DESC_SCALE";
+        return READ_ERROR;
+    }
 
-    self->retcode = SQLColAttribute(
-        self->handle,
-        (SQLUSMALLINT)(column_number + 1),
-        SQL_DESC_UNSIGNED,
-        0,
-        0,
-        0,
-        &is_unsigned
-    );
-    if (check_error((PyObject *)self, "get_bigint::SQLColAttribute")) {
-        return NULL;
+    self->retcode = SQLColAttribute(self->handle, column_number, SQL_DESC_PRECISION, 0, 0, 0, &precision);
+    if (!SQL_SUCCEEDED(self->retcode)) {
+        *failed_fn = "describe_numeric::SQLColAttribute::SQL_DESC_PRECISION";
+        return READ_ERROR;
     }
 
-    target_type = is_unsigned ? SQL_C_UBIGINT : SQL_C_SBIGINT;
+    // SQLGetData with SQL_ARD_TYPE takes the type, the precision and the scale from the application row descriptor
+    self->retcode = SQLSetDescField(desc, (SQLSMALLINT)column_number, SQL_DESC_TYPE, (void *)SQL_C_NUMERIC, 0);
+    if (!SQL_SUCCEEDED(self->retcode)) {
+        *failed_fn = "describe_numeric::SQLSetDescField::SQL_DESC_TYPE";
+        return READ_ERROR;
+    }
 
-    self->retcode = SQLGetData(
-        self->handle,
-        (SQLUSMALLINT)(column_number + 1),
-        target_type,
-        &value,
-        sizeof(value),
-        &len_or_indicator
-    );
-    if (check_error((PyObject *)self, "get_bigint::SQLGetData")) {
-        return NULL;
+    self->retcode = SQLSetDescField(desc, (SQLSMALLINT)column_number, SQL_DESC_PRECISION, (void *)precision, 0);
+    if (!SQL_SUCCEEDED(self->retcode)) {
+        *failed_fn = "describe_numeric::SQLSetDescField::SQL_DESC_PRECISION";
+        return READ_ERROR;
     }
 
-    if (len_or_indicator == SQL_NULL_DATA) {
-        Py_RETURN_NONE;
-    } else if (is_unsigned) {
-        return PyLong_FromUnsignedLongLong((unsigned PY_LONG_LONG)(SQLUBIGINT)value);
-    } else {
-        return PyLong_FromLongLong((PY_LONG_LONG)value);
+    self->retcode = SQLSetDescField(desc, (SQLSMALLINT)column_number, SQL_DESC_SCALE, (void *)scale, 0);
+    if (!SQL_SUCCEEDED(self->retcode)) {
+        *failed_fn = "describe_numeric::SQLSetDescField::SQL_DESC_SCALE";
+        return READ_ERROR;
     }
+
+    return 0;
 }
 
 
-PyObject* get_numeric_decimal(Cursor *self, SQLUSMALLINT column_number)
+int describe_columns(Cursor *self, const char **failed_fn)
 {
     PRINT_DEBUG_MESSAGE(__FUNCTION__);
 
+    result_info *r_info = &self->r_info;
     SQLHDESC desc = SQL_NULL_HDESC;
-    SQLLEN len_or_indicator;
-    SQL_NUMERIC_STRUCT sql_numeric;
-    SQLLEN scale;
-    SQLLEN precision;
-
-    double final_value;
-    double divisor;
-    int sign = 1;
-    int last = 1;
-    int remainder;
-    int integer;
-    int current;
-    long value = 0;
+    SQLSMALLINT column_count;
+    SQLULEN column_size;
+    SQLSMALLINT decimal_digits;
+    SQLSMALLINT nullable;
+    SQLLEN is_unsigned;
 
-    self->retcode = SQLGetStmtAttr(self->handle, SQL_ATTR_APP_ROW_DESC, &desc, 0, NULL);
-    if (check_error((PyObject *)self, "get_numeric_decimal::SQLGetStmtAttr")) {
-        return NULL;
+    if (r_info->is_described) {
+        return 0;
     }
 
-    self->retcode = SQLColAttribute(
-        self->handle,
-        (SQLUSMALLINT)(column_number + 1),
-        SQL_DESC_SCALE,
-        0,
-        0,
-        0,
-        &scale
-    );
-    if (check_error((PyObject *)self, "get_numeric_decimal::SQLColAttribute::SQL_DESC_SCALE")) {
-        return NULL;
+    self->retcode = SQLNumResultCols(self->handle, &column_count);
+    if (!SQL_SUCCEEDED(self->retcode)) {
+        *failed_fn = "describe_columns::SQLNumResultCols";
+        return READ_ERROR;
     }
 
-    self->retcode = SQLColAttribute(
-        self->handle,
-        (SQLUSMALLINT)(column_number + 1),
-        SQL_DESC_PRECISION,
-        0,
-        0,
-        0,
-        &precision
-    );
-    if (check_error((PyObject *)self, "get_numeric_decimal::SQLColAttribute::SQL_DESC_PRECISION")) {
-        return NULL;
+    if (column_count) {
+        r_info->columns = (column_info *)malloc(sizeof(column_info) * column_count);
+        if (r_info->columns == NULL) {
+            return READ_NO_MEMORY;
+        }
     }
+    r_info->column_count = column_count;
 
-    self->retcode = SQLSetDescField(desc, (SQLSMALLINT)(column_number + 1), SQL_DESC_TYPE, (void *)SQL_C_NUMERIC, 0);
-    if (check_error((PyObject *)self, "get_numeric_decimal::SQLSetDescField::SQL_DESC_TYPE")) {
-        return NULL;
-    }
+    for (SQLUSMALLINT i = 0; i < column_count; i++) {
+        column_info *column = &r_info->columns[i];
+        column->key = NULL;
 
-    self->retcode = SQLSetDescField(desc, (SQLSMALLINT)(column_number + 1), SQL_DESC_PRECISION, (void *)precision, 0);
-    if (check_error((PyObject *)self, "get_numeric_decimal::SQLSetDescField::SQL_DESC_PRECISION")) {
-        return NULL;
-    }
+        self->retcode = SQLDescribeColW(
+            self->handle,
+            (SQLUSMALLINT)(i + 1),
+            column->name,
+            sizeof(column->name) / sizeof(SQLWCHAR),
+            &column->name_length,
+            &column->sql_type,
+            &column_size,
+            &decimal_digits,
+            &nullable
+        );
+        if (!SQL_SUCCEEDED(self->retcode)) {
+            *failed_fn = "describe_columns::SQLDescribeColW";
+            return READ_ERROR;
+        }
 
-    self->retcode = SQLSetDescField(desc, (SQLSMALLINT)(column_number + 1), SQL_DESC_SCALE, (void *)scale, 0);
-    if (check_error((PyObject *)self, "get_numeric_decimal::SQLSetDescField::SQL_DESC_SCALE")) {
-        return NULL;
-    }
+        if (column->name_length >= (SQLSMALLINT)(sizeof(column->name) / sizeof(SQLWCHAR))) {
+            column->name_length = sizeof(column->name) / sizeof(SQLWCHAR) - 1;  // a truncated name
+        }
 
-    self->retcode = SQLGetData(
-        self->handle,
-        (SQLUSMALLINT)(column_number + 1),
-        SQL_ARD_TYPE,
-        &sql_numeric,
-        sizeof(sql_numeric),
-        &len_or_indicator
-    );
-    if (check_error((PyObject *)self, "get_numeric_decimal::SQLGetData")) {
-        return NULL;
-    }
+        is_unsigned = 0;
+        if (
+            column->sql_type == SQL_INTEGER || column->sql_type == SQL_SMALLINT || \
+            column->sql_type == SQL_BIGINT || column->sql_type == SQL_TINYINT
+        ) {
+            self->retcode = SQLColAttribute(self->handle, (SQLUSMALLINT)(i + 1), SQL_DESC_UNSIGNED, 0, 0, 0, &is_unsigned);
+            if (!SQL_SUCCEEDED(self->retcode)) {
+                *failed_fn = "describe_columns::SQLColAttribute::SQL_DESC_UNSIGNED";
+                return READ_ERROR;
+            }
+        }
 
-    if (len_or_indicator == SQL_NULL_DATA) {
-        Py_RETURN_NONE;
-    } else {
-        for (int i = 0; i < SQL_MAX_NUMERIC_LEN; i++) {
-            current = (int)sql_numeric.val[i];
-            remainder = current % 16;
-            integer = current / 16;
-
-            value += last * remainder;
-            last *= 16;
-            value += last * integer;
-            last *= 16;
+        column->c_type = get_target_type(column->sql_type, is_unsigned);
+
+        // a binary value of the known size is read by one call, the size of the max types is 0
+        column->data_size = VAR_DATA_INITIAL_SIZE;
+        if (column->c_type == SQL_C_BINARY && column_size && column_size <= VAR_DATA_MAX_PRESIZE) {
+            column->data_size = (size_t)column_size;
         }
 
-        divisor = pow(10, (double)sql_numeric.scale);
-        final_value = (double)value / divisor;
-        
-        if (!sql_numeric.sign) {
-            sign = -1;
+        if (column->c_type == SQL_ARD_TYPE) {
+            if (desc == SQL_NULL_HDESC) {
+                self->retcode = SQLGetStmtAttr(self->handle, SQL_ATTR_APP_ROW_DESC, &desc, 0, NULL);
+                if (!SQL_SUCCEEDED(self->retcode)) {
+                    *failed_fn = "describe_columns::SQLGetStmtAttr";
+                    return READ_ERROR;
+                }
+            }
+
+            int code = describe_numeric(self, desc, (SQLUSMALLINT)(i + 1), failed_fn);
+            if (code) {
+                return code;
+            }
         }
-        final_value *= sign;
-        
-        return PyFloat_FromDouble(final_value);
-    } 
+    }
+
+    r_info->is_described = 1;
+    return 0;
 }
 
 
-PyObject* get_bit(Cursor *self, SQLUSMALLINT column_number)
+int create_column_keys(Cursor *self)
 {
     PRINT_DEBUG_MESSAGE(__FUNCTION__);
 
-    SQLLEN len_or_indicator;
-    SQLCHAR value;
+    int byteorder;
 
-    self->retcode = SQLGetData(
-        self->handle,
-        (SQLUSMALLINT)(column_number + 1),
-        SQL_C_BIT,
-        &value,
-        sizeof(value),
-        &len_or_indicator
-    );
+    for (SQLSMALLINT i = 0; i < self->r_info.column_count; i++) {
+        column_info *column = &self->r_info.columns[i];
+        if (column->key != NULL) {
+            continue;
+        }
 
-    if (check_error((PyObject *)self, "get_bit::SQLGetData")) {
-        return NULL;
+        byteorder = SQLWCHAR_BYTEORDER;
+        column->key = PyUnicode_DecodeUTF16(
+            (const char *)column->name,
+            (Py_ssize_t)column->name_length * sizeof(SQLWCHAR),
+            NULL,
+            &byteorder
+        );
+        if (column->key == NULL) {
+            PyErr_Format(PyExc_Exception, "(%s) Failed to get FieldName", __FUNCTION__);
+            return -1;
+        }
+        PyUnicode_InternInPlace(&column->key);
     }
 
-    if (len_or_indicator == SQL_NULL_DATA) {
-        Py_RETURN_NONE;
-    } else {
-        return PyBool_FromLong((long)value);
-    }
+    return 0;
 }
 
 
-PyObject* get_tinyint(Cursor *self, SQLUSMALLINT column_number)
+void free_columns(Cursor *self)
 {
     PRINT_DEBUG_MESSAGE(__FUNCTION__);
 
-    SQLLEN is_unsigned;
-    SQLLEN len_or_indicator;
-    SQLCHAR value;
-    SQLSMALLINT target_type;
-    
-    self->retcode = SQLColAttribute(
-        self->handle,
-        (SQLUSMALLINT)(column_number + 1),
-        SQL_DESC_UNSIGNED,
-        0,
-        0,
-        0,
-        &is_unsigned
-    );
-    if (check_error((PyObject *)self, "get_tinyint::SQLColAttribute")) {
-        return NULL;
+    result_info *r_info = &self->r_info;
+
+    if (r_info->columns != NULL) {
+        for (SQLSMALLINT i = 0; i < r_info->column_count; i++) {
+            Py_XDECREF(r_info->columns[i].key);
+        }
+        free(r_info->columns);
+        r_info->columns = NULL;
     }
 
-    target_type = is_unsigned ? SQL_C_UTINYINT : SQL_C_STINYINT;
+    r_info->column_count = 0;
+    r_info->row_count = -1;
+    r_info->is_described = 0;
+    r_info->is_end = 0;
+}
 
-    self->retcode = SQLGetData(
-        self->handle,
-        (SQLUSMALLINT)(column_number + 1),
-        target_type,
-        &value,
-        sizeof(value),
-        &len_or_indicator
-    );
 
-    if (check_error((PyObject *)self, "get_tinyint::SQLGetData")) {
-        return NULL;
-    }
+/*
+    The value is read into the end of the arena, the unused bytes are returned for the next values
+*/
+static int read_var_data(
+    Cursor *self,
+    SQLUSMALLINT column_number,
+    SQLSMALLINT c_type,
+    size_t terminator,
+    size_t allocated,
+    cell *value,
+    arena *memory,
+    const char **failed_fn
+)
+{
+    SQLLEN len_or_indicator;
+    size_t length = 0;  // bytes without the terminator
 
-    if (len_or_indicator == SQL_NULL_DATA) {
-        Py_RETURN_NONE;
-    } else if (is_unsigned) {
-        return PyLong_FromUnsignedLong((unsigned long)value);
-    } else {
-        return PyLong_FromLong((long)value);
+    char *buffer = (char *)arena_alloc(memory, allocated);
+    if (buffer == NULL) {
+        return READ_NO_MEMORY;
     }
-}
 
+    for (;;) {
+        self->retcode = SQLGetData(
+            self->handle,
+            column_number,
+            c_type,
+            &buffer[length],
+            (SQLLEN)(allocated - length),
+            &len_or_indicator
+        );
 
-PyObject* get_float(Cursor *self, SQLUSMALLINT column_number)
-{
-    PRINT_DEBUG_MESSAGE(__FUNCTION__);
+        if (self->retcode == SQL_NO_DATA) {
+            break;  // the previous part was the last
+        }
 
-    SQLLEN len_or_indicator;
-    SQLREAL value;
+        if (!SQL_SUCCEEDED(self->retcode)) {
+            arena_trim(memory, buffer, 0);
+            *failed_fn = "read_var_data::SQLGetData";
+            return READ_ERROR;
+        }
 
-    self->retcode = SQLGetData(
-        self->handle,
-        (SQLUSMALLINT)(column_number + 1),
-        SQL_C_FLOAT,
-        &value,
-        sizeof(value),
-        &len_or_indicator
-    );
+        if (len_or_indicator == SQL_NULL_DATA) {
+            arena_trim(memory, buffer, 0);
+            value->indicator = SQL_NULL_DATA;
+            value->value.v_data = NULL;
+            return 0;
+        }
 
-    if (check_error((PyObject *)self, "get_float::SQLGetData")) {
-        return NULL;
-    }
+        if (self->retcode == SQL_SUCCESS) {
+            length += (size_t)len_or_indicator;
+            break;
+        }
 
-    if (len_or_indicator == SQL_NULL_DATA) {
-        Py_RETURN_NONE;
-    } else {
-        return PyFloat_FromDouble((double)value);
+        // SQL_SUCCESS_WITH_INFO: the buffer is filled, len_or_indicator is the length before this call
+        size_t readed = allocated - length - terminator;
+        if (len_or_indicator == SQL_NO_TOTAL) {
+            allocated *= 2;
+        } else {
+            allocated = length + (size_t)len_or_indicator + terminator;
+        }
+        length += readed;
+
+        buffer = (char *)arena_grow(memory, buffer, length, allocated);
+        if (buffer == NULL) {
+            return READ_NO_MEMORY;
+        }
     }
+
+    arena_trim(memory, buffer, length + terminator);
+    value->indicator = (SQLLEN)length;
+    value->value.v_data = buffer;
+    return 0;
 }
 
 
-PyObject* get_float_real_double(Cursor *self, SQLUSMALLINT column_number)
+int read_cell(Cursor *self, SQLUSMALLINT column_number, cell *value, arena *memory, const char **failed_fn)
 {
-    PRINT_DEBUG_MESSAGE(__FUNCTION__);
-
-    SQLLEN len_or_indicator;
-    SQLDOUBLE value;
+    column_info *column = &self->r_info.columns[column_number];
+    SQLPOINTER target;
+    SQLLEN buffer_length;
+
+    switch (column->c_type) {
+        case SQL_C_LONG:
+        case SQL_C_ULONG:
+            target = &value->value.v_int;
+            buffer_length = sizeof(value->value.v_int);
+            break;
+        case SQL_C_SBIGINT:
+        case SQL_C_UBIGINT:
+            target = &value->value.v_bigint;
+            buffer_length = sizeof(value->value.v_bigint);
+            break;
+        case SQL_ARD_TYPE:
+            target = &value->value.v_numeric;
+            buffer_length = sizeof(value->value.v_numeric);
+            break;
+        case SQL_C_BIT:
+        case SQL_C_UTINYINT:
+        case SQL_C_STINYINT:
+            target = &value->value.v_char;
+            buffer_length = sizeof(value->value.v_char);
+            break;
+        case SQL_C_DOUBLE:
+            target = &value->value.v_double;
+            buffer_length = sizeof(value->value.v_double);
+            break;
+        case SQL_C_TYPE_TIMESTAMP:
+            target = &value->value.v_datetime;
+            buffer_length = sizeof(value->value.v_datetime);
+            break;
+        case SQL_C_TYPE_DATE:
+            target = &value->value.v_date;
+            buffer_length = sizeof(value->value.v_date);
+            break;
+        case SQL_C_TYPE_TIME:
+            target = &value->value.v_time;
+            buffer_length = sizeof(value->value.v_time);
+            break;
+        case SQL_C_CHAR:
+            return read_var_data(
+                self, (SQLUSMALLINT)(column_number + 1), SQL_C_CHAR, sizeof(SQLCHAR), column->data_size,
+                value, memory, failed_fn
+            );
+        case SQL_C_BINARY:
+            // the bytes don't have the terminator
+            return read_var_data(
+                self, (SQLUSMALLINT)(column_number + 1), SQL_C_BINARY, 0, column->data_size, value, memory, failed_fn
+            );
+        default:
+            return read_var_data(
+                self, (SQLUSMALLINT)(column_number + 1), SQL_C_WCHAR, sizeof(SQLWCHAR), column->data_size,
+                value, memory, failed_fn
+            );
+    }
 
     self->retcode = SQLGetData(
         self->handle,
         (SQLUSMALLINT)(column_number + 1),
-        SQL_C_DOUBLE,
-        &value,
-        sizeof(value),
-        &len_or_indicator
+        column->c_type,
+        target,
+        buffer_length,
+        &value->indicator
     );
-
-    if (check_error((PyObject *)self, "get_float_real_double::SQLGetData")) {
-        return NULL;
+    if (!SQL_SUCCEEDED(self->retcode)) {
+        *failed_fn = "read_cell::SQLGetData";
+        return READ_ERROR;
     }
 
-    if (len_or_indicator == SQL_NULL_DATA) {
-        Py_RETURN_NONE;
-    } else {
-        return PyFloat_FromDouble(value);
-    }
+    return 0;
 }
 
-PyObject* get_datetime(Cursor *self, SQLUSMALLINT column_number)
-{
-    PRINT_DEBUG_MESSAGE(__FUNCTION__);
 
-    SQLLEN len_or_indicator;
-    SQL_TIMESTAMP_STRUCT datetime;
+static PyObject* convert_numeric(SQL_NUMERIC_STRUCT *sql_numeric)
+{
+    double final_value;
+    double divisor;
+    int sign = 1;
+    int last = 1;
+    int remainder;
+    int integer;
+    int current;
+    long value = 0;
 
-    self->retcode = SQLGetData(
-        self->handle,
-        (SQLUSMALLINT)(column_number + 1),
-        SQL_C_TYPE_TIMESTAMP,
-        &datetime,
-        sizeof(datetime),
-        &len_or_indicator
-    );
+    for (int i = 0; i < SQL_MAX_NUMERIC_LEN; i++) {
+        current = (int)sql_numeric->val[i];
+        remainder = current % 16;
+        integer = current / 16;
 
-    if (check_error((PyObject *)self, "get_datetime::SQLGetData")) {
-        return NULL;
+        value += last * remainder;
+        last *= 16;
+        value += last * integer;
+        last *= 16;
     }
 
-    if (len_or_indicator == SQL_NULL_DATA) {
-        Py_RETURN_NONE;
-    } else {
-        return PyDateTime_FromDateAndTime(
-            (int)datetime.year,
-            (int)datetime.month,
-            (int)datetime.day,
-            (int)datetime.hour,
-            (int)datetime.minute,
-            (int)datetime.second,
-            (int)(datetime.fraction / 1000)
-        );
+    divisor = pow(10, (double)sql_numeric->scale);
+    final_value = (double)value / divisor;
+
+    if (!sql_numeric->sign) {
+        sign = -1;
     }
+    final_value *= sign;
+
+    return PyFloat_FromDouble(final_value);
 }
 
 
-PyObject* get_date(Cursor *self, SQLUSMALLINT column_number)
+PyObject* convert_cell(column_info *column, cell *value)
 {
-    PRINT_DEBUG_MESSAGE(__FUNCTION__);
+    union cell_value *v = &value->value;
+    int byteorder = SQLWCHAR_BYTEORDER;
 
-    SQLLEN len_or_indicator;
-    SQL_DATE_STRUCT date;
+    if (value->indicator == SQL_NULL_DATA) {
+        Py_RETURN_NONE;
+    }
 
-    self->retcode = SQLGetData(
-        self->handle,
-        (SQLUSMALLINT)(column_number + 1),
-        SQL_C_TYPE_DATE,
-        &date,
-        sizeof(date),
-        &len_or_indicator
-    );
+    switch (column->c_type) {
+        case SQL_C_LONG:
+            return PyLong_FromLong((long)v->v_int);
+        case SQL_C_ULONG:
+            return PyLong_FromUnsignedLong((unsigned long)(SQLUINTEGER)v->v_int);
+        case SQL_C_SBIGINT:
+            return PyLong_FromLongLong((PY_LONG_LONG)v->v_bigint);
+        case SQL_C_UBIGINT:
+            return PyLong_FromUnsignedLongLong((unsigned PY_LONG_LONG)(SQLUBIGINT)v->v_bigint);
+        case SQL_ARD_TYPE:
+            return convert_numeric(&v->v_numeric);
+        case SQL_C_BIT:
+            return PyBool_FromLong((long)v->v_char);
+        case SQL_C_UTINYINT:
+            return PyLong_FromUnsignedLong((unsigned long)v->v_char);
+        case SQL_C_STINYINT:
+            return PyLong_FromLong((long)(signed char)v->v_char);
+        case SQL_C_DOUBLE:
+            return PyFloat_FromDouble(v->v_double);
+        case SQL_C_TYPE_TIMESTAMP:
+            return PyDateTime_FromDateAndTime(
+                (int)v->v_datetime.year,
+                (int)v->v_datetime.month,
+                (int)v->v_datetime.day,
+                (int)v->v_datetime.hour,
+                (int)v->v_datetime.minute,
+                (int)v->v_datetime.second,
+                (int)(v->v_datetime.fraction / 1000)
+            );
+        case SQL_C_TYPE_DATE:
+            return PyDate_FromDate((int)v->v_date.year, (int)v->v_date.month, (int)v->v_date.day);
+        case SQL_C_TYPE_TIME:
+            return PyTime_FromTime((int)v->v_time.hour, (int)v->v_time.minute, (int)v->v_time.second, 0);
+        case SQL_C_CHAR:
+            return PyUnicode_DecodeUTF8((const char *)v->v_data, value->indicator, NULL);
+        case SQL_C_BINARY:
+            return PyBytes_FromStringAndSize((const char *)v->v_data, value->indicator);
+        default:
+            // SQLWCHAR is UTF-16, so the surrogate pairs are decoded too
+            return PyUnicode_DecodeUTF16((const char *)v->v_data, value->indicator, NULL, &byteorder);
+    }
+}
 
-    if (check_error((PyObject *)self, "get_date::SQLGetData")) {
-        return NULL;
+
+int raise_read_error(Cursor *self, int code, const char *failed_fn)
+{
+    if (code == READ_NO_MEMORY) {
+        PyErr_NoMemory();
+        return -1;
     }
 
-    if (len_or_indicator == SQL_NULL_DATA) {
-        Py_RETURN_NONE;
-    } else {
-        return PyDate_FromDate((int)date.year, (int)date.month, (int)date.day);
+    if (!check_error((PyObject *)self, failed_fn)) {
+        PyErr_Format(PyExc_Exception, "(%s) A failed retcode at getting a data", failed_fn);
     }
+    return -1;
 }
 
 
-PyObject* get_time(Cursor *self, SQLUSMALLINT column_number)
+PyObject* get_data(Cursor *self, SQLUSMALLINT column_number)
 {
     PRINT_DEBUG_MESSAGE(__FUNCTION__);
 
-    SQLLEN len_or_indicator;
-    SQL_TIME_STRUCT time;
+    column_info *column = &self->r_info.columns[column_number];
+    const char *failed_fn = NULL;
+    cell value;
 
-    self->retcode = SQLGetData(
-        self->handle,
-        (SQLUSMALLINT)(column_number + 1),
-        SQL_C_TYPE_TIME,
-        &time,
-        sizeof(time),
-        &len_or_indicator
-    );
-
-    if (check_error((PyObject *)self, "get_time::SQLGetData")) {
+    int code = read_cell(self, column_number, &value, &self->memory, &failed_fn);
+    if (code) {
+        raise_read_error(self, code, failed_fn);
         return NULL;
     }
 
-    if (len_or_indicator == SQL_NULL_DATA) {
-        Py_RETURN_NONE;
-    } else {
-        return PyTime_FromTime((int)time.hour, (int)time.minute, (int)time.second, 0);
-    }
+    return convert_cell(column, &value);
 }
 
 
-PyObject* get_char(Cursor *self, SQLUSMALLINT column_number)
+/*
+    The values of the previous row are freed together
+*/
+PyObject* get_row(Cursor *self)
 {
-    PRINT_DEBUG_MESSAGE(__FUNCTION__);
-
-    SQLLEN len_or_indicator;
-    size_t allocated = 4096;  // bytes
-    size_t readed = 0;
-    size_t index = 0;
-    size_t null_terminated = sizeof(SQLCHAR);
-    long long needed;
+    arena_reset(&self->memory);
 
-    SQLCHAR *buffer = (SQLCHAR *)malloc(allocated + null_terminated);
-    if (buffer == NULL) {
-        PyErr_NoMemory();
+    PyObject *row = PyDict_New();
+    if (row == NULL) {
+        PyErr_Format(PyExc_Exception, "(%s) Failed to create Dict", __FUNCTION__);
         return NULL;
     }
 
-    size_t can_read = allocated - readed;
+    for (SQLSMALLINT i = 0; i < self->r_info.column_count; i++) {
+        PyObject *value = get_data(self, (SQLUSMALLINT)i);
+        if (value == NULL) {
+            Py_DECREF(row);
+            return NULL;
+        }
 
-    self->retcode = SQLGetData(
-        self->handle,
-        (SQLUSMALLINT)(column_number + 1),
-        SQL_C_CHAR,
-        &buffer[index],
-        (SQLLEN)can_read,
-        &len_or_indicator
-    );
+        if (PyDict_SetItem(row, self->r_info.columns[i].key, value) == -1) {
+            Py_DECREF(value);
+            Py_DECREF(row);
+            PyErr_Format(PyExc_Exception, "(%s) Failed to set KeyValue", __FUNCTION__);
+            return NULL;
+        }
+        Py_DECREF(value);
+    }
+
+    return row;
+}
 
-    readed += can_read - null_terminated;
 
-    if (!SQL_SUCCEEDED(self->retcode) && self->retcode != SQL_SUCCESS_WITH_INFO && \
-        self->retcode != SQL_STILL_EXECUTING && self->retcode != SQL_NO_DATA) {
-        PyErr_SetString(PyExc_Exception, "(get_char::SQLGetData) A failed retcode at getting a data");
-        free(buffer);
+row_batch* create_batch(size_t limit)
+{
+    row_batch *batch = (row_batch *)malloc(sizeof(row_batch));
+    if (batch == NULL) {
         return NULL;
     }
 
-    if (self->retcode == SQL_SUCCESS && len_or_indicator == SQL_NULL_DATA) {
-        free(buffer);
-        Py_RETURN_NONE;
+    batch->cells = NULL;
+    batch->rows = 0;
+    batch->capacity = 0;
+    batch->limit = limit;
+    arena_init(&batch->values);
+    batch->failed_fn = NULL;
+    batch->error_message = NULL;
+    batch->is_end = 0;
+    batch->no_memory = 0;
+    return batch;
+}
+
+
+static int fail_batch(Cursor *self, row_batch *batch, int code, const char *failed_fn)
+{
+    if (code == READ_NO_MEMORY) {
+        batch->no_memory = 1;
+    } else {
+        // the diagnostic records must be taken before the next call on the handle
+        batch->failed_fn = failed_fn;
+        batch->error_message = get_error_message(failed_fn, self->handle, self->handle_type);
     }
+    return -1;
+}
 
-    if (self->retcode == SQL_SUCCESS && len_or_indicator + null_terminated < allocated) {
-        buffer = (SQLCHAR *)realloc(buffer, len_or_indicator + null_terminated);
-        if (buffer == NULL) {
-            PyErr_NoMemory();
-            return NULL;
-        }
+
+/*
+    Fetches up to batch->limit rows into native cells.
+    It's called by a worker without the GIL, the errors are kept in the batch until convert_rows
+*/
+int fetch_rows(Cursor *self, row_batch *batch)
+{
+    const char *failed_fn = NULL;
+    SQLSMALLINT column_count;
+
+    int code = describe_columns(self, &failed_fn);
+    if (code) {
+        return fail_batch(self, batch, code, failed_fn);
     }
 
-    index += can_read / sizeof(SQLCHAR) - 1;  // a shift of -1, because a string ends with '\0'
+    column_count = self->r_info.column_count;
+    if (!column_count) {
+        batch->is_end = 1;  // there isn't a result set, e.g. after INSERT
+        return 0;
+    }
 
-    while (self->retcode == SQL_SUCCESS_WITH_INFO) {
-        needed = len_or_indicator - readed;
-        if (needed < 0) {
+    while (!batch->limit || batch->rows < batch->limit) {
+        self->retcode = SQLFetch(self->handle);
+        if (self->retcode == SQL_NO_DATA) {
+            batch->is_end = 1;
             break;
         }
 
-        allocated += needed;
-        can_read = allocated - readed;
-
-        buffer = (SQLCHAR *)realloc(buffer, allocated);
-        if (buffer == NULL) {
-            PyErr_NoMemory();
-            return NULL;
+        if (!SQL_SUCCEEDED(self->retcode)) {
+            return fail_batch(self, batch, READ_ERROR, "fetch_rows::SQLFetch");
         }
 
-        self->retcode = SQLGetData(
-            self->handle,
-            (SQLUSMALLINT)(column_number + 1),
-            SQL_C_CHAR,
-            &buffer[index],
-            (SQLLEN)can_read,
-            &len_or_indicator
-        );
-
-        readed += can_read - null_terminated;
-        if (self->retcode == SQL_SUCCESS) {
-            break;
+        if (batch->rows == batch->capacity) {
+            size_t capacity = batch->capacity ? batch->capacity * 2 : BATCH_INITIAL_ROWS;
+            if (batch->limit && capacity > batch->limit) {
+                capacity = batch->limit;
+            }
+
+            cell *cells = (cell *)realloc(batch->cells, sizeof(cell) * capacity * column_count);
+            if (cells == NULL) {
+                return fail_batch(self, batch, READ_NO_MEMORY, NULL);
+            }
+            batch->cells = cells;
+            batch->capacity = capacity;
         }
 
-        index += can_read / sizeof(SQLCHAR) - 1;
-        if (self->retcode == SQL_NO_DATA) {
-            break;
+        cell *row = &batch->cells[batch->rows * column_count];
+        for (SQLSMALLINT i = 0; i < column_count; i++) {
+            code = read_cell(self, (SQLUSMALLINT)i, &row[i], &batch->values, &failed_fn);
+            if (code) {
+                return fail_batch(self, batch, code, failed_fn);
+            }
         }
+        batch->rows++;
     }
 
-    PyObject *value = Py_BuildValue("s", buffer);
-    free(buffer);
-
-    if (value == NULL) {
-        PyErr_SetString(PyExc_Exception, "(get_char::Py_BuildValue) An exception at building a value");
-        return NULL;
-    }
-    
-    return value;
+    return 0;
 }
 
 
-PyObject* get_wchar(Cursor *self, SQLUSMALLINT column_number)
+PyObject* convert_rows(Cursor *self, row_batch *batch)
 {
     PRINT_DEBUG_MESSAGE(__FUNCTION__);
 
-    SQLLEN len_or_indicator;
-    size_t allocated = 4096;  // bytes
-    size_t readed = 0;
-    size_t index = 0;
-    size_t null_terminated = sizeof(SQLWCHAR);
-    long long needed;
+    SQLSMALLINT column_count = self->r_info.column_count;
 
-    SQLWCHAR *buffer = (SQLWCHAR *)malloc(allocated + null_terminated);
-    if (buffer == NULL) {
-        PyErr_NoMemory();
-        return NULL;
+    if (batch->no_memory) {
+        return PyErr_NoMemory();
     }
 
-    size_t can_read = allocated - readed;
-
-    self->retcode = SQLGetData(
-        self->handle,
-        (SQLUSMALLINT)(column_number + 1),
-        SQL_C_WCHAR,
-        &buffer[index],
-        (SQLLEN)can_read,
-        &len_or_indicator
-    );
-
-    readed += can_read - null_terminated;
-
-    if (!SQL_SUCCEEDED(self->retcode) && self->retcode != SQL_SUCCESS_WITH_INFO && \
-        self->retcode != SQL_STILL_EXECUTING && self->retcode != SQL_NO_DATA) {
-        PyErr_SetString(PyExc_Exception, "(get_wchar::SQLGetData) A failed retcode at getting a data");
-        free(buffer);
+    if (batch->failed_fn != NULL) {
+        if (batch->error_message != NULL) {
+            PyErr_Format(PyExc_Exception, "%s", batch->error_message);
+        } else {
+            PyErr_Format(PyExc_Exception, "(%s) An unknown error in the function: %s", __FUNCTION__, batch->failed_fn);
+        }
         return NULL;
     }
 
-    if (self->retcode == SQL_SUCCESS && len_or_indicator == SQL_NULL_DATA) {
-        free(buffer);
-        Py_RETURN_NONE;
+    if (create_column_keys(self) == -1) {
+        return NULL;
     }
 
-    if (self->retcode == SQL_SUCCESS && len_or_indicator + null_terminated < allocated) {
-        buffer = (SQLWCHAR *)realloc(buffer, len_or_indicator + null_terminated);
-        if (buffer == NULL) {
-            PyErr_NoMemory();
-            return NULL;
-        }
+    PyObject *results = PyList_New((Py_ssize_t)batch->rows);
+    if (results == NULL) {
+        PyErr_Format(PyExc_Exception, "(%s) Failed to create List", __FUNCTION__);
+        return NULL;
     }
 
-    index += can_read / sizeof(SQLWCHAR) - 1;  // a shift of -1, because a string ends with '\0'
-
-    while (self->retcode == SQL_SUCCESS_WITH_INFO) {
-        needed = len_or_indicator - readed;
-        if (needed < 0) {
-            break;
-        }
-
-        allocated += needed;
-        can_read = allocated - readed;
+    for (size_t r = 0; r < batch->rows; r++) {
+        cell *cells = &batch->cells[r * column_count];
 
-        buffer = (SQLWCHAR *)realloc(buffer, allocated);
-        if (buffer == NULL) {
-            PyErr_NoMemory();
+        PyObject *row = _PyDict_NewPresized(column_count);
+        if (row == NULL) {
+            Py_DECREF(results);
             return NULL;
         }
-
-        self->retcode = SQLGetData(
-            self->handle,
-            (SQLUSMALLINT)(column_number + 1),
-            SQL_C_WCHAR,
-            &buffer[index],
-            (SQLLEN)can_read,
-            &len_or_indicator
-        );
-
-        readed += can_read - null_terminated;
-        if (self->retcode == SQL_SUCCESS) {
-            break;
-        }
-
-        index += can_read / sizeof(SQLWCHAR) - 1;
-        if (self->retcode == SQL_NO_DATA) {
-            break;
+        PyList_SET_ITEM(results, (Py_ssize_t)r, row);
+
+        for (SQLSMALLINT i = 0; i < column_count; i++) {
+            PyObject *value = convert_cell(&self->r_info.columns[i], &cells[i]);
+            if (value == NULL) {
+                Py_DECREF(results);
+                return NULL;
+            }
+
+            if (PyDict_SetItem(row, self->r_info.columns[i].key, value) == -1) {
+                Py_DECREF(value);
+                Py_DECREF(results);
+                return NULL;
+            }
+            Py_DECREF(value);
         }
     }
 
+    return results;
+}
 
-    #ifdef _WIN32
-    PyObject *value = PyUnicode_FromWideChar((wchar_t *)buffer, -1);
-    free(buffer);
-    
-    #elif __linux__
-    wchar_t *w_buffer = uctowc(buffer);
-    free(buffer);
-    if (w_buffer == NULL) {
-        PyErr_NoMemory();
-        return NULL;
-    }
-    PyObject *value = PyUnicode_FromWideChar(w_buffer, -1);
-    free(w_buffer);
-    #endif
 
-    if (value == NULL) {
-        PyErr_SetString(PyExc_Exception, "(get_wchar::PyUnicode_FromWideChar) An exception at building a value");
-        return NULL;
+void free_batch(Cursor *self, row_batch *batch)
+{
+    if (batch == NULL) {
+        return;
     }
 
-    return value;
+    free(batch->cells);
+    arena_free(&batch->values);
+    free(batch->error_message);
+    free(batch);
 }
 
 
-PyObject* get_data(Cursor *self, SQLUSMALLINT column_number, SQLSMALLINT sql_type)
+int init_get_data(void)
 {
-    PRINT_DEBUG_MESSAGE(__FUNCTION__);
-    
     PyDateTime_IMPORT;
-
-    switch (sql_type) {
-        case SQL_INTEGER:
-        case SQL_SMALLINT:
-            return get_integer_smallint(self, column_number);
-        case SQL_BIGINT:
-            return get_bigint(self, column_number);
-        case SQL_NUMERIC:
-        case SQL_DECIMAL:
-            return get_numeric_decimal(self, column_number);
-        case SQL_BIT:
-            return get_bit(self, column_number);
-        case SQL_TINYINT:
-            return get_tinyint(self, column_number);
-        case SQL_FLOAT:
-        case SQL_REAL:
-        case SQL_DOUBLE:
-            return get_float_real_double(self, column_number);
-        case SQL_TYPE_TIMESTAMP:
-            return get_datetime(self, column_number);
-        case SQL_TYPE_DATE:
-            return get_date(self, column_number);
-        case SQL_TYPE_TIME:
-        case -154:  // SQL Server 2008+
-            return get_time(self, column_number);
-        case SQL_CHAR:
-        case SQL_VARCHAR:
-        case SQL_LONGVARCHAR:
-            return get_wchar(self, column_number);  // TODO to convert UTF-16 (surrogate pairs and e.t.c)?
-        case -155:  // datetimeoffset
-            return get_char(self, column_number);
-        case SQL_WCHAR:
-        case SQL_WVARCHAR:
-        case SQL_WLONGVARCHAR:
-            return get_wchar(self, column_number);
-        default:
-            PRINT_DEBUG_MESSAGE("return default!");
-            return get_wchar(self, column_number);
-    }
+    return PyDateTimeAPI == NULL ? -1 : 0;
 }
@@ -7,25 +7,37 @@
 #include <datetime.h>
 
 
-#ifdef __linux__
-extern wchar_t* uctowc(char16_t *uc);
-#endif
-
-PyObject* get_integer_smallint(Cursor *self, SQLUSMALLINT ColumnNumber);
-PyObject* get_bigint(Cursor *self, SQLUSMALLINT ColumnNumber);
-PyObject* get_numeric_decimal(Cursor *self, SQLUSMALLINT ColumnNumber);
-PyObject* get_bit(Cursor *self, SQLUSMALLINT ColumnNumber);
-PyObject* get_tinyint(Cursor *self, SQLUSMALLINT ColumnNumber);
-PyObject* get_float(Cursor *self, SQLUSMALLINT ColumnNumber);
-PyObject* get_float_real_double(Cursor *self, SQLUSMALLINT ColumnNumber);
-PyObject* get_datetime(Cursor *self, SQLUSMALLINT ColumnNumber);
-PyObject* get_date(Cursor *self, SQLUSMALLINT ColumnNumber);
-PyObject* get_time(Cursor *self, SQLUSMALLINT ColumnNumber);
-PyObject* get_char(Cursor *self, SQLUSMALLINT ColumnNumber);
-PyObject* get_wchar(Cursor *self, SQLUSMALLINT ColumnNumber);
-PyObject* get_data(Cursor *self, SQLUSMALLINT column_number, SQLSMALLINT sql_type);
+#define READ_ERROR -1
+#define READ_NO_MEMORY -2
+
+#define VAR_DATA_INITIAL_SIZE 4096  // bytes
+#define VAR_DATA_MAX_PRESIZE 65536  // bytes, the longer binary columns are read from VAR_DATA_INITIAL_SIZE
+#define BATCH_INITIAL_ROWS 64
+
+
+// the functions without PyObject in the signature don't need the GIL
+int describe_columns(Cursor *self, const char **failed_fn);
+int create_column_keys(Cursor *self);
+void free_columns(Cursor *self);
+int read_cell(Cursor *self, SQLUSMALLINT column_number, cell *value, arena *memory, const char **failed_fn);
+PyObject* convert_cell(column_info *column, cell *value);
+int raise_read_error(Cursor *self, int code, const char *failed_fn);
+PyObject* get_data(Cursor *self, SQLUSMALLINT column_number);
+PyObject* get_row(Cursor *self);
+row_batch* create_batch(size_t limit);
+int fetch_rows(Cursor *self, row_batch *batch);
+PyObject* convert_rows(Cursor *self, row_batch *batch);
+void free_batch(Cursor *self, row_batch *batch);
+int init_get_data(void);
 
 extern int check_error(PyObject *self, const char *fn_name);
+extern char* get_error_message(const char *fn_name, SQLHANDLE handle, SQLSMALLINT handle_type);
+extern void arena_init(arena *memory);
+extern void* arena_alloc(arena *memory, size_t size);
+extern void* arena_grow(arena *memory, void *last, size_t used, size_t size);
+extern void arena_trim(arena *memory, void *last, size_t size);
+extern void arena_reset(arena *memory);
+extern void arena_free(arena *memory);
 
 
 #endif
@@ -6,8 +6,26 @@
 #include <Python.h>
 
 
+// the critical sections are added in Python 3.13, with the GIL they don't lock
+#ifndef Py_BEGIN_CRITICAL_SECTION
+#define Py_BEGIN_CRITICAL_SECTION(op) {
+#define Py_END_CRITICAL_SECTION() }
+#define Py_BEGIN_CRITICAL_SECTION2(a, b) {
+#define Py_END_CRITICAL_SECTION2() }
+#endif
+
+// the flag is added in Python 3.10, before it tp_new is reset after the creation of a type
+#ifdef Py_TPFLAGS_DISALLOW_INSTANTIATION
+#define TPFLAGS_NO_INSTANTIATION Py_TPFLAGS_DISALLOW_INSTANTIATION
+#else
+#define TPFLAGS_NO_INSTANTIATION 0
+#endif
+
+
 #ifdef __linux__
 #include "linux.h"
+#include "thread_pool.h"
+#include "poller.h"
 typedef short ESTATUS;
 #endif
 
@@ -25,6 +43,17 @@ typedef DWORD ESTATUS;
 #include <string.h>
 
 #include <locale.h>
+#include <math.h>
+
+#include "timer_wheel.h"
+
+
+// the MARS attribute of the SQL Server drivers without msodbcsql.h
+#ifndef SQL_COPT_SS_MARS_ENABLED
+#define SQL_COPT_SS_MARS_ENABLED 1224
+#define SQL_MARS_ENABLED_NO 0L
+#define SQL_MARS_ENABLED_YES 1L
+#endif
 
 
 #define _DEBUG 0
@@ -1,65 +1,115 @@
 #include "input_data.h"
 
 
-int bind_null(Cursor *self, Py_ssize_t parameter_number, parameter *parameter_data)
+// static declarations
+static Py_ssize_t get_utf16_length(PyObject *param);
+static void copy_utf16(PyObject *param, SQLWCHAR *buffer);
+// end static declarations
+
+
+/*
+    Binds the buffer of the parameter. The same binding of the last execution of the handle is kept,
+    the new value is already written into its buffer
+*/
+static int bind_buffer(
+    Cursor *self, Py_ssize_t parameter_number, parameter *parameter_data, SQLSMALLINT c_type, SQLSMALLINT sql_type,
+    SQLULEN column_size, SQLSMALLINT decimal_digits, SQLPOINTER buffer, SQLLEN buffer_length, const char *fn_name
+)
 {
-    PRINT_DEBUG_MESSAGE(__FUNCTION__);
+    if (
+        parameter_data->c_type == c_type
+        && parameter_data->sql_type == sql_type
+        && parameter_data->column_size == column_size
+        && parameter_data->decimal_digits == decimal_digits
+        && parameter_data->buffer == buffer
+        && parameter_data->buffer_length == buffer_length
+    ) {
+        return 0;
+    }
 
-    parameter_data->indicator = SQL_NULL_DATA;
+    parameter_data->c_type = 0;
 
     self->retcode = SQLBindParameter(
         self->handle,
         (SQLUSMALLINT)(parameter_number + 1),
         SQL_PARAM_INPUT,
-        SQL_C_CHAR,
-        SQL_VARCHAR,
-        1,
-        0,
-        NULL,
-        0,
+        c_type,
+        sql_type,
+        column_size,
+        decimal_digits,
+        buffer,
+        buffer_length,
         &parameter_data->indicator
     );
-    CHECK_ERROR("bind_null::SQLBindParameter");
+    CHECK_ERROR(fn_name);
+
+    parameter_data->c_type = c_type;
+    parameter_data->sql_type = sql_type;
+    parameter_data->column_size = column_size;
+    parameter_data->decimal_digits = decimal_digits;
+    parameter_data->buffer = buffer;
+    parameter_data->buffer_length = buffer_length;
 
     return 0;
 }
 
 
+/*
+    The string shares the memory with the other values, so it's freed before them
+*/
+static void free_string(parameter *parameter_data)
+{
+    if (parameter_data->alloc_str == 1) {
+        PyMem_Free(parameter_data->value.v_str);
+        parameter_data->value.v_str = NULL;
+        parameter_data->str_capacity = 0;
+        parameter_data->alloc_str = 0;
+    }
+}
+
+
+static void release_view(parameter *parameter_data)
+{
+    if (parameter_data->is_viewed) {
+        PyBuffer_Release(&parameter_data->view);
+        parameter_data->is_viewed = 0;
+    }
+}
+
+
+int bind_null(Cursor *self, Py_ssize_t parameter_number, parameter *parameter_data)
+{
+    PRINT_DEBUG_MESSAGE(__FUNCTION__);
+
+    parameter_data->indicator = SQL_NULL_DATA;
+
+    return bind_buffer(
+        self, parameter_number, parameter_data, SQL_C_CHAR, SQL_VARCHAR, 1, 0, NULL, 0, "bind_null::SQLBindParameter"
+    );
+}
+
+
 int bind_integer(Cursor *self, Py_ssize_t parameter_number, PyObject *param, parameter *parameter_data)
 {
     PRINT_DEBUG_MESSAGE(__FUNCTION__);
 
     long long value = PyLong_AsLongLong(param);
-    SQLSMALLINT c_type;
-    SQLSMALLINT sql_type;
 
     if (value < -2147483647 || value > 2147483647) {
         PRINT_DEBUG_MESSAGE("bind_integer::BIGINT");
-        c_type = SQL_C_SBIGINT;
-        sql_type = SQL_BIGINT;
         parameter_data->value.v_int64 = (INT64)value;
-    } else {
-        PRINT_DEBUG_MESSAGE("bind_integer::LONG");
-        c_type = SQL_C_LONG;
-        sql_type = SQL_INTEGER;
-        parameter_data->value.v_int = (int)value;
+        return bind_buffer(
+            self, parameter_number, parameter_data, SQL_C_SBIGINT, SQL_BIGINT, 0, 0,
+            &parameter_data->value.v_int64, 0, "bind_integer:SQLBindParameter"
+        );
     }
 
-    self->retcode = SQLBindParameter(
-        self->handle,
-        (SQLUSMALLINT)(parameter_number + 1),
-        SQL_PARAM_INPUT,
-        c_type,
-        sql_type,
-        0,
-        0,
-        sql_type == SQL_BIGINT ? (SQLPOINTER)(&parameter_data->value.v_int64) : (SQLPOINTER)(&parameter_data->value.v_int),
-        0,
-        &parameter_data->indicator
+    PRINT_DEBUG_MESSAGE("bind_integer::LONG");
+    parameter_data->value.v_int = (int)value;
+    return bind_buffer(
+        self, parameter_number, parameter_data, SQL_C_LONG, SQL_INTEGER, 0, 0,
+        &parameter_data->value.v_int, 0, "bind_integer:SQLBindParameter"
     );
-    CHECK_ERROR("bind_integer:SQLBindParameter");
-
-    return 0;
 }
 
 
@@ -69,21 +119,10 @@ int bind_bool(Cursor *self, Py_ssize_t parameter_number, PyObject *param, parame
 
     parameter_data->value.v_bool = (unsigned char)(param == Py_True ? 1 : 0);
 
-    self->retcode = SQLBindParameter(
-        self->handle,
-        (SQLUSMALLINT)(parameter_number + 1),
-        SQL_PARAM_INPUT,
-        SQL_C_BIT,
-        SQL_BIT,
-        0,
-        0,
-        &parameter_data->value.v_bool,
-        0,
-        &parameter_data->indicator
+    return bind_buffer(
+        self, parameter_number, parameter_data, SQL_C_BIT, SQL_BIT, 0, 0,
+        &parameter_data->value.v_bool, 0, "bind_bool::SQLBindParameter"
     );
-    CHECK_ERROR("bind_bool::SQLBindParameter");
-
-    return 0;
 }
 
 
@@ -93,74 +132,162 @@ int bind_float(Cursor *self, Py_ssize_t parameter_number, PyObject *param, param
 
     parameter_data->value.v_float = PyFloat_AsDouble(param);
 
-    self->retcode = SQLBindParameter(
-        self->handle,
-        (SQLUSMALLINT)(parameter_number + 1),
-        SQL_PARAM_INPUT,
-        SQL_C_DOUBLE,
-        SQL_DOUBLE,
-        0,
-        0,
-        &parameter_data->value.v_float,
-        0,
-        &parameter_data->indicator
+    return bind_buffer(
+        self, parameter_number, parameter_data, SQL_C_DOUBLE, SQL_DOUBLE, 0, 0,
+        &parameter_data->value.v_float, 0, "bind_float::SQLBindParameter"
     );
-    CHECK_ERROR("bind_float::SQLBindParameter");
+}
 
-    return 0;
+
+/*
+    The capacity of an allocated buffer is a power of two, so the strings of close lengths share the binding
+*/
+static SQLLEN string_capacity(SQLLEN size)
+{
+    SQLLEN capacity = 2 * SHORT_STRING_LENGTH * (SQLLEN)sizeof(SQLWCHAR);
+    while (capacity < size) {
+        capacity *= 2;
+    }
+    return capacity;
 }
 
 
+/*
+    The parameter is bound by the capacity of its buffer, the length of the string is given by the indicator.
+    It's rebound only if the buffer is reallocated or the type of the string is changed
+*/
 int bind_string(Cursor *self, Py_ssize_t parameter_number, PyObject *param, parameter *parameter_data)
 {
     PRINT_DEBUG_MESSAGE(__FUNCTION__);
 
-    Py_ssize_t string_length = PyUnicode_GET_LENGTH(param);
+    Py_ssize_t string_length = get_utf16_length(param);
+    SQLLEN size = (SQLLEN)(string_length * sizeof(SQLWCHAR));
     SQLSMALLINT sql_type = string_length > 2000 ? SQL_WLONGVARCHAR : SQL_WVARCHAR;
 
-    wchar_t *w_value = PyUnicode_AsWideCharString(param, &string_length);
-    if (w_value == NULL) {
-        PyErr_NoMemory();
-        return -1;
+    SQLWCHAR *buffer = NULL;
+    SQLLEN capacity = 0;
+
+    // the buffer of the previous string is reused if the string fits, a short one is kept in the parameter
+    if (parameter_data->alloc_str == 0 && size <= (SQLLEN)sizeof(parameter_data->value.v_short)) {
+        buffer = parameter_data->value.v_short;
+        capacity = (SQLLEN)sizeof(parameter_data->value.v_short);
+    } else if (parameter_data->alloc_str == 0 || parameter_data->str_capacity < size) {
+        free_string(parameter_data);
+        capacity = string_capacity(size);
+        parameter_data->value.v_str = PyMem_Malloc((size_t)capacity);
+        if (parameter_data->value.v_str == NULL) {
+            PyErr_NoMemory();
+            return -1;
+        }
+        parameter_data->str_capacity = capacity;
+        parameter_data->alloc_str = 1;
     }
 
-    #ifdef _WIN32
-    parameter_data->value.v_str = w_value;
+    if (buffer == NULL) {
+        buffer = (SQLWCHAR *)parameter_data->value.v_str;
+        capacity = parameter_data->str_capacity;
+    }
 
-    #elif __linux__
-    char16_t *value = wctouc(w_value);
-    if (value == NULL) {
+    copy_utf16(param, buffer);
+    parameter_data->indicator = size;
+
+    return bind_buffer(
+        self, parameter_number, parameter_data, SQL_C_WCHAR, sql_type, (SQLULEN)capacity / sizeof(SQLWCHAR), 0,
+        buffer, capacity, "bind_string::SQLBindParameter"
+    );
+}
+
+
+/*
+    The value is sent by SQLPutData at the execution, the parameter is its token
+*/
+static int bind_stream(Cursor *self, Py_ssize_t parameter_number, PyObject *param, parameter *parameter_data)
+{
+    PRINT_DEBUG_MESSAGE(__FUNCTION__);
+
+    parameter_stream *stream = PyMem_Calloc(1, sizeof(parameter_stream));
+    if (stream == NULL) {
         PyErr_NoMemory();
         return -1;
     }
-    parameter_data->value.v_str = value;
-    #endif
+    parameter_data->stream = stream;
+    self->p_info.stream_count++;
 
-    parameter_data->alloc_str = 1;
-    parameter_data->indicator = string_length * 2;  // * 2 because it's wchar_t
+    if (open_stream(param, stream) == -1) {
+        return -1;
+    }
 
-    self->retcode = SQLBindParameter(
-        self->handle,
-        (SQLUSMALLINT)(parameter_number + 1),
-        SQL_PARAM_INPUT,
-        SQL_C_WCHAR,
-        sql_type,
-        parameter_data->indicator,
-        0,
-        parameter_data->value.v_str,
-        parameter_data->indicator,
-        &parameter_data->indicator
-    );
-    CHECK_ERROR("bind_string::SQLBindParameter");
+    // the strings of one execution share the buffer
+    if (stream->is_text && self->p_info.chunk == NULL) {
+        self->p_info.chunk = (SQLWCHAR *)arena_alloc(&self->memory, STREAM_CHUNK_SIZE);
+        if (self->p_info.chunk == NULL) {
+            PyErr_NoMemory();
+            return -1;
+        }
+    }
 
-    return 0;
+    parameter_data->indicator = SQL_DATA_AT_EXEC;
+
+    // the size 0 is the max type, e.g. nvarchar(max) and varbinary(max)
+    return bind_buffer(
+        self, parameter_number, parameter_data,
+        stream->is_text ? SQL_C_WCHAR : SQL_C_BINARY, stream->is_text ? SQL_WLONGVARCHAR : SQL_LONGVARBINARY, 0, 0,
+        parameter_data, 0, "bind_stream::SQLBindParameter"
+    );
 }
 
 
-int bind_datetime(Cursor *self, Py_ssize_t parameter_number, PyObject *param, parameter *parameter_data)
+/*
+    The driver reads the bytes from the memory of the object at the execution, the larger ones are streamed
+*/
+static int bind_binary(Cursor *self, Py_ssize_t parameter_number, PyObject *param, parameter *parameter_data)
 {
     PRINT_DEBUG_MESSAGE(__FUNCTION__);
 
+    release_view(parameter_data);
+
+    if (PyObject_GetBuffer(param, &parameter_data->view, PyBUF_SIMPLE) == -1) {
+        return -1;
+    }
+
+    if (parameter_data->view.len > STREAM_BINARY_SIZE) {
+        PyBuffer_Release(&parameter_data->view);
+        return bind_stream(self, parameter_number, param, parameter_data);
+    }
+    parameter_data->is_viewed = 1;
+    self->p_info.view_count++;
+
+    SQLLEN size = (SQLLEN)parameter_data->view.len;
+    SQLSMALLINT sql_type = size > 8000 ? SQL_LONGVARBINARY : SQL_VARBINARY;
+    parameter_data->indicator = size;
+
+    // the empty value is bound with the size 1, the size 0 is the max type
+    return bind_buffer(
+        self, parameter_number, parameter_data, SQL_C_BINARY, sql_type, size ? (SQLULEN)size : 1, 0,
+        parameter_data->view.buf, size, "bind_binary::SQLBindParameter"
+    );
+}
+
+
+/*
+    The bound bytes are released after the execution, e.g. a bytearray can be resized again
+*/
+void release_views(parameters_info *p_info)
+{
+    if (!p_info->view_count) {
+        return;
+    }
+
+    for (Py_ssize_t i = 0; i < p_info->params_length; i++) {
+        release_view(&p_info->parameters[i]);
+    }
+
+    p_info->view_count = 0;
+}
+
+
+static SQL_TIMESTAMP_STRUCT get_timestamp(PyObject *param)
+{
     SQL_TIMESTAMP_STRUCT datetime;
     datetime.year = (SQLSMALLINT)PyDateTime_GET_YEAR(param);
     datetime.month = (SQLUSMALLINT)PyDateTime_GET_MONTH(param);
@@ -168,34 +295,45 @@ int bind_datetime(Cursor *self, Py_ssize_t parameter_number, PyObject *param, pa
     datetime.hour = (SQLUSMALLINT)PyDateTime_DATE_GET_HOUR(param);
     datetime.minute = (SQLUSMALLINT)PyDateTime_DATE_GET_MINUTE(param);
     datetime.second = (SQLUSMALLINT)PyDateTime_DATE_GET_SECOND(param);
-    int microseconds = (SQLUINTEGER)PyDateTime_DATE_GET_MICROSECOND(param);
+    datetime.fraction = (SQLUINTEGER)(PyDateTime_DATE_GET_MICROSECOND(param) * 1000);
+    return datetime;
+}
+
+
+static SQL_DATE_STRUCT get_date(PyObject *param)
+{
+    SQL_DATE_STRUCT date;
+    date.year = (SQLSMALLINT)PyDateTime_GET_YEAR(param);
+    date.month = (SQLUSMALLINT)PyDateTime_GET_MONTH(param);
+    date.day = (SQLUSMALLINT)PyDateTime_GET_DAY(param);
+    return date;
+}
+
+
+static SQL_TIME_STRUCT get_time(PyObject *param)
+{
+    SQL_TIME_STRUCT time;
+    time.hour = (SQLUSMALLINT)PyDateTime_TIME_GET_HOUR(param);
+    time.minute = (SQLUSMALLINT)PyDateTime_TIME_GET_MINUTE(param);
+    time.second = (SQLUSMALLINT)PyDateTime_TIME_GET_SECOND(param);
+    return time;
+}
 
-    int decimal_digits;
-    if (microseconds) {
-        decimal_digits = 6;
-        datetime.fraction = (SQLUINTEGER)(microseconds * 1000);
-    } else {
-        decimal_digits = 0;
-        datetime.fraction = 0;
-    }
+
+int bind_datetime(Cursor *self, Py_ssize_t parameter_number, PyObject *param, parameter *parameter_data)
+{
+    PRINT_DEBUG_MESSAGE(__FUNCTION__);
+
+    SQL_TIMESTAMP_STRUCT datetime = get_timestamp(param);
+    int decimal_digits = datetime.fraction ? 6 : 0;
 
     parameter_data->value.v_datetime = datetime;
 
-    self->retcode = SQLBindParameter(
-        self->handle,
-        (SQLUSMALLINT)(parameter_number + 1),
-        SQL_PARAM_INPUT,
-        SQL_C_TYPE_TIMESTAMP,
-        SQL_TYPE_TIMESTAMP,
-        sizeof(SQL_TIMESTAMP_STRUCT),
-        decimal_digits,
-        &parameter_data->value.v_datetime,
-        0,
-        &parameter_data->indicator
+    return bind_buffer(
+        self, parameter_number, parameter_data, SQL_C_TYPE_TIMESTAMP, SQL_TYPE_TIMESTAMP,
+        sizeof(SQL_TIMESTAMP_STRUCT), decimal_digits, &parameter_data->value.v_datetime, 0,
+        "bind_datetime::SQLBindParameter"
     );
-    CHECK_ERROR("bind_datetime::SQLBindParameter");
-
-    return 0;
 }
 
 
@@ -203,27 +341,12 @@ int bind_date(Cursor *self, Py_ssize_t parameter_number, PyObject *param, parame
 {
     PRINT_DEBUG_MESSAGE(__FUNCTION__);
 
-    SQL_DATE_STRUCT date;
-    date.year = (SQLSMALLINT)PyDateTime_GET_YEAR(param);
-    date.month = (SQLUSMALLINT)PyDateTime_GET_MONTH(param);
-    date.day = (SQLUSMALLINT)PyDateTime_GET_DAY(param);
-    parameter_data->value.v_date = date;
+    parameter_data->value.v_date = get_date(param);
 
-    self->retcode = SQLBindParameter(
-        self->handle,
-        (SQLUSMALLINT)(parameter_number + 1),
-        SQL_PARAM_INPUT,
-        SQL_C_TYPE_DATE,
-        SQL_TYPE_DATE,
-        sizeof(SQL_DATE_STRUCT),
-        0,
-        &parameter_data->value.v_date,
-        0,
-        &parameter_data->indicator
+    return bind_buffer(
+        self, parameter_number, parameter_data, SQL_C_TYPE_DATE, SQL_TYPE_DATE,
+        sizeof(SQL_DATE_STRUCT), 0, &parameter_data->value.v_date, 0, "bind_date::SQLBindParameter"
     );
-    CHECK_ERROR("bind_date::SQLBindParameter");
-
-    return 0;
 }
 
 
@@ -231,27 +354,12 @@ int bind_time(Cursor *self, Py_ssize_t parameter_number, PyObject *param, parame
 {
     PRINT_DEBUG_MESSAGE(__FUNCTION__);
 
-    SQL_TIME_STRUCT time;
-    time.hour = (SQLUSMALLINT)PyDateTime_TIME_GET_HOUR(param);
-    time.minute = (SQLUSMALLINT)PyDateTime_TIME_GET_MINUTE(param);
-    time.second = (SQLUSMALLINT)PyDateTime_TIME_GET_SECOND(param);
-    parameter_data->value.v_time = time;
+    parameter_data->value.v_time = get_time(param);
 
-    self->retcode = SQLBindParameter(
-        self->handle,
-        (SQLUSMALLINT)(parameter_number + 1),
-        SQL_PARAM_INPUT,
-        SQL_C_TYPE_TIME,
-        SQL_TYPE_TIME,
-        sizeof(SQL_TIME_STRUCT),
-        0,
-        &parameter_data->value.v_time,
-        0,
-        &parameter_data->indicator
+    return bind_buffer(
+        self, parameter_number, parameter_data, SQL_C_TYPE_TIME, SQL_TYPE_TIME,
+        sizeof(SQL_TIME_STRUCT), 0, &parameter_data->value.v_time, 0, "bind_time::SQLBindParameter"
     );
-    CHECK_ERROR("bind_time::SQLBindParameter");
-
-    return 0;
 }
 
 
@@ -259,7 +367,9 @@ int bind_parameter(Cursor *self, Py_ssize_t parameter_number, PyObject *param, p
 {
     PRINT_DEBUG_MESSAGE(__FUNCTION__);
 
-    PyDateTime_IMPORT;
+    if (!PyUnicode_Check(param)) {
+        free_string(parameter_data);  // the other values are written over the pointer
+    }
 
     if (param == Py_None) {
         return bind_null(self, parameter_number, parameter_data);
@@ -279,6 +389,9 @@ int bind_parameter(Cursor *self, Py_ssize_t parameter_number, PyObject *param, p
     }
 
     if (PyUnicode_Check(param)) {
+        if (is_stream_source(param)) {
+            return bind_stream(self, parameter_number, param, parameter_data);
+        }
         return bind_string(self, parameter_number, param, parameter_data);
     }
 
@@ -294,6 +407,794 @@ int bind_parameter(Cursor *self, Py_ssize_t parameter_number, PyObject *param, p
         return bind_time(self, parameter_number, param, parameter_data);
     }
 
-    // return bind_string(self, parameter_number, param, parameter_data);
+    if (PyObject_CheckBuffer(param)) {
+        return bind_binary(self, parameter_number, param, parameter_data);
+    }
+
+    // the files and the iterators
+    if (is_stream_source(param)) {
+        return bind_stream(self, parameter_number, param, parameter_data);
+    }
+
     return -1;
 }
+
+
+// the kinds of the values in a column of a batch, the column is bound with one C type
+#define ARRAY_NULL 0
+#define ARRAY_BOOL 1
+#define ARRAY_INTEGER 2
+#define ARRAY_FLOAT 3
+#define ARRAY_STRING 4
+#define ARRAY_DATETIME 5
+#define ARRAY_DATE 6
+#define ARRAY_TIME 7
+#define ARRAY_BINARY 8
+#define ARRAY_UNSUPPORTED 9
+
+
+static int get_value_kind(PyObject *param)
+{
+    if (param == Py_None) {
+        return ARRAY_NULL;
+    }
+
+    // bool is the subclass of integer and datetime is the subclass of date
+    if (PyBool_Check(param)) {
+        return ARRAY_BOOL;
+    }
+
+    if (PyLong_Check(param)) {
+        return ARRAY_INTEGER;
+    }
+
+    if (PyFloat_Check(param)) {
+        return ARRAY_FLOAT;
+    }
+
+    if (PyUnicode_Check(param)) {
+        return ARRAY_STRING;
+    }
+
+    if (PyDateTime_Check(param)) {
+        return ARRAY_DATETIME;
+    }
+
+    if (PyDate_Check(param)) {
+        return ARRAY_DATE;
+    }
+
+    if (PyTime_Check(param)) {
+        return ARRAY_TIME;
+    }
+
+    // the values are copied into the array, so only the bytes and the bytearrays are taken
+    if (PyBytes_Check(param) || PyByteArray_Check(param)) {
+        return ARRAY_BINARY;
+    }
+
+    return ARRAY_UNSUPPORTED;
+}
+
+
+/*
+    The length in UTF-16 code units, the characters outside of BMP take the surrogate pairs
+*/
+static Py_ssize_t get_utf16_length(PyObject *param)
+{
+    Py_ssize_t length = PyUnicode_GET_LENGTH(param);
+
+    if (PyUnicode_KIND(param) == PyUnicode_4BYTE_KIND) {
+        const Py_UCS4 *data = PyUnicode_4BYTE_DATA(param);
+        for (Py_ssize_t i = 0, string_length = length; i < string_length; i++) {
+            if (data[i] > 0xFFFF) {
+                length++;
+            }
+        }
+    }
+
+    return length;
+}
+
+
+/*
+    Writes the string into the buffer in one pass from the compact storage of the string,
+    without the temporary wchar_t copy. UCS-2 is already UTF-16
+*/
+static void copy_utf16(PyObject *param, SQLWCHAR *buffer)
+{
+    Py_ssize_t string_length = PyUnicode_GET_LENGTH(param);
+
+    switch (PyUnicode_KIND(param)) {
+        case PyUnicode_1BYTE_KIND: {
+            const Py_UCS1 *data = PyUnicode_1BYTE_DATA(param);
+            for (Py_ssize_t i = 0; i < string_length; i++) {
+                buffer[i] = (SQLWCHAR)data[i];
+            }
+            break;
+        }
+        case PyUnicode_2BYTE_KIND:
+            memcpy(buffer, PyUnicode_2BYTE_DATA(param), string_length * sizeof(SQLWCHAR));
+            break;
+        default: {
+            const Py_UCS4 *data = PyUnicode_4BYTE_DATA(param);
+            for (Py_ssize_t i = 0; i < string_length; i++) {
+                Py_UCS4 ch = data[i];
+                if (ch > 0xFFFF) {
+                    ch -= 0x10000;
+                    *buffer++ = (SQLWCHAR)(0xD800 + (ch >> 10));
+                    *buffer++ = (SQLWCHAR)(0xDC00 + (ch & 0x3FF));
+                } else {
+                    *buffer++ = (SQLWCHAR)ch;
+                }
+            }
+            break;
+        }
+    }
+}
+
+
+/*
+    Chooses one C type for the values of the parameter in all rows of the batch,
+    the integers of a float column are converted to float
+*/
+static int describe_parameter_array(
+    Py_ssize_t parameter_number, PyObject **rows, Py_ssize_t row_count, parameter_array *array
+)
+{
+    int kind = ARRAY_NULL;
+    int is_bigint = 0;
+    int has_fraction = 0;
+    Py_ssize_t max_length = 1;
+
+    for (Py_ssize_t i = 0; i < row_count; i++) {
+        PyObject *param = PyTuple_GET_ITEM(rows[i], parameter_number);
+        int value_kind = get_value_kind(param);
+
+        if (value_kind == ARRAY_UNSUPPORTED) {
+            PyErr_Format(
+                PyExc_TypeError,
+                "(%s) The parameter type %lld in the query isn't supported for passing to SQL",
+                __FUNCTION__, (long long)parameter_number + 1
+            );
+            return -1;
+        }
+
+        if (value_kind == ARRAY_NULL) {
+            continue;
+        }
+
+        if ((kind == ARRAY_INTEGER && value_kind == ARRAY_FLOAT) || (kind == ARRAY_FLOAT && value_kind == ARRAY_INTEGER)) {
+            kind = ARRAY_FLOAT;
+        } else if (kind != ARRAY_NULL && kind != value_kind) {
+            PyErr_Format(
+                PyExc_TypeError,
+                "(%s) The parameter %lld has different types in the rows",
+                __FUNCTION__, (long long)parameter_number + 1
+            );
+            return -1;
+        } else {
+            kind = value_kind;
+        }
+
+        if (value_kind == ARRAY_INTEGER) {
+            long long value = PyLong_AsLongLong(param);
+            if (value == -1 && PyErr_Occurred()) {
+                return -1;
+            }
+            if (value < -2147483647 || value > 2147483647) {
+                is_bigint = 1;
+            }
+        } else if (value_kind == ARRAY_STRING) {
+            Py_ssize_t length = get_utf16_length(param);
+            if (length > max_length) {
+                max_length = length;
+            }
+        } else if (value_kind == ARRAY_BINARY) {
+            Py_ssize_t length = PyBytes_Check(param) ? PyBytes_GET_SIZE(param) : PyByteArray_GET_SIZE(param);
+            if (length > max_length) {
+                max_length = length;
+            }
+        } else if (value_kind == ARRAY_DATETIME && PyDateTime_DATE_GET_MICROSECOND(param)) {
+            has_fraction = 1;
+        }
+    }
+
+    array->column_size = 0;
+    array->decimal_digits = 0;
+
+    switch (kind) {
+        case ARRAY_NULL:
+            array->c_type = SQL_C_CHAR;
+            array->sql_type = SQL_VARCHAR;
+            array->column_size = 1;
+            array->width = 1;
+            break;
+        case ARRAY_BOOL:
+            array->c_type = SQL_C_BIT;
+            array->sql_type = SQL_BIT;
+            array->width = sizeof(unsigned char);
+            break;
+        case ARRAY_INTEGER:
+            array->c_type = is_bigint ? SQL_C_SBIGINT : SQL_C_LONG;
+            array->sql_type = is_bigint ? SQL_BIGINT : SQL_INTEGER;
+            array->width = is_bigint ? sizeof(INT64) : sizeof(int);
+            break;
+        case ARRAY_FLOAT:
+            array->c_type = SQL_C_DOUBLE;
+            array->sql_type = SQL_DOUBLE;
+            array->width = sizeof(double);
+            break;
+        case ARRAY_STRING:
+            array->c_type = SQL_C_WCHAR;
+            array->sql_type = max_length > 2000 ? SQL_WLONGVARCHAR : SQL_WVARCHAR;
+            array->column_size = max_length;
+            array->width = max_length * sizeof(SQLWCHAR);
+            break;
+        case ARRAY_DATETIME:
+            array->c_type = SQL_C_TYPE_TIMESTAMP;
+            array->sql_type = SQL_TYPE_TIMESTAMP;
+            array->column_size = sizeof(SQL_TIMESTAMP_STRUCT);
+            array->decimal_digits = has_fraction ? 6 : 0;
+            array->width = sizeof(SQL_TIMESTAMP_STRUCT);
+            break;
+        case ARRAY_DATE:
+            array->c_type = SQL_C_TYPE_DATE;
+            array->sql_type = SQL_TYPE_DATE;
+            array->column_size = sizeof(SQL_DATE_STRUCT);
+            array->width = sizeof(SQL_DATE_STRUCT);
+            break;
+        case ARRAY_TIME:
+            array->c_type = SQL_C_TYPE_TIME;
+            array->sql_type = SQL_TYPE_TIME;
+            array->column_size = sizeof(SQL_TIME_STRUCT);
+            array->width = sizeof(SQL_TIME_STRUCT);
+            break;
+        case ARRAY_BINARY:
+            array->c_type = SQL_C_BINARY;
+            array->sql_type = max_length > 8000 ? SQL_LONGVARBINARY : SQL_VARBINARY;
+            array->column_size = max_length;
+            array->width = max_length;
+            break;
+    }
+
+    return 0;
+}
+
+
+/*
+    Fills the buffers of the parameter with the values of all rows of the batch and binds them by column
+*/
+int bind_parameter_array(
+    Cursor *self, Py_ssize_t parameter_number, PyObject **rows, Py_ssize_t row_count, parameter_array *array
+)
+{
+    PRINT_DEBUG_MESSAGE(__FUNCTION__);
+
+    if (describe_parameter_array(parameter_number, rows, row_count, array) == -1) {
+        return -1;
+    }
+
+    array->values = PyMem_Malloc(array->width * row_count);
+    array->indicators = PyMem_Malloc(sizeof(SQLLEN) * row_count);
+    if (array->values == NULL || array->indicators == NULL) {
+        PyErr_NoMemory();
+        return -1;
+    }
+
+    for (Py_ssize_t i = 0; i < row_count; i++) {
+        PyObject *param = PyTuple_GET_ITEM(rows[i], parameter_number);
+        char *value = array->values + i * array->width;
+
+        if (param == Py_None) {
+            array->indicators[i] = SQL_NULL_DATA;
+            continue;
+        }
+        array->indicators[i] = 0;
+
+        switch (array->c_type) {
+            case SQL_C_BIT:
+                *(unsigned char *)value = (unsigned char)(param == Py_True ? 1 : 0);
+                break;
+            case SQL_C_LONG:
+                *(int *)value = (int)PyLong_AsLongLong(param);
+                break;
+            case SQL_C_SBIGINT:
+                *(INT64 *)value = (INT64)PyLong_AsLongLong(param);
+                break;
+            case SQL_C_DOUBLE:
+                *(double *)value = PyFloat_AsDouble(param);
+                if (*(double *)value == -1.0 && PyErr_Occurred()) {
+                    return -1;
+                }
+                break;
+            case SQL_C_WCHAR:
+                copy_utf16(param, (SQLWCHAR *)value);
+                array->indicators[i] = get_utf16_length(param) * sizeof(SQLWCHAR);
+                break;
+            case SQL_C_TYPE_TIMESTAMP:
+                *(SQL_TIMESTAMP_STRUCT *)value = get_timestamp(param);
+                break;
+            case SQL_C_TYPE_DATE:
+                *(SQL_DATE_STRUCT *)value = get_date(param);
+                break;
+            case SQL_C_TYPE_TIME:
+                *(SQL_TIME_STRUCT *)value = get_time(param);
+                break;
+            case SQL_C_BINARY:
+                if (PyBytes_Check(param)) {
+                    array->indicators[i] = PyBytes_GET_SIZE(param);
+                    memcpy(value, PyBytes_AS_STRING(param), (size_t)array->indicators[i]);
+                } else {
+                    array->indicators[i] = PyByteArray_GET_SIZE(param);
+                    memcpy(value, PyByteArray_AS_STRING(param), (size_t)array->indicators[i]);
+                }
+                break;
+        }
+    }
+
+    self->retcode = SQLBindParameter(
+        self->handle,
+        (SQLUSMALLINT)(parameter_number + 1),
+        SQL_PARAM_INPUT,
+        array->c_type,
+        array->sql_type,
+        array->column_size,
+        array->decimal_digits,
+        array->values,
+        array->width,
+        array->indicators
+    );
+    CHECK_ERROR("bind_parameter_array::SQLBindParameter");
+
+    return 0;
+}
+
+
+/*
+    Converts UTF-8 into the buffer or only counts UTF-16 code units without the buffer, -1 for invalid UTF-8
+*/
+static Py_ssize_t utf8_to_utf16(const unsigned char *data, Py_ssize_t size, SQLWCHAR *buffer)
+{
+    Py_ssize_t length = 0;
+
+    for (Py_ssize_t i = 0; i < size;) {
+        Py_UCS4 ch = data[i];
+        int extra;
+
+        if (ch < 0x80) {
+            extra = 0;
+        } else if ((ch & 0xE0) == 0xC0) {
+            ch &= 0x1F;
+            extra = 1;
+        } else if ((ch & 0xF0) == 0xE0) {
+            ch &= 0x0F;
+            extra = 2;
+        } else if ((ch & 0xF8) == 0xF0) {
+            ch &= 0x07;
+            extra = 3;
+        } else {
+            return -1;
+        }
+
+        if (size - i <= extra) {
+            return -1;
+        }
+
+        for (int k = 1; k <= extra; k++) {
+            if ((data[i + k] & 0xC0) != 0x80) {
+                return -1;
+            }
+            ch = (ch << 6) | (data[i + k] & 0x3F);
+        }
+        i += extra + 1;
+
+        if (ch > 0x10FFFF) {
+            return -1;
+        }
+
+        if (ch > 0xFFFF) {
+            if (buffer != NULL) {
+                buffer[length] = (SQLWCHAR)(0xD800 + ((ch - 0x10000) >> 10));
+                buffer[length + 1] = (SQLWCHAR)(0xDC00 + ((ch - 0x10000) & 0x3FF));
+            }
+            length += 2;
+        } else {
+            if (buffer != NULL) {
+                buffer[length] = (SQLWCHAR)ch;
+            }
+            length++;
+        }
+    }
+
+    return length;
+}
+
+
+/*
+    Converts the string of the row into the buffer or only counts its UTF-16 code units, -1 for an invalid string
+*/
+static Py_ssize_t convert_source_string(column_source *source, Py_ssize_t row, SQLWCHAR *buffer)
+{
+    const unsigned char *data;
+    Py_ssize_t size;
+
+    if (source->kind == SOURCE_UCS4) {
+        const Py_UCS4 *chars = (const Py_UCS4 *)((const char *)source->values.buf + row * source->width);
+        Py_ssize_t char_count = source->width / 4;
+        Py_ssize_t length = 0;
+
+        for (Py_ssize_t i = 0; i < char_count && chars[i]; i++) {
+            Py_UCS4 ch = chars[i];
+            if (ch > 0x10FFFF) {
+                return -1;
+            }
+
+            if (ch > 0xFFFF) {
+                if (buffer != NULL) {
+                    buffer[length] = (SQLWCHAR)(0xD800 + ((ch - 0x10000) >> 10));
+                    buffer[length + 1] = (SQLWCHAR)(0xDC00 + ((ch - 0x10000) & 0x3FF));
+                }
+                length += 2;
+            } else {
+                if (buffer != NULL) {
+                    buffer[length] = (SQLWCHAR)ch;
+                }
+                length++;
+            }
+        }
+
+        return length;
+    }
+
+    if (source->kind == SOURCE_UTF8) {
+        data = (const unsigned char *)source->values.buf + row * source->width;
+        size = (Py_ssize_t)strnlen((const char *)data, source->width);
+    } else {
+        long long start, end;
+        if (source->kind == SOURCE_OFFSETS32) {
+            start = ((const int32_t *)source->offsets.buf)[row];
+            end = ((const int32_t *)source->offsets.buf)[row + 1];
+        } else {
+            start = ((const int64_t *)source->offsets.buf)[row];
+            end = ((const int64_t *)source->offsets.buf)[row + 1];
+        }
+
+        if (start < 0 || end < start || end > source->values.len) {
+            return -1;
+        }
+
+        data = (const unsigned char *)source->values.buf + start;
+        size = (Py_ssize_t)(end - start);
+    }
+
+    return utf8_to_utf16(data, size, buffer);
+}
+
+
+/*
+    The strings are converted into UTF-16, the first pass finds the width of the buffer
+*/
+static int bind_column_strings(
+    Cursor *self, Py_ssize_t parameter_number, column_source *source, Py_ssize_t offset, Py_ssize_t row_count,
+    parameter_array *array
+)
+{
+    PRINT_DEBUG_MESSAGE(__FUNCTION__);
+
+    const char *validity = source->validity.obj != NULL ? (const char *)source->validity.buf + offset : NULL;
+    Py_ssize_t max_length = 1;
+
+    array->indicators = PyMem_Malloc(sizeof(SQLLEN) * row_count);
+    if (array->indicators == NULL) {
+        PyErr_NoMemory();
+        return -1;
+    }
+
+    for (Py_ssize_t i = 0; i < row_count; i++) {
+        if (validity != NULL && !validity[i]) {
+            array->indicators[i] = SQL_NULL_DATA;
+            continue;
+        }
+
+        Py_ssize_t length = convert_source_string(source, offset + i, NULL);
+        if (length == -1) {
+            PyErr_Format(
+                PyExc_ValueError,
+                "(%s) The string in the row %lld of the parameter %lld is invalid",
+                __FUNCTION__, (long long)(offset + i), (long long)parameter_number + 1
+            );
+            return -1;
+        }
+
+        array->indicators[i] = length * sizeof(SQLWCHAR);
+        if (length > max_length) {
+            max_length = length;
+        }
+    }
+
+    array->c_type = SQL_C_WCHAR;
+    array->sql_type = max_length > 2000 ? SQL_WLONGVARCHAR : SQL_WVARCHAR;
+    array->column_size = max_length;
+    array->decimal_digits = 0;
+    array->width = max_length * sizeof(SQLWCHAR);
+
+    array->values = PyMem_Malloc(array->width * row_count);
+    if (array->values == NULL) {
+        PyErr_NoMemory();
+        return -1;
+    }
+
+    for (Py_ssize_t i = 0; i < row_count; i++) {
+        if (array->indicators[i] != SQL_NULL_DATA) {
+            convert_source_string(source, offset + i, (SQLWCHAR *)(array->values + i * array->width));
+        }
+    }
+
+    self->retcode = SQLBindParameter(
+        self->handle,
+        (SQLUSMALLINT)(parameter_number + 1),
+        SQL_PARAM_INPUT,
+        array->c_type,
+        array->sql_type,
+        array->column_size,
+        array->decimal_digits,
+        array->values,
+        array->width,
+        array->indicators
+    );
+    CHECK_ERROR("bind_column_strings::SQLBindParameter");
+
+    return 0;
+}
+
+
+/*
+    Binds the rows of the batch from the buffers of the column, the numbers and bools are bound
+    in the buffer of the object without a copy
+*/
+int bind_column_array(
+    Cursor *self, Py_ssize_t parameter_number, column_source *source, Py_ssize_t offset, Py_ssize_t row_count,
+    parameter_array *array
+)
+{
+    PRINT_DEBUG_MESSAGE(__FUNCTION__);
+
+    switch (source->kind) {
+        case SOURCE_INT32:
+            array->c_type = SQL_C_LONG;
+            array->sql_type = SQL_INTEGER;
+            break;
+        case SOURCE_INT64:
+            array->c_type = SQL_C_SBIGINT;
+            array->sql_type = SQL_BIGINT;
+            break;
+        case SOURCE_FLOAT32:
+            array->c_type = SQL_C_FLOAT;
+            array->sql_type = SQL_REAL;
+            break;
+        case SOURCE_FLOAT64:
+            array->c_type = SQL_C_DOUBLE;
+            array->sql_type = SQL_DOUBLE;
+            break;
+        case SOURCE_BOOL:
+            array->c_type = SQL_C_BIT;
+            array->sql_type = SQL_BIT;
+            break;
+        default:
+            return bind_column_strings(self, parameter_number, source, offset, row_count, array);
+    }
+
+    array->column_size = 0;
+    array->decimal_digits = 0;
+    array->width = source->width;
+
+    if (source->validity.obj != NULL) {
+        const char *validity = (const char *)source->validity.buf + offset;
+
+        array->indicators = PyMem_Malloc(sizeof(SQLLEN) * row_count);
+        if (array->indicators == NULL) {
+            PyErr_NoMemory();
+            return -1;
+        }
+
+        for (Py_ssize_t i = 0; i < row_count; i++) {
+            array->indicators[i] = validity[i] ? 0 : SQL_NULL_DATA;
+        }
+    }
+
+    self->retcode = SQLBindParameter(
+        self->handle,
+        (SQLUSMALLINT)(parameter_number + 1),
+        SQL_PARAM_INPUT,
+        array->c_type,
+        array->sql_type,
+        array->column_size,
+        array->decimal_digits,
+        (char *)source->values.buf + offset * array->width,
+        array->width,
+        array->indicators
+    );
+    CHECK_ERROR("bind_column_array::SQLBindParameter");
+
+    return 0;
+}
+
+
+/*
+    Returns the format without the byte order of the native little-endian one, or NULL for big-endian
+*/
+static const char* get_native_format(const char *format)
+{
+    if (format == NULL) {
+        return "B";
+    }
+
+    if (*format == '@' || *format == '=' || *format == '<') {
+        return format + 1;
+    }
+
+    if (*format == '>' || *format == '!') {
+        return NULL;
+    }
+
+    return format;
+}
+
+
+/*
+    The numbers are one-dimensional, the fixed-width strings are also two-dimensional arrays of characters
+*/
+static int get_source_kind(Py_buffer *values)
+{
+    const char *format = get_native_format(values->format);
+    if (format == NULL || values->ndim > 2) {
+        return -1;
+    }
+
+    if (values->ndim == 2 && format[0] != 0) {
+        if (values->itemsize == 1 && strchr("cbBs", format[0]) != NULL && format[1] == 0) {
+            return SOURCE_UTF8;
+        }
+        return values->itemsize == 4 && strchr("uw", format[0]) != NULL && format[1] == 0 ? SOURCE_UCS4 : -1;
+    }
+
+    if (values->ndim == 2) {
+        return -1;
+    }
+
+    // a fixed-width string has the length before its code, e.g. 10s or 10w
+    while (*format >= '0' && *format <= '9') {
+        format++;
+    }
+
+    if (format[0] == 0 || format[1] != 0) {
+        return -1;
+    }
+
+    switch (format[0]) {
+        case 'i':
+        case 'l':
+        case 'q':
+            if (values->itemsize == 4) {
+                return SOURCE_INT32;
+            }
+            return values->itemsize == 8 ? SOURCE_INT64 : -1;
+        case 'f':
+            return values->itemsize == 4 ? SOURCE_FLOAT32 : -1;
+        case 'd':
+            return values->itemsize == 8 ? SOURCE_FLOAT64 : -1;
+        case '?':
+            return values->itemsize == 1 ? SOURCE_BOOL : -1;
+        case 's':
+            return SOURCE_UTF8;
+        case 'w':
+            return values->itemsize % 4 == 0 ? SOURCE_UCS4 : -1;
+    }
+
+    return -1;
+}
+
+
+/*
+    Takes the buffers of a column: an object with the buffer protocol
+    or a dict with values or offsets and data and the optional validity
+*/
+int open_column_source(PyObject *key, PyObject *column, column_source *source)
+{
+    PRINT_DEBUG_MESSAGE(__FUNCTION__);
+
+    PyObject *values = column;
+    PyObject *offsets = NULL;
+    PyObject *validity = NULL;
+
+    if (PyDict_Check(column)) {
+        offsets = PyDict_GetItemString(column, "offsets");
+        validity = PyDict_GetItemString(column, "validity");
+        values = PyDict_GetItemString(column, offsets != NULL ? "data" : "values");
+        if (values == NULL) {
+            PyErr_Format(
+                PyExc_AttributeError,
+                "(%s) The column %R needs 'values' or 'offsets' and 'data'", __FUNCTION__, key
+            );
+            return -1;
+        }
+    }
+
+    if (PyObject_GetBuffer(values, &source->values, PyBUF_C_CONTIGUOUS | PyBUF_FORMAT) == -1) {
+        return -1;
+    }
+
+    if (offsets != NULL) {
+        if (PyObject_GetBuffer(offsets, &source->offsets, PyBUF_C_CONTIGUOUS | PyBUF_FORMAT) == -1) {
+            return -1;
+        }
+
+        const char *format = get_native_format(source->offsets.format);
+        if (format == NULL || source->values.itemsize != 1 || source->offsets.len < source->offsets.itemsize
+            || !(strcmp(format, "i") == 0 || strcmp(format, "l") == 0 || strcmp(format, "q") == 0)
+            || (source->offsets.itemsize != 4 && source->offsets.itemsize != 8)) {
+            PyErr_Format(
+                PyExc_TypeError,
+                "(%s) The column %R needs int32 or int64 offsets and bytes of the data", __FUNCTION__, key
+            );
+            return -1;
+        }
+
+        source->kind = source->offsets.itemsize == 4 ? SOURCE_OFFSETS32 : SOURCE_OFFSETS64;
+        source->row_count = source->offsets.len / source->offsets.itemsize - 1;
+    } else {
+        int kind = get_source_kind(&source->values);
+        if (kind == -1) {
+            PyErr_Format(
+                PyExc_TypeError,
+                "(%s) The format %s of the column %R isn't supported",
+                __FUNCTION__, source->values.format != NULL ? source->values.format : "B", key
+            );
+            return -1;
+        }
+
+        source->kind = (unsigned char)kind;
+        source->row_count = source->values.ndim ? source->values.shape[0] : 1;
+        source->width = source->row_count ? source->values.len / source->row_count : source->values.itemsize;
+    }
+
+    if (validity != NULL && validity != Py_None) {
+        if (PyObject_GetBuffer(validity, &source->validity, PyBUF_C_CONTIGUOUS) == -1) {
+            return -1;
+        }
+
+        if (source->validity.itemsize != 1 || source->validity.len != source->row_count) {
+            PyErr_Format(PyExc_ValueError, "(%s) The validity of the column %R needs a byte per row", __FUNCTION__, key);
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+
+void close_column_source(column_source *source)
+{
+    if (source->values.obj != NULL) {
+        PyBuffer_Release(&source->values);
+    }
+
+    if (source->offsets.obj != NULL) {
+        PyBuffer_Release(&source->offsets);
+    }
+
+    if (source->validity.obj != NULL) {
+        PyBuffer_Release(&source->validity);
+    }
+}
+
+
+/*
+    The datetime API is imported once per translation unit, at the initialization of the module
+*/
+int init_input_data(void)
+{
+    PyDateTime_IMPORT;
+    return PyDateTimeAPI == NULL ? -1 : 0;
+}
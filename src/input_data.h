@@ -19,8 +19,22 @@ int bind_datetime(Cursor *self, Py_ssize_t parameter_number, PyObject *param, pa
 int bind_date(Cursor *self, Py_ssize_t parameter_number, PyObject *param, parameter *parameter_data);
 int bind_time(Cursor *self, Py_ssize_t parameter_number, PyObject *param, parameter *parameter_data);
 int bind_parameter(Cursor *self, Py_ssize_t parameter_number, PyObject *param, parameter *parameter_data);
+void release_views(parameters_info *p_info);
+int bind_parameter_array(
+    Cursor *self, Py_ssize_t parameter_number, PyObject **rows, Py_ssize_t row_count, parameter_array *array
+);
+int bind_column_array(
+    Cursor *self, Py_ssize_t parameter_number, column_source *source, Py_ssize_t offset, Py_ssize_t row_count,
+    parameter_array *array
+);
+int open_column_source(PyObject *key, PyObject *column, column_source *source);
+void close_column_source(column_source *source);
+int init_input_data(void);
 
 extern int check_error(PyObject *self, const char *fn_name);
+extern int is_stream_source(PyObject *param);
+extern int open_stream(PyObject *param, parameter_stream *stream);
+extern void* arena_alloc(arena *memory, size_t size);
 
 
 #endif
@@ -1,6 +1,12 @@
 #ifdef __linux__
 
 
+#include <errno.h>
+#include <poll.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+
 #include "linux.h"
 
 
@@ -11,35 +17,60 @@ HANDLE create_t_event()
         return NULL;
     }
 
+    event->fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (event->fd == -1) {
+        free(event);
+        return NULL;
+    }
+
     event->state = 258;
     event->obj = NULL;
-    event->thread = 0;
+    event->loop = NULL;
+    event->future = NULL;
     return event;
 }
 
 
+void set_t_event(HANDLE event)
+{
+    uint64_t value = 1;
+
+    // the results of the worker are published before the wakeup
+    atomic_thread_fence(memory_order_release);
+    while (write(event->fd, &value, sizeof(value)) == -1 && errno == EINTR) {}
+}
+
+
 void close_t_event(HANDLE event)
 {
+    close(event->fd);
+
     event->state = 258;
+    event->fd = -1;
     event->obj = NULL;
-    event->thread = 0;
 
     free(event);
 }
 
 
-void u_sleep(unsigned long milliseconds)
+short wait_for_single_object(t_event *event, int milliseconds)
 {
-    clock_t time_end = clock() + (milliseconds * CLOCKS_PER_SEC / 1000);
-    while (clock() < time_end) {}
-}
+    uint64_t value;
+    struct pollfd fds = {.fd = event->fd, .events = POLLIN};
+
+    if (event->state == WAIT_OBJECT_0) {
+        return event->state;
+    }
 
+    if (milliseconds && poll(&fds, 1, milliseconds) <= 0) {
+        return event->state;
+    }
 
-short wait_for_single_object(t_event *event, unsigned long milliseconds)
-{
-    if (event->state != WAIT_OBJECT_0) {
-        u_sleep(milliseconds);
+    if (read(event->fd, &value, sizeof(value)) == sizeof(value)) {
+        atomic_thread_fence(memory_order_acquire);
+        event->state = WAIT_OBJECT_0;
     }
+
     return event->state;
 }
 
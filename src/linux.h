@@ -5,6 +5,7 @@
 #ifdef __linux__
 
 
+#include <stdatomic.h>
 #include <stdlib.h>
 #include <time.h>
 #include <pthread.h>
@@ -13,10 +14,17 @@
 #include <sqltypes.h>
 
 
+/*
+    The worker signals the completion only by writing to the eventfd, it's its last access to the event.
+    The state is set after the eventfd is read. It's atomic, because without the GIL
+    another Python thread can check the event of the same object
+*/
 typedef struct t_event {
-    short state;
+    atomic_short state;
+    int fd;
     void *obj;
-    pthread_t thread;
+    struct _object *loop;  // the asyncio loop, which has the eventfd reader
+    struct _object *future;
 } t_event;
 
 
@@ -26,9 +34,9 @@ typedef t_event *HANDLE;
 #define WAIT_OBJECT_0 0
 
 HANDLE create_t_event();
+void set_t_event(HANDLE event);
 void close_t_event(HANDLE event);
-void u_sleep(unsigned long milliseconds);
-short wait_for_single_object(t_event *event, unsigned long milliseconds);
+short wait_for_single_object(t_event *event, int milliseconds);
 char16_t* wctouc(const wchar_t *wc);
 wchar_t* uctowc(char16_t *uc);
 
@@ -4,6 +4,13 @@
 
 // begin static declarations
 static PyObject* PyAODBC_Connect(PyObject *self, PyObject *args, PyObject *kwargs);
+static PyObject* PyAODBC_CreatePool(PyObject *self, PyObject *args, PyObject *kwargs);
+static PyObject* PyAODBC_ConnectMany(PyObject *self, PyObject *args, PyObject *kwargs);
+static PyObject* PyAODBC_ConfigureEnvironment(PyObject *self, PyObject *args, PyObject *kwargs);
+#ifdef __linux__
+static PyObject* PyAODBC_ConfigurePool(PyObject *self, PyObject *args, PyObject *kwargs);
+static PyObject* PyAODBC_PoolStats(PyObject *self);
+#endif
 static PyModuleDef pyaodbc_module;
 // end static declarations
 
@@ -30,7 +37,7 @@ char* get_error_message(const char *fn_name, SQLHANDLE handle, SQLSMALLINT handl
             sql_state,
             &native_error,
             error_message,
-            sizeof(error_message),
+            sizeof(error_message) / sizeof(SQLWCHAR),
             &error_message_len
         );
 
@@ -38,15 +45,17 @@ char* get_error_message(const char *fn_name, SQLHANDLE handle, SQLSMALLINT handl
             size_t fn_name_len = strlen(fn_name);
             char *buffer = (char *)malloc(sizeof(char) * (fn_name_len + 1000));
             if (buffer == NULL) {
-                return "An allocation memory error at buffer";
+                return NULL;
             }
 
             #ifdef _WIN32
             w_sql_state = (wchar_t *)malloc(sizeof(sql_state));
             w_error_message = (wchar_t *)malloc(sizeof(error_message));
-            if (w_sql_state == NULL && w_error_message == NULL) {
+            if (w_sql_state == NULL || w_error_message == NULL) {
                 free(buffer);
-                return "An allocation memory error at wchar_t variables";
+                free(w_sql_state);
+                free(w_error_message);
+                return NULL;
             }
             wcscpy(w_sql_state, (wchar_t *)sql_state);
             wcscpy(w_error_message, (wchar_t *)error_message);
@@ -54,9 +63,11 @@ char* get_error_message(const char *fn_name, SQLHANDLE handle, SQLSMALLINT handl
             #elif __linux__
             w_sql_state = uctowc(sql_state);
             w_error_message = uctowc(error_message);
-            if (w_sql_state == NULL && w_error_message == NULL) {
+            if (w_sql_state == NULL || w_error_message == NULL) {
                 free(buffer);
-                return "An allocation memory error at wchar_t variables";
+                free(w_sql_state);
+                free(w_error_message);
+                return NULL;
             }
             #endif
            
@@ -70,7 +81,7 @@ char* get_error_message(const char *fn_name, SQLHANDLE handle, SQLSMALLINT handl
                 w_error_message
             );
 
-            char *formatted_error_message = (char *)malloc(sizeof(char) * (size_t)new_size);
+            char *formatted_error_message = (char *)malloc(sizeof(char) * ((size_t)new_size + 1));
             if (formatted_error_message != NULL) {
                 strcpy(formatted_error_message, buffer);
             }
@@ -91,24 +102,10 @@ int check_error(PyObject *self, const char *fn_name)
 {
     PRINT_DEBUG_MESSAGE(__FUNCTION__);
 
-    SQLRETURN retcode;
-    SQLHANDLE handle;
-    SQLSMALLINT handle_type;
-
-    if (PyObject_TypeCheck(self, &Connection_Type)) {
-        Connection *conn = (Connection *)self;
-        retcode = conn->retcode;
-        handle = conn->handle;
-        handle_type = conn->handle_type;
-    } else if (PyObject_TypeCheck(self, &Cursor_Type)) {
-        Cursor *cursor = (Cursor *)self;
-        retcode = cursor->retcode;
-        handle = cursor->handle;
-        handle_type = cursor->handle_type;
-    } else {
-        PyErr_Format(PyExc_TypeError, "(%s) An unknown type for type checking", __FUNCTION__);
-        return 1;
-    }
+    odbc_object *object = (odbc_object *)self;
+    SQLRETURN retcode = object->retcode;
+    SQLHANDLE handle = object->handle;
+    SQLSMALLINT handle_type = object->handle_type;
 
     if (retcode != SQL_SUCCESS && retcode != SQL_SUCCESS_WITH_INFO && retcode != SQL_STILL_EXECUTING) {
         char *error_message = get_error_message(fn_name, handle, handle_type);
@@ -126,17 +123,211 @@ int check_error(PyObject *self, const char *fn_name)
 }
 
 
+module_state* get_object_state(PyObject *self)
+{
+    Connection *conn;
+
+    if (((odbc_object *)self)->handle_type == SQL_HANDLE_DBC) {
+        conn = (Connection *)self;
+    } else {
+        conn = ((Cursor *)self)->conn;
+    }
+
+    return (module_state *)PyModule_GetState(conn->module);
+}
+
+
+#ifdef __linux__
+/*
+    Called on the event loop thread, when the task awaiting a connection or a cursor is cancelled
+*/
+void cancel_awaitable(PyObject *self, PyObject *future)
+{
+    PRINT_DEBUG_MESSAGE(__FUNCTION__);
+
+    if (((odbc_object *)self)->handle_type == SQL_HANDLE_DBC) {
+        Py_BEGIN_CRITICAL_SECTION(self);
+        cancel_connection((Connection *)self, future);
+        Py_END_CRITICAL_SECTION();
+    } else {
+        Cursor *cursor = (Cursor *)self;
+        Py_BEGIN_CRITICAL_SECTION2(cursor, cursor->conn);
+        cancel_cursor(cursor, future);
+        Py_END_CRITICAL_SECTION2();
+    }
+}
+
+
+/*
+    Called when the worker of the cancelled awaitable has finished.
+    The abandoned connection is released by its deallocation
+*/
+void complete_cancelled_awaitable(PyObject *self)
+{
+    PRINT_DEBUG_MESSAGE(__FUNCTION__);
+
+    if (((odbc_object *)self)->handle_type == SQL_HANDLE_STMT) {
+        Cursor *cursor = (Cursor *)self;
+        Py_BEGIN_CRITICAL_SECTION2(cursor, cursor->conn);
+        complete_cancelled_cursor(cursor);
+        Py_END_CRITICAL_SECTION2();
+    }
+}
+#endif
+
+
+/*
+    The environment is allocated once, with the pooling the driver manager keeps a pool of connections for it
+*/
+static SQLHENV get_environment(PyObject *module, const char *fn_name)
+{
+    PRINT_DEBUG_MESSAGE(__FUNCTION__);
+
+    module_state *state = (module_state *)PyModule_GetState(module);
+    SQLHENV env = SQL_NULL_HENV;
+    SQLRETURN retcode;
+    const char *failed_fn = NULL;
+
+    Py_BEGIN_CRITICAL_SECTION(module);
+
+    if (state->env != SQL_NULL_HENV) {
+        env = state->env;
+        goto unlock;
+    }
+
+    if (state->env_pooling) {
+        // the process-wide attribute must be set before the allocation
+        retcode = SQLSetEnvAttr(
+            SQL_NULL_HANDLE, SQL_ATTR_CONNECTION_POOLING, (SQLPOINTER)SQL_CP_ONE_PER_HENV, SQL_IS_UINTEGER
+        );
+        if (!SQL_SUCCEEDED(retcode)) {
+            failed_fn = "SQLSetEnvAttr::SQL_ATTR_CONNECTION_POOLING";
+            goto unlock;
+        }
+    }
+
+    retcode = SQLAllocHandle(SQL_HANDLE_ENV, SQL_NULL_HANDLE, &env);
+    if (!SQL_SUCCEEDED(retcode)) {
+        env = SQL_NULL_HENV;
+        failed_fn = "SQLAllocHandle::SQL_HANDLE_ENV";
+        goto unlock;
+    }
+
+    retcode = SQLSetEnvAttr(env, SQL_ATTR_ODBC_VERSION, (SQLPOINTER)SQL_OV_ODBC3_80, SQL_IS_INTEGER);
+    if (!SQL_SUCCEEDED(retcode)) {
+        failed_fn = "SQLSetEnvAttr::SQL_ATTR_ODBC_VERSION";
+        goto free_env;
+    }
+
+    if (state->env_pooling) {
+        SQLUINTEGER match = state->env_relaxed_match ? SQL_CP_RELAXED_MATCH : SQL_CP_STRICT_MATCH;
+        retcode = SQLSetEnvAttr(env, SQL_ATTR_CP_MATCH, (SQLPOINTER)(SQLULEN)match, SQL_IS_UINTEGER);
+        if (!SQL_SUCCEEDED(retcode)) {
+            failed_fn = "SQLSetEnvAttr::SQL_ATTR_CP_MATCH";
+            goto free_env;
+        }
+    }
+
+    state->env = env;
+    goto unlock;
+
+    free_env:
+        SQLFreeHandle(SQL_HANDLE_ENV, env);
+        env = SQL_NULL_HENV;
+
+    unlock:
+        Py_END_CRITICAL_SECTION();
+
+    if (env == SQL_NULL_HENV) {
+        PyErr_Format(PyExc_Exception, "(%s) Failed to allocate the environment: %s", fn_name, failed_fn);
+    }
+
+    return env;
+}
+
+
+/*
+    Creates a connection and starts the connecting, the connection takes the dsn
+*/
+Connection* create_connection(PyObject *module, const wchar_t *dsn, double timeout, int polling, const char *fn_name)
+{
+    PRINT_DEBUG_MESSAGE(__FUNCTION__);
+
+    module_state *state = (module_state *)PyModule_GetState(module);
+
+    // a new reference, another thread can replace the attribute
+    PyObject *rate = PyObject_GetAttrString(module, "_rate");
+    if (rate == NULL) {
+        PyMem_Free((void *)dsn);
+        return NULL;
+    }
+
+    if (!PyFloat_Check(rate)) {
+        Py_DECREF(rate);
+        PyMem_Free((void *)dsn);
+        PyErr_Format(PyExc_ValueError, "(%s) The rate value must be float", fn_name);
+        return NULL;
+    }
+
+    double rate_value = PyFloat_AsDouble(rate);
+    Py_DECREF(rate);
+    if (rate_value < 0) {
+        PyMem_Free((void *)dsn);
+        PyErr_Format(PyExc_AttributeError, "(%s) The rate value must be nonnegative", fn_name);
+        return NULL;
+    }
+
+    SQLHENV env = get_environment(module, fn_name);
+    if (env == SQL_NULL_HENV) {
+        PyMem_Free((void *)dsn);
+        return NULL;
+    }
+
+    Connection *conn = PyObject_New(Connection, state->connection_type);
+    if (conn == NULL) {
+        PyMem_Free((void *)dsn);
+        return NULL;
+    }
+
+    // the connections keep the module and its worker threads alive
+    Py_INCREF(module);
+    conn->module = module;
+    conn->owner = NULL;
+
+    #ifdef __linux__
+    void *pool = &state->pool;
+    void *wheel = &state->wheel;
+    void *statements_poller = polling ? &state->poller : NULL;
+    #elif _WIN32
+    void *pool = NULL;
+    void *wheel = NULL;
+    void *statements_poller = NULL;  // the statements are always asynchronous
+    #endif
+
+    if (connect_async(conn, env, pool, wheel, statements_poller, dsn, timeout) == -1) {
+        Py_DECREF(conn);  // the connection has already taken the dsn
+        return NULL;
+    }
+
+    conn->rate = rate_value;
+    conn->state = TO_CONNECT;
+
+    return conn;
+}
+
+
 static PyObject* PyAODBC_Connect(PyObject *self, PyObject *args, PyObject *kwargs)
 {
     PRINT_DEBUG_MESSAGE(__FUNCTION__);
 
-    static char *kwlist[] = {"dsn", "timeout", NULL};
+    static char *kwlist[] = {"dsn", "timeout", "polling", NULL};
     PyObject *py_dsn = NULL;
-    long long timeout = 0;
+    double timeout = 0;
+    int polling = 0;
     const wchar_t *dsn;
     Py_ssize_t string_length;
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|L", kwlist, &py_dsn, &timeout)) {
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|dp", kwlist, &py_dsn, &timeout, &polling)) {
         return NULL;
     }
 
@@ -155,102 +346,322 @@ static PyObject* PyAODBC_Connect(PyObject *self, PyObject *args, PyObject *kwarg
         return NULL;
     }
 
-    PyObject *module_struct = PyState_FindModule(&pyaodbc_module);
-    PyObject *module_dict = PyModule_GetDict(module_struct);
-    PyObject *rate = PyDict_GetItemString(module_dict, "_rate");
+    string_length = PyUnicode_GET_LENGTH(py_dsn);
+    dsn = (const wchar_t *)PyUnicode_AsWideCharString(py_dsn, &string_length);
+    if (dsn == NULL) {
+        PyErr_NoMemory();
+        return NULL;
+    }
 
-    if (!PyFloat_Check(rate)) {
-        PyErr_Format(PyExc_ValueError, "(%s) The rate value must be float", __FUNCTION__);
+    return (PyObject *)create_connection(self, dsn, timeout, polling, __FUNCTION__);
+}
+
+
+static PyObject* PyAODBC_CreatePool(PyObject *self, PyObject *args, PyObject *kwargs)
+{
+    PRINT_DEBUG_MESSAGE(__FUNCTION__);
+
+    return create_pool(self, args, kwargs);
+}
+
+
+static PyObject* PyAODBC_ConnectMany(PyObject *self, PyObject *args, PyObject *kwargs)
+{
+    PRINT_DEBUG_MESSAGE(__FUNCTION__);
+
+    return create_connection_group(self, args, kwargs);
+}
+
+
+static PyObject* PyAODBC_ConfigureEnvironment(PyObject *self, PyObject *args, PyObject *kwargs)
+{
+    PRINT_DEBUG_MESSAGE(__FUNCTION__);
+
+    static char *kwlist[] = {"pooling", "strict_match", NULL};
+    module_state *state = (module_state *)PyModule_GetState(self);
+    int pooling = 0;
+    int strict_match = 1;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "|pp", kwlist, &pooling, &strict_match)) {
         return NULL;
     }
 
-    double rate_value = PyFloat_AsDouble(rate);
-    if (rate_value < 0) {
-        PyErr_Format(PyExc_AttributeError, "(%s) The rate value must be nonnegative", __FUNCTION__);
+    PyObject *result = Py_None;
+
+    Py_BEGIN_CRITICAL_SECTION(self);
+    if (state->env != SQL_NULL_HENV) {
+        result = NULL;
+    } else {
+        state->env_pooling = pooling ? 1 : 0;
+        state->env_relaxed_match = strict_match ? 0 : 1;
+    }
+    Py_END_CRITICAL_SECTION();
+
+    if (result == NULL) {
+        PyErr_Format(PyExc_Exception, "(%s) The environment is already allocated", __FUNCTION__);
         return NULL;
     }
 
-    Connection *conn = PyObject_New(Connection, &Connection_Type);
-    if (conn == NULL) {
+    Py_RETURN_NONE;
+}
+
+
+#ifdef __linux__
+static PyObject* PyAODBC_ConfigurePool(PyObject *self, PyObject *args, PyObject *kwargs)
+{
+    PRINT_DEBUG_MESSAGE(__FUNCTION__);
+
+    static char *kwlist[] = {"threads", "stack_size", "queue_size", NULL};
+    thread_pool *pool = &((module_state *)PyModule_GetState(self))->pool;
+    Py_ssize_t threads_count = (Py_ssize_t)pool->threads_count;
+    Py_ssize_t stack_size = (Py_ssize_t)pool->stack_size;
+    Py_ssize_t queue_size = (Py_ssize_t)pool->queue_size;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "|nnn", kwlist, &threads_count, &stack_size, &queue_size)) {
         return NULL;
     }
 
-    string_length = PyUnicode_GET_LENGTH(py_dsn);
-    dsn = (const wchar_t *)PyUnicode_AsWideCharString(py_dsn, &string_length);
-    if (dsn == NULL) {
-        PyErr_NoMemory();
+    if (threads_count <= 0 || queue_size <= 0) {
+        PyErr_Format(PyExc_AttributeError, "(%s) The number of threads and the queue size must be positive", __FUNCTION__);
         return NULL;
     }
 
-    if (connect_async(conn, dsn, timeout) == -1) {
-        Py_DECREF(conn);
-        PyMem_Free((void *)dsn);
+    if (stack_size < 0) {
+        PyErr_Format(PyExc_AttributeError, "(%s) The stack size must be nonnegative", __FUNCTION__);
         return NULL;
     }
 
-    conn->rate = rate_value;
-    conn->state = TO_CONNECT;
-    if (timeout) {
-        conn->start_time = clock() / CLOCKS_PER_SEC;
+    if (thread_pool_configure(pool, (size_t)threads_count, (size_t)stack_size, (size_t)queue_size) == -1) {
+        PyErr_Format(PyExc_Exception, "(%s) The worker pool is already started", __FUNCTION__);
+        return NULL;
     }
-    
-    return (PyObject *)conn;
+
+    Py_RETURN_NONE;
+}
+
+
+static PyObject* PyAODBC_PoolStats(PyObject *self)
+{
+    PRINT_DEBUG_MESSAGE(__FUNCTION__);
+
+    module_state *state = (module_state *)PyModule_GetState(self);
+
+    return Py_BuildValue(
+        "{s:n,s:n,s:n,s:n,s:n,s:O,s:n}",
+        "threads", (Py_ssize_t)state->pool.threads_count,
+        "stack_size", (Py_ssize_t)state->pool.stack_size,
+        "queue_size", (Py_ssize_t)state->pool.queue_size,
+        "depth", (Py_ssize_t)atomic_load(&state->pool.depth),
+        "active", (Py_ssize_t)atomic_load(&state->pool.active),
+        "started", atomic_load(&state->pool.state) == THREAD_POOL_RUNNING ? Py_True : Py_False,
+        "polled", (Py_ssize_t)poller_count(&state->poller)
+    );
 }
+#endif
 
 
 static PyMethodDef PyAODBC_Methods[] = {
     {"connect", (PyCFunction)PyAODBC_Connect, METH_VARARGS|METH_KEYWORDS, "Asynchronous connection"},
+    {"create_pool", (PyCFunction)PyAODBC_CreatePool, METH_VARARGS|METH_KEYWORDS, "Create a connection pool"},
+    {"connect_many", (PyCFunction)PyAODBC_ConnectMany, METH_VARARGS|METH_KEYWORDS, "Open several connections in parallel"},
+    {"configure_environment", (PyCFunction)PyAODBC_ConfigureEnvironment, METH_VARARGS|METH_KEYWORDS, "Configure the ODBC environment"},
+    #ifdef __linux__
+    {"configure_pool", (PyCFunction)PyAODBC_ConfigurePool, METH_VARARGS|METH_KEYWORDS, "Configure the worker pool"},
+    {"pool_stats", (PyCFunction)PyAODBC_PoolStats, METH_NOARGS, "Statistics of the worker pool"},
+    #endif
     {NULL, NULL, 0, NULL}
 };
 
 
-static PyModuleDef pyaodbc_module = {
-    PyModuleDef_HEAD_INIT,
-    .m_name = "pyaodbc",
-    .m_doc = "PyAODBC Module",
-    .m_size = -1,
-    .m_methods = PyAODBC_Methods
-};
+/*
+    Each interpreter executes the module with its own types, worker pool, timer wheel and poller
+*/
+static int pyaodbc_exec(PyObject *module)
+{
+    PRINT_DEBUG_MESSAGE(__FUNCTION__);
 
+    module_state *state = (module_state *)PyModule_GetState(module);
 
-PyMODINIT_FUNC PyInit_pyaodbc(void)
-{    
     setlocale(LC_ALL, ".utf-8");  // if You need to print wchar_t symbols to the console
 
-    if (PyType_Ready(&Connection_Type) < 0) {
-        return NULL;
+    #ifdef __linux__
+    if (thread_pool_init(&state->pool) == -1) {
+        PyErr_SetString(PyExc_SystemError, "(pyaodbc_exec) Failed to initialize the worker pool");
+        return -1;
     }
 
-    if (PyType_Ready(&Cursor_Type) < 0) {
-        return NULL;
+    if (timer_wheel_init(&state->wheel) == -1) {
+        PyErr_SetString(PyExc_SystemError, "(pyaodbc_exec) Failed to initialize the timer wheel");
+        return -1;
     }
 
-    PyObject *module = PyModule_Create(&pyaodbc_module);
-    if (module == NULL) {
-        return NULL;
+    if (poller_init(&state->poller) == -1) {
+        PyErr_SetString(PyExc_SystemError, "(pyaodbc_exec) Failed to initialize the poller");
+        return -1;
     }
-    
-    PyObject *rate = Py_BuildValue("d", 1.0);
-    if (PyModule_AddObject(module, "_rate", rate) < 0) {
-        goto clean_up;
+    #endif
+
+    if (init_input_data() == -1 || init_get_data() == -1) {
+        return -1;
     }
 
-    Py_INCREF(&Connection_Type);
-    if (PyModule_AddObject(module, "Connection", (PyObject *)&Connection_Type) < 0) {
-        goto clean_up;
+    state->connection_type = (PyTypeObject *)PyType_FromSpec(&Connection_Spec);
+    if (state->connection_type == NULL) {
+        return -1;
     }
 
-    Py_INCREF(&Cursor_Type);
-    if (PyModule_AddObject(module, "Cursor", (PyObject *)&Cursor_Type) < 0) {
-        goto clean_up;
+    state->cursor_type = (PyTypeObject *)PyType_FromSpec(&Cursor_Spec);
+    if (state->cursor_type == NULL) {
+        return -1;
     }
 
-    return module;
+    state->pool_type = (PyTypeObject *)PyType_FromSpec(&ConnectionPool_Spec);
+    if (state->pool_type == NULL) {
+        return -1;
+    }
+
+    state->pool_request_type = (PyTypeObject *)PyType_FromSpec(&PoolRequest_Spec);
+    if (state->pool_request_type == NULL) {
+        return -1;
+    }
 
-    clean_up:
+    state->group_type = (PyTypeObject *)PyType_FromSpec(&ConnectionGroup_Spec);
+    if (state->group_type == NULL) {
+        return -1;
+    }
+
+    #ifndef Py_TPFLAGS_DISALLOW_INSTANTIATION
+    // the objects are created only by connect and cursor
+    state->connection_type->tp_new = NULL;
+    state->cursor_type->tp_new = NULL;
+    state->pool_type->tp_new = NULL;
+    state->pool_request_type->tp_new = NULL;
+    state->group_type->tp_new = NULL;
+    #endif
+
+    PyObject *rate = PyFloat_FromDouble(1.0);
+    if (rate == NULL || PyModule_AddObject(module, "_rate", rate) < 0) {
         Py_XDECREF(rate);
-        Py_XDECREF(&Cursor_Type);
-        Py_XDECREF(&Cursor_Type);
-        Py_DECREF(module);
-        return NULL;
+        return -1;
+    }
+
+    // the statuses of the rows of executemany
+    if (PyModule_AddIntConstant(module, "PARAM_SUCCESS", SQL_PARAM_SUCCESS) < 0
+        || PyModule_AddIntConstant(module, "PARAM_SUCCESS_WITH_INFO", SQL_PARAM_SUCCESS_WITH_INFO) < 0
+        || PyModule_AddIntConstant(module, "PARAM_ERROR", SQL_PARAM_ERROR) < 0
+        || PyModule_AddIntConstant(module, "PARAM_UNUSED", SQL_PARAM_UNUSED) < 0
+        || PyModule_AddIntConstant(module, "PARAM_DIAG_UNAVAILABLE", SQL_PARAM_DIAG_UNAVAILABLE) < 0) {
+        return -1;
+    }
+
+    Py_INCREF(state->connection_type);
+    if (PyModule_AddObject(module, "Connection", (PyObject *)state->connection_type) < 0) {
+        Py_DECREF(state->connection_type);
+        return -1;
+    }
+
+    Py_INCREF(state->cursor_type);
+    if (PyModule_AddObject(module, "Cursor", (PyObject *)state->cursor_type) < 0) {
+        Py_DECREF(state->cursor_type);
+        return -1;
+    }
+
+    Py_INCREF(state->pool_type);
+    if (PyModule_AddObject(module, "ConnectionPool", (PyObject *)state->pool_type) < 0) {
+        Py_DECREF(state->pool_type);
+        return -1;
+    }
+
+    return 0;
+}
+
+
+static int pyaodbc_traverse(PyObject *module, visitproc visit, void *arg)
+{
+    module_state *state = (module_state *)PyModule_GetState(module);
+
+    Py_VISIT(state->connection_type);
+    Py_VISIT(state->cursor_type);
+    Py_VISIT(state->pool_type);
+    Py_VISIT(state->pool_request_type);
+    Py_VISIT(state->group_type);
+
+    return 0;
+}
+
+
+static int pyaodbc_clear(PyObject *module)
+{
+    module_state *state = (module_state *)PyModule_GetState(module);
+
+    Py_CLEAR(state->connection_type);
+    Py_CLEAR(state->cursor_type);
+    Py_CLEAR(state->pool_type);
+    Py_CLEAR(state->pool_request_type);
+    Py_CLEAR(state->group_type);
+
+    #ifdef __linux__
+    PyObject *get_running_loop = atomic_exchange(&state->get_running_loop, NULL);
+    Py_XDECREF(get_running_loop);
+    #endif
+
+    return 0;
+}
+
+
+/*
+    The module is freed after its last connection, so the threads don't have tasks
+*/
+static void pyaodbc_free(void *module)
+{
+    PRINT_DEBUG_MESSAGE(__FUNCTION__);
+
+    pyaodbc_clear((PyObject *)module);
+
+    module_state *state = (module_state *)PyModule_GetState((PyObject *)module);
+
+    #ifdef __linux__
+    Py_BEGIN_ALLOW_THREADS
+    poller_stop(&state->poller);
+    timer_wheel_stop(&state->wheel);
+    thread_pool_stop(&state->pool);
+    Py_END_ALLOW_THREADS
+    #endif
+
+    // the connections keep the module, so all of them are freed
+    if (state->env != SQL_NULL_HENV) {
+        SQLFreeHandle(SQL_HANDLE_ENV, state->env);
+        state->env = SQL_NULL_HENV;
+    }
+}
+
+
+static PyModuleDef_Slot pyaodbc_slots[] = {
+    {Py_mod_exec, pyaodbc_exec},
+    #ifdef Py_mod_multiple_interpreters
+    {Py_mod_multiple_interpreters, Py_MOD_PER_INTERPRETER_GIL_SUPPORTED},
+    #endif
+    #ifdef Py_mod_gil
+    {Py_mod_gil, Py_MOD_GIL_NOT_USED},
+    #endif
+    {0, NULL}
+};
+
+
+static PyModuleDef pyaodbc_module = {
+    PyModuleDef_HEAD_INIT,
+    .m_name = "pyaodbc",
+    .m_doc = "PyAODBC Module",
+    .m_size = sizeof(module_state),
+    .m_methods = PyAODBC_Methods,
+    .m_slots = pyaodbc_slots,
+    .m_traverse = pyaodbc_traverse,
+    .m_clear = pyaodbc_clear,
+    .m_free = pyaodbc_free
+};
+
+
+PyMODINIT_FUNC PyInit_pyaodbc(void)
+{
+    return PyModuleDef_Init(&pyaodbc_module);
 }
@@ -7,11 +7,32 @@
 
 char* get_error_message(const char *fn_name, SQLHANDLE handle, SQLSMALLINT handle_type);
 int check_error(PyObject *self, const char *fn_name);
+module_state* get_object_state(PyObject *self);
+Connection* create_connection(PyObject *module, const wchar_t *dsn, double timeout, int polling, const char *fn_name);
+#ifdef __linux__
+void cancel_awaitable(PyObject *self, PyObject *future);
+void complete_cancelled_awaitable(PyObject *self);
+#endif
 PyMODINIT_FUNC PyInit_pyaodbc(void);
 
-extern int connect_async(Connection *self, const wchar_t *dsn, long long timeout);
-extern PyTypeObject Connection_Type;
-extern PyTypeObject Cursor_Type;
+extern int connect_async(
+    Connection *self, SQLHENV env, void *pool, void *wheel, void *statements_poller, const wchar_t *dsn, double timeout
+);
+extern PyType_Spec Connection_Spec;
+extern PyType_Spec Cursor_Spec;
+extern PyType_Spec ConnectionPool_Spec;
+extern PyType_Spec PoolRequest_Spec;
+extern PyType_Spec ConnectionGroup_Spec;
+extern PyObject* create_pool(PyObject *module, PyObject *args, PyObject *kwargs);
+extern PyObject* create_connection_group(PyObject *module, PyObject *args, PyObject *kwargs);
+extern int init_input_data(void);
+extern int init_get_data(void);
+
+#ifdef __linux__
+extern void cancel_connection(Connection *self, PyObject *future);
+extern void cancel_cursor(Cursor *self, PyObject *future);
+extern void complete_cancelled_cursor(Cursor *self);
+#endif
 
 
 #endif
@@ -0,0 +1,146 @@
+#ifdef __linux__
+
+
+#include <time.h>
+
+#include "poller.h"
+
+
+static void poll_entries(poller *self)
+{
+    poll_entry **link = &self->polled;
+    size_t finished = 0;
+
+    while (*link != NULL) {
+        poll_entry *entry = *link;
+        poll_entry *next = entry->next;
+
+        if (entry->routine(entry)) {
+            link = &entry->next;
+        } else {
+            *link = next;  // the entry isn't touched after its routine has finished
+            finished++;
+        }
+    }
+
+    if (finished) {
+        pthread_mutex_lock(&self->lock);
+        self->count -= finished;
+        pthread_mutex_unlock(&self->lock);
+    }
+}
+
+
+static void* poller_main(void *handle)
+{
+    poller *self = (poller *)handle;
+    struct timespec interval = {.tv_sec = 0, .tv_nsec = POLLER_INTERVAL * 1000};
+
+    pthread_mutex_lock(&self->lock);
+
+    while (self->state == POLLER_RUNNING) {
+        if (self->submitted != NULL) {
+            // the new entries are appended to the head, their order isn't important
+            poll_entry *last = self->submitted;
+            while (last->next != NULL) {
+                last = last->next;
+            }
+            last->next = self->polled;
+            self->polled = self->submitted;
+            self->submitted = NULL;
+        }
+
+        if (self->polled == NULL) {
+            pthread_cond_wait(&self->wakeup, &self->lock);
+            continue;
+        }
+
+        pthread_mutex_unlock(&self->lock);
+
+        poll_entries(self);
+        if (self->polled != NULL) {
+            nanosleep(&interval, NULL);
+        }
+
+        pthread_mutex_lock(&self->lock);
+    }
+
+    pthread_mutex_unlock(&self->lock);
+    return NULL;
+}
+
+
+int poller_init(poller *self)
+{
+    self->polled = NULL;
+    self->submitted = NULL;
+    self->count = 0;
+    self->state = POLLER_STOPPED;
+
+    if (pthread_mutex_init(&self->lock, NULL) != 0) {
+        return -1;
+    }
+
+    if (pthread_cond_init(&self->wakeup, NULL) != 0) {
+        pthread_mutex_destroy(&self->lock);
+        return -1;
+    }
+
+    return 0;
+}
+
+
+int poller_submit(poller *self, poll_entry *entry)
+{
+    pthread_mutex_lock(&self->lock);
+
+    if (self->state != POLLER_RUNNING) {
+        self->state = POLLER_RUNNING;
+        if (pthread_create(&self->thread, NULL, poller_main, self) != 0) {
+            self->state = POLLER_STOPPED;
+            pthread_mutex_unlock(&self->lock);
+            return -1;
+        }
+    }
+
+    entry->next = self->submitted;
+    self->submitted = entry;
+    self->count++;
+
+    pthread_cond_signal(&self->wakeup);
+    pthread_mutex_unlock(&self->lock);
+    return 0;
+}
+
+
+size_t poller_count(poller *self)
+{
+    pthread_mutex_lock(&self->lock);
+    size_t count = self->count;
+    pthread_mutex_unlock(&self->lock);
+
+    return count;
+}
+
+
+/*
+    The polled statements must be finished or canceled before, their events won't be signaled
+*/
+void poller_stop(poller *self)
+{
+    pthread_mutex_lock(&self->lock);
+
+    if (self->state != POLLER_RUNNING) {
+        pthread_mutex_unlock(&self->lock);
+        return;
+    }
+
+    self->state = POLLER_STOPPED;
+    pthread_cond_signal(&self->wakeup);
+    pthread_mutex_unlock(&self->lock);
+
+    pthread_join(self->thread, NULL);
+}
+
+
+#endif
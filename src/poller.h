@@ -0,0 +1,56 @@
+#ifndef _POLLER_H_
+#define _POLLER_H_
+
+
+#ifdef __linux__
+
+
+#include <pthread.h>
+#include <stddef.h>
+
+
+#define POLLER_INTERVAL 1000  // microseconds between the rounds
+
+#define POLLER_STOPPED 0
+#define POLLER_RUNNING 1
+
+
+struct poll_entry;
+
+/*
+    Calls an ODBC function in the asynchronous mode once, returns 1 while it returns SQL_STILL_EXECUTING.
+    A finished routine signals its event, after that the entry belongs to the event loop thread
+*/
+typedef int (*poll_routine)(struct poll_entry *entry);
+
+typedef struct poll_entry {
+    struct poll_entry *next;
+    poll_routine routine;
+    void *arg;
+} poll_entry;
+
+/*
+    One thread re-invokes the statements of all connections, which are executed in the polling mode.
+    The submitted entries are taken by the thread under the lock, the polled list is owned by the thread
+*/
+typedef struct poller {
+    poll_entry *polled;
+    poll_entry *submitted;
+    size_t count;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t wakeup;
+    int state;
+} poller;
+
+
+int poller_init(poller *self);
+int poller_submit(poller *self, poll_entry *entry);
+size_t poller_count(poller *self);
+void poller_stop(poller *self);
+
+
+#endif
+
+
+#endif
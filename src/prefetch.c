@@ -0,0 +1,213 @@
+#include "prefetch.h"
+
+
+prefetch_info* create_prefetch(size_t size, size_t depth)
+{
+    PRINT_DEBUG_MESSAGE(__FUNCTION__);
+
+    prefetch_info *prefetch = (prefetch_info *)malloc(sizeof(prefetch_info));
+    if (prefetch == NULL) {
+        return NULL;
+    }
+
+    prefetch->batches = (row_batch **)malloc(sizeof(row_batch *) * depth);
+    if (prefetch->batches == NULL) {
+        free(prefetch);
+        return NULL;
+    }
+
+    #ifdef __linux__
+    if (pthread_mutex_init(&prefetch->lock, NULL) != 0) {
+        free(prefetch->batches);
+        free(prefetch);
+        return NULL;
+    }
+
+    if (pthread_cond_init(&prefetch->idle, NULL) != 0) {
+        pthread_mutex_destroy(&prefetch->lock);
+        free(prefetch->batches);
+        free(prefetch);
+        return NULL;
+    }
+    #endif
+
+    prefetch->depth = depth;
+    prefetch->head = 0;
+    prefetch->count = 0;
+    prefetch->size = size;
+    prefetch->is_running = 0;
+    prefetch->is_end = 0;
+    prefetch->is_stopped = 0;
+    prefetch->no_memory = 0;
+    return prefetch;
+}
+
+
+void free_prefetch(Cursor *self, prefetch_info *prefetch)
+{
+    PRINT_DEBUG_MESSAGE(__FUNCTION__);
+
+    for (size_t i = 0; i < prefetch->count; i++) {
+        free_batch(self, prefetch->batches[(prefetch->head + i) % prefetch->depth]);
+    }
+
+    #ifdef __linux__
+    pthread_cond_destroy(&prefetch->idle);
+    pthread_mutex_destroy(&prefetch->lock);
+    #endif
+
+    free(prefetch->batches);
+    free(prefetch);
+}
+
+
+static void push_batch(prefetch_info *prefetch, row_batch *batch)
+{
+    if (batch == NULL) {
+        prefetch->no_memory = 1;
+        prefetch->is_end = 1;
+        return;
+    }
+
+    prefetch->batches[(prefetch->head + prefetch->count) % prefetch->depth] = batch;
+    prefetch->count++;
+
+    if (batch->is_end || batch->failed_fn != NULL || batch->no_memory) {
+        prefetch->is_end = 1;
+    }
+}
+
+
+/*
+    Takes the oldest filled batch. is_end is set if there isn't a batch and the filler has finished
+*/
+row_batch* pop_batch(Cursor *self, int *is_end)
+{
+    prefetch_info *prefetch = self->prefetch;
+    row_batch *batch = NULL;
+
+    #ifdef __linux__
+    pthread_mutex_lock(&prefetch->lock);
+    #endif
+
+    if (prefetch->count) {
+        batch = prefetch->batches[prefetch->head];
+        prefetch->head = (prefetch->head + 1) % prefetch->depth;
+        prefetch->count--;
+    }
+    *is_end = batch == NULL && prefetch->is_end;
+
+    #ifdef __linux__
+    pthread_mutex_unlock(&prefetch->lock);
+    #endif
+
+    return batch;
+}
+
+
+#ifdef __linux__
+void* t_sql_prefetch(void *handle)
+{
+    PRINT_DEBUG_MESSAGE(__FUNCTION__);
+
+    HANDLE event = (HANDLE)handle;
+
+    Cursor *cursor = event->obj;
+    prefetch_info *prefetch = cursor->prefetch;
+    int is_continue;
+
+    do {
+        row_batch *batch = create_batch(prefetch->size);
+        if (batch != NULL) {
+            fetch_rows(cursor, batch);
+        }
+
+        pthread_mutex_lock(&prefetch->lock);
+
+        push_batch(prefetch, batch);
+        is_continue = !prefetch->is_end && !prefetch->is_stopped && prefetch->count < prefetch->depth;
+
+        // the event and the cursor can be released as soon as the filler isn't running, so it's done under the lock
+        set_t_event(event);
+        if (!is_continue) {
+            prefetch->is_running = 0;
+            pthread_cond_signal(&prefetch->idle);
+        }
+
+        pthread_mutex_unlock(&prefetch->lock);
+    } while (is_continue);
+
+    return NULL;
+}
+#endif
+
+
+/*
+    Linux: submits the filler, if it isn't running and there is a free place in the ring.
+    Windows: fetches a batch on the calling thread, if the ring is empty
+*/
+int fill_batches(Cursor *self)
+{
+    PRINT_DEBUG_MESSAGE(__FUNCTION__);
+
+    prefetch_info *prefetch = self->prefetch;
+
+    #ifdef _WIN32
+    if (!prefetch->count && !prefetch->is_end) {
+        row_batch *batch = create_batch(prefetch->size);
+        if (batch != NULL) {
+            fetch_rows(self, batch);
+        }
+        push_batch(prefetch, batch);
+    }
+
+    #elif __linux__
+    pthread_mutex_lock(&prefetch->lock);
+    int is_submit = !prefetch->is_running && !prefetch->is_end && !prefetch->is_stopped && \
+        prefetch->count < prefetch->depth;
+    if (is_submit) {
+        prefetch->is_running = 1;
+    }
+    pthread_mutex_unlock(&prefetch->lock);
+
+    if (is_submit && thread_pool_submit(self->conn->pool, t_sql_prefetch, self->event) == -1) {
+        pthread_mutex_lock(&prefetch->lock);
+        prefetch->is_running = 0;
+        pthread_mutex_unlock(&prefetch->lock);
+
+        PyErr_Format(PyExc_Exception, "(%s) The worker pool can't accept the task", __FUNCTION__);
+        return -1;
+    }
+    #endif
+
+    return 0;
+}
+
+
+/*
+    Waits for the filler to finish its current batch and releases the prefetched batches
+*/
+void stop_prefetch(Cursor *self)
+{
+    PRINT_DEBUG_MESSAGE(__FUNCTION__);
+
+    prefetch_info *prefetch = self->prefetch;
+    if (prefetch == NULL) {
+        return;
+    }
+
+    #ifdef __linux__
+    Py_BEGIN_ALLOW_THREADS
+    pthread_mutex_lock(&prefetch->lock);
+    prefetch->is_stopped = 1;
+    while (prefetch->is_running) {
+        pthread_cond_wait(&prefetch->idle, &prefetch->lock);
+    }
+    pthread_mutex_unlock(&prefetch->lock);
+    Py_END_ALLOW_THREADS
+    #endif
+
+    self->prefetch = NULL;
+    free_prefetch(self, prefetch);
+    close_event(&self->event, &self->event_status);
+}
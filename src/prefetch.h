@@ -0,0 +1,23 @@
+#ifndef _PREFETCH_H_
+#define _PREFETCH_H_
+
+
+#include "aodbc_types.h"
+
+
+prefetch_info* create_prefetch(size_t size, size_t depth);
+void free_prefetch(Cursor *self, prefetch_info *prefetch);
+row_batch* pop_batch(Cursor *self, int *is_end);
+int fill_batches(Cursor *self);
+void stop_prefetch(Cursor *self);
+
+#ifdef __linux__
+void* t_sql_prefetch(void *handle);
+#endif
+
+extern row_batch* create_batch(size_t limit);
+extern int fetch_rows(Cursor *self, row_batch *batch);
+extern void free_batch(Cursor *self, row_batch *batch);
+
+
+#endif
@@ -1,10 +1,22 @@
 import datetime
-from typing import Tuple, List, Union, Optional
+from typing import Tuple, List, Union, Optional, AsyncIterator, Sequence, Dict, Any, Mapping, IO, Iterator
+
+
+# the values, which are sent by parts at the execution
+Stream = Union[bytes, bytearray, memoryview, IO[Any], Iterator[Union[bytes, str]], AsyncIterator[bytes]]
+
+
+# the statuses of the rows of executemany
+PARAM_SUCCESS: int
+PARAM_SUCCESS_WITH_INFO: int
+PARAM_ERROR: int
+PARAM_UNUSED: int
+PARAM_DIAG_UNAVAILABLE: int
 
 
 class Cursor:
     """
-    Cursor class
+    Cursor class, it's created by Connection.cursor
     """
     pass
 
@@ -26,16 +38,78 @@ class Cursor:
     async def execute(
         self,
         query: str,
-        params: Optional[
-            Tuple[Union[None, int, bool, float, str, datetime.datetime, datetime.date, datetime.time]]
-        ] = None,
-        timeout: int = 0
+        params: Optional[Union[
+            Tuple[Union[None, int, bool, float, str, datetime.datetime, datetime.date, datetime.time, Stream]],
+            Mapping[str, Union[None, int, bool, float, str, datetime.datetime, datetime.date, datetime.time, Stream]]
+        ]] = None,
+        timeout: float = 0
     ) -> Cursor:
         """
-        Asynchronous execute the sql query
+        Asynchronous execute the sql query. If all slots of the connection are busy (max concurrent activities),
+        it waits for a slot in FIFO order
         :param query: query-string
-        :param params: parameters to pass to the sql query
-        :param timeout: query timeout: 0 - infinite, 2147483647 - max. Default 0
+        :param params: parameters to pass to the sql query, a tuple for "?" or a dict for ":name" and "%(name)s".
+            The bytes up to 64 KB are bound without copying. The strings longer than 32768 characters, the larger bytes,
+            the files and the iterators are sent by parts
+        :param timeout: query timeout in seconds with millisecond resolution: 0 - infinite, 2147483647 - max.
+            The statement is canceled by SQLCancel on expiry and TimeoutError is raised. Default 0
+        :return: Cursor
+        """
+        pass
+
+    async def executemany(
+        self,
+        query: str,
+        seq_of_params: Sequence[Union[
+            Tuple[Union[
+                None, int, bool, float, str, datetime.datetime, datetime.date, datetime.time, bytes, bytearray
+            ], ...],
+            Mapping[str, Union[
+                None, int, bool, float, str, datetime.datetime, datetime.date, datetime.time, bytes, bytearray
+            ]]
+        ]],
+        batch_size: int = 1000,
+        timeout: float = 0
+    ) -> List[int]:
+        """
+        Asynchronous execute the sql query for each tuple of the parameters. The parameters of batch_size rows
+        are bound by column and executed by one SQLExecute, the results of the query aren't returned
+        :param query: query-string
+        :param seq_of_params: the tuples (or the dicts for the named markers) of parameters, the values of a parameter
+            have one type or are None
+        :param batch_size: the max number of rows in a batch. Default 1000
+        :param timeout: the timeout of each batch, the same as the timeout of execute
+        :return: the statuses of the rows: PARAM_SUCCESS, PARAM_SUCCESS_WITH_INFO, PARAM_ERROR, PARAM_UNUSED
+            or PARAM_DIAG_UNAVAILABLE
+        """
+        pass
+
+    async def insert_columns(
+        self,
+        query: str,
+        columns: Dict[str, Any],
+        batch_size: int = 1000,
+        timeout: float = 0
+    ) -> List[int]:
+        """
+        Asynchronous execute the sql query for the rows of the columns, the columns are bound as the parameters
+        in the order of the dict (or by the names of the named markers) without the Python objects per value
+        :param query: query-string
+        :param columns: the buffers of int32, int64, float32, float64, bool, fixed width UTF-8 or UCS-4 strings,
+            or the dicts {'values': buffer, 'validity': buffer} and {'offsets': buffer, 'data': bytes, 'validity': buffer},
+            the validity has a byte per row, zero is NULL
+        :param batch_size: the max number of rows in a batch. Default 1000
+        :param timeout: the timeout of each batch, the same as the timeout of execute
+        :return: the statuses of the rows, the same as executemany returns
+        """
+        pass
+
+    async def prepare(self, query: str, timeout: float = 0) -> Cursor:
+        """
+        Asynchronous prepare the sql query by SQLPrepareW without its execution, the next execute
+        of the same query only binds the parameters and calls SQLExecute
+        :param query: query-string
+        :param timeout: the same as the timeout of execute
         :return: Cursor
         """
         pass
@@ -47,9 +121,78 @@ class Cursor:
         """
         pass
 
+    def fetchmany(self, size: int) -> List[dict]:
+        """
+        Getting the next rows of query results
+        :param size: the max number of rows
+        :return: results, an empty list if there aren't more rows
+        """
+        pass
+
+    async def fetchall_async(self) -> List[dict]:
+        """
+        Asynchronous getting query results, the rows are read by a worker (Linux only, on Windows it's synchronous)
+        :return: results
+        """
+        pass
+
+    async def fetchmany_async(self, size: int) -> List[dict]:
+        """
+        Asynchronous getting the next rows of query results
+        :param size: the max number of rows
+        :return: results, an empty list if there aren't more rows
+        """
+        pass
+
+    def prefetch(self, size: int, depth: int = 2) -> AsyncIterator[List[dict]]:
+        """
+        Streaming of query results: a worker fills the next batches while the current one is processed
+        (Linux only, on Windows a batch is fetched on demand).
+        Breaking the iteration and closing the cursor stops the prefetching
+        :param size: the max number of rows in a batch
+        :param depth: the max number of the filled batches waiting for processing. Default 2
+        :return: the cursor as an asynchronous iterator of batches
+        """
+        pass
+
+    def nextset(self) -> bool:
+        """
+        Go to the next result set by SQLMoreResults, the rest rows of the current one are discarded
+        :return: False if there aren't more result sets
+        """
+        pass
+
+    async def nextset_async(self) -> bool:
+        """
+        Asynchronous going to the next result set, SQLMoreResults is called by a worker
+        (Linux only, on Windows it's synchronous)
+        :return: False if there aren't more result sets
+        """
+        pass
+
+    async def fetch_all_sets(self) -> List[Union[List[dict], int]]:
+        """
+        Asynchronous getting all result sets of the executed batch starting from the current one
+        :return: the rows of each result set or the row count of a statement without a result set
+        """
+        pass
+
+    @property
+    def rowcount(self) -> int:
+        """
+        The number of rows affected by the statement of the current result, -1 if it's unknown
+        """
+        pass
+
+    def __aiter__(self) -> Cursor:
+        pass
+
+    async def __anext__(self) -> List[dict]:
+        pass
+
     def close(self) -> None:
         """
-        Close this cursor
+        Close this cursor, an executing statement is canceled
         :return: None
         """
         pass
@@ -57,7 +200,7 @@ class Cursor:
 
 class Connection:
     """
-    Connection class
+    Connection class, it's created by connect
     """
     def __iter__(self) -> Connection:
         pass
@@ -81,6 +224,46 @@ class Connection:
         """
         pass
 
+    def configure_statement_cache(self, size: int) -> None:
+        """
+        Set the size of the LRU cache of prepared statements, the least recently used statements above it are freed
+        :param size: the max number of the cached statements, 0 - the cache is disabled. Default 0
+        """
+        pass
+
+    def statement_cache_stats(self) -> dict:
+        """
+        Counters of the prepared statement cache
+        :return: {'size': int, 'max_size': int, 'hits': int, 'misses': int, 'evictions': int}
+        """
+        pass
+
+    def configure_batching(self, max_size: int, window: float = 0) -> None:
+        """
+        Set the batching of the queries of fetchall, the waiting queries are sent at once
+        :param max_size: the max number of the queries of a batch, 0 - each query is executed at once. Default 0
+        :param window: the time in seconds to wait for the other queries, 0 - till the next iteration of the loop
+        """
+        pass
+
+    async def fetchall(
+        self,
+        query: str,
+        params: Optional[Union[
+            Tuple[Union[None, int, bool, float, str, datetime.datetime, datetime.date, datetime.time, Stream]],
+            Mapping[str, Union[None, int, bool, float, str, datetime.datetime, datetime.date, datetime.time, Stream]]
+        ]] = None,
+        timeout: float = 0
+    ) -> List[dict]:
+        """
+        Asynchronous execute the sql query in a batch with the other waiting queries and get its results
+        :param query: query-string, it must return one result set
+        :param params: parameters to pass to the sql query, a tuple for "?" or a dict for ":name" and "%(name)s"
+        :param timeout: query timeout in seconds like in Cursor.execute. Default 0
+        :return: results
+        """
+        pass
+
     async def close(self) -> Connection:
         """
         Asynchronous close this connection
@@ -89,14 +272,195 @@ class Connection:
         pass
 
 
-async def connect(dsn: str, timeout: int = 0) -> Connection:
+class PoolRequest:
+    """
+    The awaitable of ConnectionPool.acquire, execute and fetchall
+    """
+    def __await__(self) -> Union[Connection, List[dict], None]:
+        pass
+
+    async def __aenter__(self) -> Connection:
+        pass
+
+    async def __aexit__(self, exc_type, exc_val, exc_tb) -> None:
+        """
+        Release the acquired connection
+        """
+        pass
+
+
+class ConnectionPool:
+    """
+    ConnectionPool class, it's created by create_pool
+    """
+    def __await__(self) -> ConnectionPool:
+        pass
+
+    async def __aenter__(self) -> ConnectionPool:
+        pass
+
+    async def __aexit__(self, exc_type, exc_val, exc_tb) -> None:
+        pass
+
+    def acquire(self) -> PoolRequest:
+        """
+        Acquire an idle connection, which is alive. A new connection is opened, if there isn't an idle one
+        and the pool has less than max_size connections, otherwise the task waits for a released connection
+        :return: the awaitable of the connection, as an asynchronous context manager it releases the connection
+        """
+        pass
+
+    def release(self, conn: Connection) -> None:
+        """
+        Release the connection acquired by await acquire(). A closed, dead or expired connection
+        and a connection with the pending results of a cursor are closed instead of the reuse
+        :param conn: the acquired connection
+        :return: None
+        """
+        pass
+
+    async def execute(
+        self,
+        query: str,
+        params: Optional[Union[
+            Tuple[Union[None, int, bool, float, str, datetime.datetime, datetime.date, datetime.time, Stream]],
+            Mapping[str, Union[None, int, bool, float, str, datetime.datetime, datetime.date, datetime.time, Stream]]
+        ]] = None,
+        timeout: float = 0
+    ) -> None:
+        """
+        Asynchronous execute the sql query on an acquired connection, which is released after it
+        :param query: query-string
+        :param params: parameters to pass to the sql query, a tuple for "?" or a dict for ":name" and "%(name)s"
+        :param timeout: query timeout in seconds like in Cursor.execute. Default 0
+        :return: None
+        """
+        pass
+
+    async def fetchall(
+        self,
+        query: str,
+        params: Optional[Union[
+            Tuple[Union[None, int, bool, float, str, datetime.datetime, datetime.date, datetime.time, Stream]],
+            Mapping[str, Union[None, int, bool, float, str, datetime.datetime, datetime.date, datetime.time, Stream]]
+        ]] = None,
+        timeout: float = 0
+    ) -> List[dict]:
+        """
+        Asynchronous execute the sql query and fetchall_async on an acquired connection, which is released after it
+        :param query: query-string
+        :param params: parameters to pass to the sql query, a tuple for "?" or a dict for ":name" and "%(name)s"
+        :param timeout: query timeout in seconds like in Cursor.execute. Default 0
+        :return: results
+        """
+        pass
+
+    def stats(self) -> dict:
+        """
+        Statistics of the pool
+        :return: {'size': int, 'idle': int, 'waiting': int, 'min_size': int, 'max_size': int}, where size counts
+            the idle, acquired and connecting connections and waiting is the number of tasks waiting for a connection
+        """
+        pass
+
+    async def close(self) -> None:
+        """
+        Asynchronous close the idle connections, the acquired ones are closed on the release.
+        The waiting tasks get an exception
+        :return: None
+        """
+        pass
+
+
+async def connect(dsn: str, timeout: float = 0, polling: bool = False) -> Connection:
     """
     Asynchronous create a connection to a server
     :param dsn: connection string
-    :param timeout: login timeout: 0 - infinite, 2147483647 - max. Default 0
+    :param timeout: login timeout in seconds: 0 - infinite, 2147483647 - max.
+        TimeoutError is raised, if the connection fails after the timeout. Default 0
+    :param polling: execute the statements in the asynchronous mode of the driver by one poller thread (Linux only),
+        the worker pool is used, if the driver doesn't support it. Default False
     :return: Connection
     """
     pass
 
 
+async def create_pool(
+    dsn: str,
+    min_size: int = 1,
+    max_size: int = 10,
+    timeout: float = 0,
+    polling: bool = False,
+    idle_timeout: float = 0,
+    max_lifetime: float = 0
+) -> ConnectionPool:
+    """
+    Asynchronous create a pool of connections to a server, min_size connections are opened in parallel
+    :param dsn: connection string
+    :param min_size: the number of the connections opened by create_pool, the idle ones aren't closed below it. Default 1
+    :param max_size: the max number of the connections. Default 10
+    :param timeout: login timeout of a connection in seconds like in connect. Default 0
+    :param polling: the polling mode of the connections like in connect. Default False
+    :param idle_timeout: an idle connection above min_size is closed after it, in seconds: 0 - infinite.
+        It's checked on acquire and release. Default 0
+    :param max_lifetime: a connection is closed after it, when it's idle, in seconds: 0 - infinite. Default 0
+    :return: ConnectionPool
+    """
+    pass
+
+
+async def connect_many(
+    dsn: str,
+    n: int,
+    timeout: float = 0,
+    polling: bool = False,
+    quorum: int = 0
+) -> List[Union[Connection, Exception]]:
+    """
+    Asynchronous create n connections to a server in parallel
+    :param dsn: connection string
+    :param n: the number of the connections
+    :param timeout: login timeout of a connection in seconds like in connect. Default 0
+    :param polling: the polling mode of the connections like in connect. Default False
+    :param quorum: it returns, when quorum connections are opened: 0 - all of them. The ones still connecting
+        finish the login, when they're awaited. Default 0
+    :return: a connection or the exception of its login per place
+    """
+    pass
+
+
+def configure_pool(threads: int = 32, stack_size: int = 0, queue_size: int = 4096) -> None:
+    """
+    Configure the worker pool, which runs the blocking ODBC calls (Linux only).
+    Each interpreter has its own pool. It must be called before the first connection,
+    because the pool is started lazily and then its size is fixed
+    :param threads: the number of worker threads. Default 32
+    :param stack_size: the stack size of a worker thread in bytes: 0 - the system default. Default 0
+    :param queue_size: the max number of tasks waiting for a free worker. Default 4096
+    :return: None
+    """
+    pass
+
+
+def configure_environment(pooling: bool = False, strict_match: bool = True) -> None:
+    """
+    Configure the ODBC environment shared by the connections of the interpreter.
+    It must be called before the first connection, which allocates the environment
+    :param pooling: enable the connection pooling of the driver manager (SQL_CP_ONE_PER_HENV). Default False
+    :param strict_match: SQL_CP_STRICT_MATCH if True, otherwise SQL_CP_RELAXED_MATCH. Default True
+    :return: None
+    """
+    pass
+
+
+def pool_stats() -> dict:
+    """
+    Statistics of the worker pool (Linux only)
+    :return: {'threads': int, 'stack_size': int, 'queue_size': int, 'depth': int, 'active': int, 'started': bool,
+        'polled': int}, where depth is the number of queued tasks, active is the number of busy workers
+        and polled is the number of statements executed by the poller
+    """
+    pass
+
+
 _rate: float = 1.0
@@ -0,0 +1,355 @@
+#include "query_parser.h"
+
+
+static int is_name_start(wchar_t ch)
+{
+    return ch == '_' || (ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z');
+}
+
+
+static int is_name_char(wchar_t ch)
+{
+    return is_name_start(ch) || (ch >= '0' && ch <= '9');
+}
+
+
+/*
+    The end of the literal, the quoted identifier or the comment, which starts at the position
+*/
+static Py_ssize_t skip_quoted(const wchar_t *query, Py_ssize_t length, Py_ssize_t i)
+{
+    wchar_t ch = query[i];
+
+    if (ch == '\'' || ch == '"' || ch == '[') {
+        // the closing character is escaped by doubling
+        wchar_t end = ch == '[' ? ']' : ch;
+        for (i++; i < length; i++) {
+            if (query[i] == end) {
+                if (i + 1 < length && query[i + 1] == end) {
+                    i++;
+                    continue;
+                }
+                return i + 1;
+            }
+        }
+        return length;
+    }
+
+    if (ch == '-' && i + 1 < length && query[i + 1] == '-') {
+        while (i < length && query[i] != '\n') {
+            i++;
+        }
+        return i;
+    }
+
+    if (ch == '/' && i + 1 < length && query[i + 1] == '*') {
+        // the block comments of T-SQL are nested
+        int depth = 0;
+        while (i < length) {
+            if (query[i] == '/' && i + 1 < length && query[i + 1] == '*') {
+                depth++;
+                i += 2;
+            } else if (query[i] == '*' && i + 1 < length && query[i + 1] == '/') {
+                i += 2;
+                if (--depth == 0) {
+                    return i;
+                }
+            } else {
+                i++;
+            }
+        }
+        return length;
+    }
+
+    return -1;
+}
+
+
+/*
+    The length of the name of the marker :name or %(name)s at the position, 0 - it isn't a named marker
+*/
+static Py_ssize_t get_named_marker(
+    const wchar_t *query, Py_ssize_t length, Py_ssize_t i, Py_ssize_t *name_start, Py_ssize_t *name_length
+)
+{
+    Py_ssize_t end = i + 1;
+
+    if (query[i] == ':') {
+        // "::" is the scope qualifier, a ":" after a name isn't a marker
+        if (i > 0 && (query[i - 1] == ':' || is_name_char(query[i - 1]))) {
+            return 0;
+        }
+        if (end >= length || !is_name_start(query[end])) {
+            return 0;
+        }
+        while (end < length && is_name_char(query[end])) {
+            end++;
+        }
+        *name_start = i + 1;
+        *name_length = end - i - 1;
+        return end - i;
+    }
+
+    if (query[i] == '%' && end < length && query[end] == '(') {
+        end++;
+        while (end < length && is_name_char(query[end])) {
+            end++;
+        }
+        if (end == i + 2 || end + 1 >= length || query[end] != ')' || query[end + 1] != 's') {
+            return 0;
+        }
+        *name_start = i + 2;
+        *name_length = end - i - 2;
+        return end + 2 - i;
+    }
+
+    return 0;
+}
+
+
+/*
+    Finds the markers outside of the literals, the quoted identifiers and the comments.
+    The named markers are replaced by "?", their names are kept in the order of the markers
+*/
+static parsed_query* tokenize_query(const wchar_t *query, Py_ssize_t length)
+{
+    PRINT_DEBUG_MESSAGE(__FUNCTION__);
+
+    Py_ssize_t positional_count = 0;
+    PyObject *names = NULL;
+
+    parsed_query *parsed = PyMem_Calloc(1, sizeof(parsed_query));
+    if (parsed == NULL) {
+        PyErr_NoMemory();
+        return NULL;
+    }
+
+    // the markers aren't longer than their replacements
+    parsed->query = PyMem_Malloc((length + 1) * sizeof(wchar_t));
+    if (parsed->query == NULL) {
+        PyErr_NoMemory();
+        goto clean_up;
+    }
+
+    names = PyList_New(0);
+    if (names == NULL) {
+        goto clean_up;
+    }
+
+    Py_ssize_t out = 0;
+    for (Py_ssize_t i = 0; i < length;) {
+        Py_ssize_t end = skip_quoted(query, length, i);
+        if (end != -1) {
+            memcpy(&parsed->query[out], &query[i], (end - i) * sizeof(wchar_t));
+            out += end - i;
+            i = end;
+            continue;
+        }
+
+        Py_ssize_t name_start, name_length;
+        Py_ssize_t marker_length = get_named_marker(query, length, i, &name_start, &name_length);
+        if (marker_length) {
+            PyObject *name = PyUnicode_FromWideChar(&query[name_start], name_length);
+            if (name == NULL || PyList_Append(names, name) == -1) {
+                Py_XDECREF(name);
+                goto clean_up;
+            }
+            Py_DECREF(name);
+            parsed->query[out++] = '?';
+            i += marker_length;
+            continue;
+        }
+
+        if (query[i] == '?') {
+            positional_count++;
+        }
+        parsed->query[out++] = query[i++];
+    }
+    parsed->query[out] = 0;
+    parsed->length = out;
+
+    Py_ssize_t named_count = PyList_GET_SIZE(names);
+    if (positional_count && named_count) {
+        PyErr_Format(PyExc_TypeError, "(%s) The query has the positional and the named parameters", __FUNCTION__);
+        goto clean_up;
+    }
+
+    if (named_count) {
+        parsed->names = PyList_AsTuple(names);
+        if (parsed->names == NULL) {
+            goto clean_up;
+        }
+    }
+    parsed->parameter_count = positional_count + named_count;
+
+    Py_DECREF(names);
+    return parsed;
+
+    clean_up:
+        Py_XDECREF(names);
+        PyMem_Free(parsed->query);
+        PyMem_Free(parsed);
+        return NULL;
+}
+
+
+static void free_parsed_query(PyObject *capsule)
+{
+    parsed_query *parsed = (parsed_query *)PyCapsule_GetPointer(capsule, NULL);
+
+    Py_XDECREF(parsed->names);
+    PyMem_Free(parsed->query);
+    PyMem_Free(parsed);
+}
+
+
+/*
+    Returns the capsule of the parsed query. The queries are cached by the connection, the string of a repeated
+    query is found by its cached hash, so it isn't scanned again. The capsule is kept by the caller,
+    because the cache can be cleared by another query
+*/
+PyObject* parse_query(Connection *conn, PyObject *py_query)
+{
+    PRINT_DEBUG_MESSAGE(__FUNCTION__);
+
+    // the subclasses of str can compare differently
+    int is_cached = PyUnicode_CheckExact(py_query);
+
+    if (is_cached && conn->parsed_queries != NULL) {
+        PyObject *capsule = PyDict_GetItemWithError(conn->parsed_queries, py_query);
+        if (capsule != NULL) {
+            Py_INCREF(capsule);
+            return capsule;
+        }
+        if (PyErr_Occurred()) {
+            return NULL;
+        }
+    }
+
+    Py_ssize_t length;
+    wchar_t *query = PyUnicode_AsWideCharString(py_query, &length);
+    if (query == NULL) {
+        return NULL;
+    }
+
+    parsed_query *parsed = tokenize_query(query, length);
+    PyMem_Free(query);
+    if (parsed == NULL) {
+        return NULL;
+    }
+
+    PyObject *capsule = PyCapsule_New(parsed, NULL, free_parsed_query);
+    if (capsule == NULL) {
+        Py_XDECREF(parsed->names);
+        PyMem_Free(parsed->query);
+        PyMem_Free(parsed);
+        return NULL;
+    }
+
+    if (!is_cached) {
+        return capsule;
+    }
+
+    if (conn->parsed_queries == NULL) {
+        conn->parsed_queries = PyDict_New();
+    } else if (PyDict_GET_SIZE(conn->parsed_queries) >= PARSED_QUERIES_SIZE) {
+        PyDict_Clear(conn->parsed_queries);  // e.g. the queries with the inlined values
+    }
+
+    if (conn->parsed_queries == NULL || PyDict_SetItem(conn->parsed_queries, py_query, capsule) == -1) {
+        Py_DECREF(capsule);
+        return NULL;
+    }
+
+    return capsule;
+}
+
+
+parsed_query* get_parsed_query(PyObject *parsed)
+{
+    return (parsed_query *)PyCapsule_GetPointer(parsed, NULL);
+}
+
+
+/*
+    The copy of the query is taken by the execution
+*/
+const wchar_t* copy_parsed_query(parsed_query *parsed)
+{
+    size_t size = (parsed->length + 1) * sizeof(wchar_t);
+    wchar_t *query = PyMem_Malloc(size);
+    if (query == NULL) {
+        PyErr_NoMemory();
+        return NULL;
+    }
+
+    memcpy(query, parsed->query, size);
+    return query;
+}
+
+
+int check_parameters_equality(parsed_query *parsed, Py_ssize_t params_length)
+{
+    PRINT_DEBUG_MESSAGE(__FUNCTION__);
+
+    if (parsed->parameter_count != params_length) {
+        PyErr_Format(
+            PyExc_TypeError,
+            "(%s) The query takes %lld arguments, but %lld were given",
+            __FUNCTION__, (long long)parsed->parameter_count, (long long)params_length
+        );
+        return -1;
+    }
+
+    return 0;
+}
+
+
+/*
+    Returns the tuple of the params in the order of the markers or None without them.
+    The params of the named markers are taken from the mapping by their names
+*/
+PyObject* order_parameters(parsed_query *parsed, PyObject *params, const char *fn_name)
+{
+    PRINT_DEBUG_MESSAGE(__FUNCTION__);
+
+    if (parsed->names == NULL || params == Py_None) {
+        if (params != Py_None && !PyTuple_Check(params)) {
+            PyErr_Format(PyExc_TypeError, "(%s) Params must be in a tuple", fn_name);
+            return NULL;
+        }
+
+        if (check_parameters_equality(parsed, params == Py_None ? 0 : PyTuple_GET_SIZE(params)) == -1) {
+            return NULL;
+        }
+
+        Py_INCREF(params);
+        return params;
+    }
+
+    if (!PyMapping_Check(params) || PyTuple_Check(params) || PyList_Check(params)) {
+        PyErr_Format(PyExc_TypeError, "(%s) The query has the named parameters, Params must be in a dict", fn_name);
+        return NULL;
+    }
+
+    PyObject *ordered = PyTuple_New(parsed->parameter_count);
+    if (ordered == NULL) {
+        return NULL;
+    }
+
+    for (Py_ssize_t i = 0; i < parsed->parameter_count; i++) {
+        PyObject *name = PyTuple_GET_ITEM(parsed->names, i);
+        PyObject *param = PyObject_GetItem(params, name);
+        if (param == NULL) {
+            if (PyErr_ExceptionMatches(PyExc_KeyError)) {
+                PyErr_Clear();
+                PyErr_Format(PyExc_TypeError, "(%s) The parameter %R isn't given", fn_name, name);
+            }
+            Py_DECREF(ordered);
+            return NULL;
+        }
+        PyTuple_SET_ITEM(ordered, i, param);
+    }
+
+    return ordered;
+}
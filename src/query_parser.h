@@ -0,0 +1,15 @@
+#ifndef _QUERY_PARSER_H_
+#define _QUERY_PARSER_H_
+
+
+#include "aodbc_types.h"
+
+
+PyObject* parse_query(Connection *conn, PyObject *py_query);
+parsed_query* get_parsed_query(PyObject *parsed);
+const wchar_t* copy_parsed_query(parsed_query *parsed);
+int check_parameters_equality(parsed_query *parsed, Py_ssize_t params_length);
+PyObject* order_parameters(parsed_query *parsed, PyObject *params, const char *fn_name);
+
+
+#endif
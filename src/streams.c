@@ -0,0 +1,394 @@
+#include "streams.h"
+
+
+// begin static declarations
+static int set_chunk(parameter_stream *stream, PyObject *chunk);
+static void release_chunk(parameter_stream *stream);
+static PyObject* take_returned_value(void);
+// end static declarations
+
+
+static int is_awaitable(PyObject *object)
+{
+    return Py_TYPE(object)->tp_as_async != NULL && Py_TYPE(object)->tp_as_async->am_await != NULL;
+}
+
+
+static int is_async_iterator(PyObject *object)
+{
+    return Py_TYPE(object)->tp_as_async != NULL && Py_TYPE(object)->tp_as_async->am_anext != NULL;
+}
+
+
+/*
+    The values, which are sent at the execution: a long string, an object with the buffer protocol,
+    a file (with the synchronous or the asynchronous read) and an iterator (the synchronous or the asynchronous one)
+*/
+int is_stream_source(PyObject *param)
+{
+    if (PyUnicode_Check(param)) {
+        return PyUnicode_GET_LENGTH(param) > STREAM_STRING_LENGTH;
+    }
+
+    return PyObject_CheckBuffer(param) || PyObject_HasAttrString(param, "read")
+        || is_async_iterator(param) || PyIter_Check(param);
+}
+
+
+/*
+    The string and the bytes are sent from their memory. The type of a file is text if it has the encoding,
+    the type of an iterator is the type of its first item, an asynchronous iterator gives bytes
+*/
+int open_stream(PyObject *param, parameter_stream *stream)
+{
+    PRINT_DEBUG_MESSAGE(__FUNCTION__);
+
+    if (PyUnicode_Check(param)) {
+        stream->kind = STREAM_STRING;
+        stream->is_text = 1;
+        stream->is_end = 1;
+        Py_INCREF(param);
+        stream->source = param;
+        return set_chunk(stream, param);
+    }
+
+    if (PyObject_CheckBuffer(param)) {
+        stream->kind = STREAM_BUFFER;
+        stream->is_end = 1;
+        Py_INCREF(param);
+        stream->source = param;
+        return set_chunk(stream, param);
+    }
+
+    if (PyObject_HasAttrString(param, "read")) {
+        stream->kind = STREAM_READER;
+        stream->is_text = PyObject_HasAttrString(param, "encoding");
+        stream->source = PyObject_GetAttrString(param, "read");
+        return stream->source == NULL ? -1 : 0;
+    }
+
+    Py_INCREF(param);
+    stream->source = param;
+
+    if (is_async_iterator(param)) {
+        stream->kind = STREAM_ASYNC_ITERATOR;
+        return 0;
+    }
+
+    stream->kind = STREAM_ITERATOR;
+
+    // the first item is read at once, it's sent as the first chunk
+    PyObject *first = PyIter_Next(param);
+    if (first == NULL) {
+        stream->is_end = 1;
+        return PyErr_Occurred() ? -1 : 0;
+    }
+
+    stream->is_text = PyUnicode_Check(first);
+    int result = set_chunk(stream, first);
+    Py_DECREF(first);
+    return result;
+}
+
+
+static int set_chunk(parameter_stream *stream, PyObject *chunk)
+{
+    release_chunk(stream);
+    stream->offset = 0;
+
+    if (stream->is_text) {
+        if (!PyUnicode_Check(chunk)) {
+            PyErr_Format(PyExc_TypeError, "(%s) The chunks of a text stream must be strings", __FUNCTION__);
+            return -1;
+        }
+
+        Py_INCREF(chunk);
+        stream->chunk = chunk;
+        return 0;
+    }
+
+    if (PyUnicode_Check(chunk)) {
+        PyErr_Format(
+            PyExc_TypeError,
+            "(%s) The chunks of a binary stream must be bytes, a text file must have the encoding", __FUNCTION__
+        );
+        return -1;
+    }
+
+    // the object is locked until the execution, e.g. a bytearray can't be resized
+    return PyObject_GetBuffer(chunk, &stream->view, PyBUF_SIMPLE);
+}
+
+
+static void release_chunk(parameter_stream *stream)
+{
+    Py_CLEAR(stream->chunk);
+    if (stream->view.obj != NULL) {
+        PyBuffer_Release(&stream->view);
+    }
+}
+
+
+/*
+    The value of StopIteration, which is raised by the finished awaitable
+*/
+static PyObject* take_returned_value(void)
+{
+    PyObject *type, *value, *traceback;
+    PyErr_Fetch(&type, &value, &traceback);
+    PyErr_NormalizeException(&type, &value, &traceback);
+
+    PyObject *result = PyObject_GetAttrString(value, "value");
+
+    Py_XDECREF(type);
+    Py_XDECREF(value);
+    Py_XDECREF(traceback);
+    return result;
+}
+
+
+/*
+    Reads the next chunk of a file or an iterator on the thread of the loop. An awaitable of the reading is driven
+    by the awaitable of the cursor: its yielded values are returned with EVENT_WAIT to the task.
+    Returns EVENT_READY, if the chunk is taken or the source is exhausted
+*/
+int read_chunk(parameter_stream *stream, PyObject **waiter)
+{
+    PRINT_DEBUG_MESSAGE(__FUNCTION__);
+
+    PyObject *chunk;
+
+    if (stream->reading == NULL) {
+        switch (stream->kind) {
+            case STREAM_READER:
+                chunk = PyObject_CallFunction(
+                    stream->source, "n", (Py_ssize_t)(stream->is_text ? STREAM_CHUNK_SIZE / sizeof(SQLWCHAR) : STREAM_CHUNK_SIZE)
+                );
+                break;
+            case STREAM_ITERATOR:
+                chunk = PyIter_Next(stream->source);
+                if (chunk == NULL && !PyErr_Occurred()) {
+                    release_chunk(stream);
+                    stream->is_end = 1;
+                    return EVENT_READY;
+                }
+                break;
+            default:
+                chunk = Py_TYPE(stream->source)->tp_as_async->am_anext(stream->source);
+        }
+
+        if (chunk == NULL) {
+            return -1;
+        }
+
+        if (is_awaitable(chunk)) {
+            stream->reading = Py_TYPE(chunk)->tp_as_async->am_await(chunk);
+            Py_DECREF(chunk);
+            if (stream->reading == NULL) {
+                return -1;
+            }
+            if (!PyIter_Check(stream->reading)) {
+                Py_CLEAR(stream->reading);
+                PyErr_Format(PyExc_TypeError, "(%s) __await__ of the reading didn't return an iterator", __FUNCTION__);
+                return -1;
+            }
+        }
+    }
+
+    if (stream->reading != NULL) {
+        PyObject *yielded = Py_TYPE(stream->reading)->tp_iternext(stream->reading);
+        if (yielded != NULL) {
+            *waiter = yielded;
+            return EVENT_WAIT;
+        }
+
+        Py_CLEAR(stream->reading);
+        if (!PyErr_Occurred()) {
+            Py_INCREF(Py_None);
+            chunk = Py_None;
+        } else if (PyErr_ExceptionMatches(PyExc_StopIteration)) {
+            chunk = take_returned_value();
+            if (chunk == NULL) {
+                return -1;
+            }
+        } else if (stream->kind == STREAM_ASYNC_ITERATOR && PyErr_ExceptionMatches(PyExc_StopAsyncIteration)) {
+            PyErr_Clear();
+            release_chunk(stream);
+            stream->is_end = 1;
+            return EVENT_READY;
+        } else {
+            return -1;
+        }
+    }
+
+    // an empty read is the end of a file
+    if (stream->kind == STREAM_READER) {
+        Py_ssize_t length = chunk == Py_None ? 0 : PyObject_Size(chunk);
+        if (length == -1) {
+            PyErr_Clear();  // the type of the chunk is checked by set_chunk
+        }
+
+        if (length == 0) {
+            Py_DECREF(chunk);
+            release_chunk(stream);
+            stream->is_end = 1;
+            return EVENT_READY;
+        }
+    }
+
+    int result = set_chunk(stream, chunk);
+    Py_DECREF(chunk);
+    return result == -1 ? -1 : EVENT_READY;
+}
+
+
+/*
+    Writes up to units UTF-16 units of the string from the offset, a surrogate pair isn't split
+*/
+static SQLLEN copy_utf16_part(PyObject *string, Py_ssize_t *offset, SQLWCHAR *buffer, SQLLEN units)
+{
+    Py_ssize_t string_length = PyUnicode_GET_LENGTH(string);
+    Py_ssize_t i = *offset;
+    SQLLEN length = 0;
+
+    if (PyUnicode_KIND(string) == PyUnicode_1BYTE_KIND) {
+        const Py_UCS1 *data = PyUnicode_1BYTE_DATA(string);
+        for (; i < string_length && length < units; i++) {
+            buffer[length++] = (SQLWCHAR)data[i];
+        }
+    } else {
+        const Py_UCS4 *data = PyUnicode_4BYTE_DATA(string);
+        for (; i < string_length && length + 2 <= units; i++) {
+            Py_UCS4 ch = data[i];
+            if (ch > 0xFFFF) {
+                ch -= 0x10000;
+                buffer[length++] = (SQLWCHAR)(0xD800 + (ch >> 10));
+                buffer[length++] = (SQLWCHAR)(0xDC00 + (ch & 0x3FF));
+            } else {
+                buffer[length++] = (SQLWCHAR)ch;
+            }
+        }
+    }
+
+    *offset = i;
+    return length;
+}
+
+
+/*
+    Sends the rest of the current chunk by the pieces of STREAM_CHUNK_SIZE bytes.
+    UCS-2 is sent from the string, the other strings are written into the buffer of the chunk
+*/
+static int put_chunk(Cursor *self, parameter_stream *stream)
+{
+    SQLPOINTER data;
+    SQLLEN size;
+
+    if (stream->chunk != NULL) {
+        PyObject *string = stream->chunk;
+        Py_ssize_t string_length = PyUnicode_GET_LENGTH(string);
+        SQLLEN units = STREAM_CHUNK_SIZE / sizeof(SQLWCHAR);
+
+        while (stream->offset < string_length) {
+            if (PyUnicode_KIND(string) == PyUnicode_2BYTE_KIND) {
+                SQLLEN length = string_length - stream->offset < units ? string_length - stream->offset : units;
+                data = (SQLWCHAR *)PyUnicode_2BYTE_DATA(string) + stream->offset;
+                size = length * sizeof(SQLWCHAR);
+                stream->offset += length;
+            } else {
+                data = self->p_info.chunk;
+                size = copy_utf16_part(string, &stream->offset, self->p_info.chunk, units) * sizeof(SQLWCHAR);
+            }
+
+            self->retcode = SQLPutData(self->handle, data, size);
+            if (!SQL_SUCCEEDED(self->retcode)) {
+                return -1;
+            }
+            stream->is_put = 1;
+        }
+    } else if (stream->view.obj != NULL) {
+        while (stream->offset < stream->view.len) {
+            size = stream->view.len - stream->offset < STREAM_CHUNK_SIZE ? stream->view.len - stream->offset : STREAM_CHUNK_SIZE;
+            data = (char *)stream->view.buf + stream->offset;
+
+            self->retcode = SQLPutData(self->handle, data, size);
+            if (!SQL_SUCCEEDED(self->retcode)) {
+                return -1;
+            }
+            stream->offset += size;
+            stream->is_put = 1;
+        }
+    }
+
+    return 0;
+}
+
+
+/*
+    Answers SQL_NEED_DATA of the execution: sends the values of the parameters, which SQLParamData asks for.
+    It's called by a worker without the GIL, it stops with SQL_NEED_DATA when the next chunk must be read by the loop,
+    otherwise self->retcode is the result of the execution
+*/
+void put_streams(Cursor *self)
+{
+    PRINT_DEBUG_MESSAGE(__FUNCTION__);
+
+    while (self->retcode == SQL_NEED_DATA) {
+        parameter *parameter_data = self->p_info.streamed;
+
+        if (parameter_data == NULL) {
+            SQLPOINTER token;
+            self->retcode = SQLParamData(self->handle, &token);
+            if (self->retcode != SQL_NEED_DATA) {
+                return;
+            }
+            parameter_data = (parameter *)token;
+            self->p_info.streamed = parameter_data;
+        }
+
+        parameter_stream *stream = parameter_data->stream;
+        if (put_chunk(self, stream) == -1) {
+            return;
+        }
+
+        if (!stream->is_end) {
+            self->retcode = SQL_NEED_DATA;  // the loop reads the next chunk
+            return;
+        }
+
+        if (!stream->is_put) {
+            // an empty value
+            self->retcode = SQLPutData(self->handle, (SQLPOINTER)"", 0);
+            if (!SQL_SUCCEEDED(self->retcode)) {
+                return;
+            }
+        }
+
+        self->p_info.streamed = NULL;
+        self->retcode = SQL_NEED_DATA;
+    }
+}
+
+
+void release_streams(parameters_info *p_info)
+{
+    if (!p_info->stream_count) {
+        return;
+    }
+
+    for (Py_ssize_t i = 0; i < p_info->params_length; i++) {
+        parameter_stream *stream = p_info->parameters[i].stream;
+        if (stream != NULL) {
+            release_chunk(stream);
+            Py_XDECREF(stream->reading);
+            Py_XDECREF(stream->source);
+            PyMem_Free(stream);
+            p_info->parameters[i].stream = NULL;
+        }
+    }
+
+    p_info->stream_count = 0;
+    p_info->streamed = NULL;
+    p_info->chunk = NULL;  // it's freed with the memory of the statement
+    p_info->is_putting = 0;
+}
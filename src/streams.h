@@ -0,0 +1,15 @@
+#ifndef _STREAMS_H_
+#define _STREAMS_H_
+
+
+#include "aodbc_types.h"
+
+
+int is_stream_source(PyObject *param);
+int open_stream(PyObject *param, parameter_stream *stream);
+int read_chunk(parameter_stream *stream, PyObject **waiter);
+void put_streams(Cursor *self);
+void release_streams(parameters_info *p_info);
+
+
+#endif
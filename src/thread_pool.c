@@ -0,0 +1,273 @@
+#ifdef __linux__
+
+
+#include <errno.h>
+#include <sched.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "thread_pool.h"
+
+
+static size_t round_up_power_of_two(size_t value)
+{
+    size_t result = 1;
+    while (result < value) {
+        result <<= 1;
+    }
+    return result;
+}
+
+
+static int enqueue_task(thread_pool *pool, task_routine routine, void *arg)
+{
+    task_slot *slot;
+    size_t pos = atomic_load_explicit(&pool->enqueue_pos, memory_order_relaxed);
+
+    for (;;) {
+        slot = &pool->slots[pos & pool->mask];
+        size_t sequence = atomic_load_explicit(&slot->sequence, memory_order_acquire);
+        intptr_t diff = (intptr_t)sequence - (intptr_t)pos;
+
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(
+                &pool->enqueue_pos, &pos, pos + 1, memory_order_relaxed, memory_order_relaxed
+            )) {
+                break;
+            }
+        } else if (diff < 0) {
+            return -1;  // the queue is full
+        } else {
+            pos = atomic_load_explicit(&pool->enqueue_pos, memory_order_relaxed);
+        }
+    }
+
+    slot->routine = routine;
+    slot->arg = arg;
+    atomic_store_explicit(&slot->sequence, pos + 1, memory_order_release);
+    return 0;
+}
+
+
+static int dequeue_task(thread_pool *pool, task_routine *routine, void **arg)
+{
+    task_slot *slot;
+    size_t pos = atomic_load_explicit(&pool->dequeue_pos, memory_order_relaxed);
+
+    for (;;) {
+        slot = &pool->slots[pos & pool->mask];
+        size_t sequence = atomic_load_explicit(&slot->sequence, memory_order_acquire);
+        intptr_t diff = (intptr_t)sequence - (intptr_t)(pos + 1);
+
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(
+                &pool->dequeue_pos, &pos, pos + 1, memory_order_relaxed, memory_order_relaxed
+            )) {
+                break;
+            }
+        } else if (diff < 0) {
+            return -1;  // the queue is empty or a producer hasn't published the slot yet
+        } else {
+            pos = atomic_load_explicit(&pool->dequeue_pos, memory_order_relaxed);
+        }
+    }
+
+    *routine = slot->routine;
+    *arg = slot->arg;
+    atomic_store_explicit(&slot->sequence, pos + pool->mask + 1, memory_order_release);
+    return 0;
+}
+
+
+static void* worker_main(void *handle)
+{
+    thread_pool *pool = (thread_pool *)handle;
+    task_routine routine;
+    void *arg;
+
+    for (;;) {
+        while (sem_wait(&pool->available) == -1 && errno == EINTR) {}
+
+        // every semaphore token has its task, so we only wait for the producer to publish it
+        while (dequeue_task(pool, &routine, &arg) == -1) {
+            sched_yield();
+        }
+        atomic_fetch_sub_explicit(&pool->depth, 1, memory_order_relaxed);
+
+        if (routine == NULL) {
+            break;  // a stop signal
+        }
+
+        atomic_fetch_add_explicit(&pool->active, 1, memory_order_relaxed);
+        routine(arg);
+        atomic_fetch_sub_explicit(&pool->active, 1, memory_order_relaxed);
+    }
+
+    return NULL;
+}
+
+
+int thread_pool_init(thread_pool *pool)
+{
+    pool->slots = NULL;
+    pool->mask = 0;
+    atomic_init(&pool->enqueue_pos, 0);
+    atomic_init(&pool->dequeue_pos, 0);
+    pool->threads = NULL;
+    pool->threads_count = THREAD_POOL_DEFAULT_THREADS;
+    pool->stack_size = THREAD_POOL_DEFAULT_STACK_SIZE;
+    pool->queue_size = THREAD_POOL_DEFAULT_QUEUE_SIZE;
+    atomic_init(&pool->depth, 0);
+    atomic_init(&pool->active, 0);
+    atomic_init(&pool->state, THREAD_POOL_STOPPED);
+
+    if (pthread_mutex_init(&pool->lock, NULL) != 0) {
+        return -1;
+    }
+
+    return 0;
+}
+
+
+int thread_pool_configure(thread_pool *pool, size_t threads_count, size_t stack_size, size_t queue_size)
+{
+    pthread_mutex_lock(&pool->lock);
+
+    if (atomic_load(&pool->state) != THREAD_POOL_STOPPED) {
+        pthread_mutex_unlock(&pool->lock);
+        return -1;
+    }
+
+    pool->threads_count = threads_count;
+    pool->stack_size = stack_size;
+    pool->queue_size = queue_size;
+
+    pthread_mutex_unlock(&pool->lock);
+    return 0;
+}
+
+
+static int start_pool(thread_pool *pool)
+{
+    pthread_attr_t attr;
+    size_t capacity = round_up_power_of_two(pool->queue_size + pool->threads_count);  // + stop signals
+
+    pool->slots = (task_slot *)malloc(sizeof(task_slot) * capacity);
+    if (pool->slots == NULL) {
+        return -1;
+    }
+
+    for (size_t i = 0; i < capacity; i++) {
+        atomic_init(&pool->slots[i].sequence, i);
+    }
+    pool->mask = capacity - 1;
+    atomic_store(&pool->enqueue_pos, 0);
+    atomic_store(&pool->dequeue_pos, 0);
+
+    pool->threads = (pthread_t *)malloc(sizeof(pthread_t) * pool->threads_count);
+    if (pool->threads == NULL) {
+        goto clean_up;
+    }
+
+    if (sem_init(&pool->available, 0, 0) != 0) {
+        goto clean_up;
+    }
+
+    pthread_attr_init(&attr);
+    if (pool->stack_size && pthread_attr_setstacksize(&attr, pool->stack_size) != 0) {
+        pthread_attr_destroy(&attr);
+        sem_destroy(&pool->available);
+        goto clean_up;
+    }
+
+    for (size_t i = 0; i < pool->threads_count; i++) {
+        if (pthread_create(&pool->threads[i], &attr, worker_main, pool) != 0) {
+            // stop the already started workers
+            for (size_t j = 0; j < i; j++) {
+                atomic_fetch_add(&pool->depth, 1);
+                enqueue_task(pool, NULL, NULL);
+                sem_post(&pool->available);
+            }
+            for (size_t j = 0; j < i; j++) {
+                pthread_join(pool->threads[j], NULL);
+            }
+            pthread_attr_destroy(&attr);
+            sem_destroy(&pool->available);
+            goto clean_up;
+        }
+    }
+
+    pthread_attr_destroy(&attr);
+    atomic_store(&pool->state, THREAD_POOL_RUNNING);
+    return 0;
+
+    clean_up:
+        free(pool->threads);
+        pool->threads = NULL;
+        free(pool->slots);
+        pool->slots = NULL;
+        return -1;
+}
+
+
+int thread_pool_submit(thread_pool *pool, task_routine routine, void *arg)
+{
+    if (atomic_load_explicit(&pool->state, memory_order_acquire) != THREAD_POOL_RUNNING) {
+        pthread_mutex_lock(&pool->lock);
+        if (atomic_load(&pool->state) != THREAD_POOL_RUNNING && start_pool(pool) == -1) {
+            pthread_mutex_unlock(&pool->lock);
+            return -1;
+        }
+        pthread_mutex_unlock(&pool->lock);
+    }
+
+    // the stop signals have the reserved space in the queue
+    if (atomic_load_explicit(&pool->depth, memory_order_relaxed) >= pool->queue_size) {
+        return -1;
+    }
+
+    // the counter goes first, so a worker never sees it below zero
+    atomic_fetch_add_explicit(&pool->depth, 1, memory_order_relaxed);
+    if (enqueue_task(pool, routine, arg) == -1) {
+        atomic_fetch_sub_explicit(&pool->depth, 1, memory_order_relaxed);
+        return -1;
+    }
+
+    sem_post(&pool->available);
+    return 0;
+}
+
+
+void thread_pool_stop(thread_pool *pool)
+{
+    pthread_mutex_lock(&pool->lock);
+
+    if (atomic_load(&pool->state) != THREAD_POOL_RUNNING) {
+        pthread_mutex_unlock(&pool->lock);
+        return;
+    }
+
+    for (size_t i = 0; i < pool->threads_count; i++) {
+        atomic_fetch_add(&pool->depth, 1);
+        while (enqueue_task(pool, NULL, NULL) == -1) {
+            sched_yield();
+        }
+        sem_post(&pool->available);
+    }
+
+    for (size_t i = 0; i < pool->threads_count; i++) {
+        pthread_join(pool->threads[i], NULL);
+    }
+
+    sem_destroy(&pool->available);
+    free(pool->threads);
+    pool->threads = NULL;
+    free(pool->slots);
+    pool->slots = NULL;
+    atomic_store(&pool->state, THREAD_POOL_STOPPED);
+
+    pthread_mutex_unlock(&pool->lock);
+}
+
+
+#endif
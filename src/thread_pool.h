@@ -0,0 +1,60 @@
+#ifndef _THREAD_POOL_H_
+#define _THREAD_POOL_H_
+
+
+#ifdef __linux__
+
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include <pthread.h>
+#include <semaphore.h>
+
+
+#define THREAD_POOL_DEFAULT_THREADS 32
+#define THREAD_POOL_DEFAULT_STACK_SIZE 0  // 0 - the system default
+#define THREAD_POOL_DEFAULT_QUEUE_SIZE 4096
+
+#define THREAD_POOL_STOPPED 0
+#define THREAD_POOL_RUNNING 1
+
+
+typedef void* (*task_routine)(void *arg);
+
+typedef struct task_slot {
+    atomic_size_t sequence;
+    task_routine routine;
+    void *arg;
+} task_slot;
+
+/*
+    A fixed-size pool of worker threads with a bounded lock-free MPMC submission queue
+    (Dmitry Vyukov's algorithm). Idle workers sleep on a semaphore, so they don't consume CPU.
+*/
+typedef struct thread_pool {
+    task_slot *slots;
+    size_t mask;
+    atomic_size_t enqueue_pos;
+    atomic_size_t dequeue_pos;
+    sem_t available;
+    pthread_t *threads;
+    pthread_mutex_t lock;  // only for start/stop
+    size_t threads_count;
+    size_t stack_size;
+    size_t queue_size;
+    atomic_size_t depth;
+    atomic_size_t active;
+    atomic_int state;
+} thread_pool;
+
+
+int thread_pool_init(thread_pool *pool);
+int thread_pool_configure(thread_pool *pool, size_t threads_count, size_t stack_size, size_t queue_size);
+int thread_pool_submit(thread_pool *pool, task_routine routine, void *arg);
+void thread_pool_stop(thread_pool *pool);
+
+
+#endif
+
+
+#endif
@@ -0,0 +1,269 @@
+#ifdef _WIN32
+#include <Windows.h>
+#elif __linux__
+#include <errno.h>
+#include <time.h>
+#endif
+
+#include <stddef.h>
+
+#include "timer_wheel.h"
+
+
+long long monotonic_ms(void)
+{
+    #ifdef _WIN32
+    return (long long)GetTickCount64();
+
+    #elif __linux__
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (long long)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+    #endif
+}
+
+
+void timer_entry_init(timer_entry *entry, timer_callback callback, void *arg)
+{
+    entry->prev = NULL;
+    entry->next = NULL;
+    entry->deadline = 0;
+    entry->callback = callback;
+    entry->arg = arg;
+    entry->is_scheduled = 0;
+    entry->is_fired = 0;
+    entry->is_firing = 0;
+}
+
+
+/*
+    Fires an expired entry on the calling thread, it's used without the timer wheel
+*/
+void check_timer_entry(timer_entry *entry)
+{
+    if (entry->deadline && !entry->is_fired && monotonic_ms() >= entry->deadline) {
+        entry->is_fired = 1;
+        entry->callback(entry->arg);
+    }
+}
+
+
+#ifdef __linux__
+
+
+static void unlink_entry(timer_wheel *wheel, timer_entry *entry)
+{
+    size_t slot = (size_t)((entry->deadline / TIMER_WHEEL_TICK) % TIMER_WHEEL_SLOTS);
+
+    if (entry->prev != NULL) {
+        entry->prev->next = entry->next;
+    }
+
+    if (entry->next != NULL) {
+        entry->next->prev = entry->prev;
+    }
+
+    if (wheel->slots[slot] == entry) {
+        wheel->slots[slot] = entry->next;
+    }
+
+    entry->prev = NULL;
+    entry->next = NULL;
+    entry->is_scheduled = 0;
+    wheel->count--;
+}
+
+
+/*
+    The expired entry is unlinked and marked under the lock, its callback is called after the unlocking.
+    The slot is scanned again after a callback, because the other entries could be removed meanwhile
+*/
+static void process_ticks(timer_wheel *wheel, long long now)
+{
+    long long now_tick = now / TIMER_WHEEL_TICK;
+
+    // after a long sleep every slot is visited once
+    if (now_tick - wheel->current_tick >= TIMER_WHEEL_SLOTS) {
+        wheel->current_tick = now_tick - TIMER_WHEEL_SLOTS + 1;
+    }
+
+    for (; wheel->current_tick <= now_tick; wheel->current_tick++) {
+        timer_entry *entry = wheel->slots[wheel->current_tick % TIMER_WHEEL_SLOTS];
+
+        while (entry != NULL) {
+            // the entries of the next revolutions stay in the slot
+            if (entry->deadline > now) {
+                entry = entry->next;
+                continue;
+            }
+
+            unlink_entry(wheel, entry);
+            entry->is_fired = 1;
+            entry->is_firing = 1;
+
+            pthread_mutex_unlock(&wheel->lock);
+            entry->callback(entry->arg);
+            pthread_mutex_lock(&wheel->lock);
+
+            entry->is_firing = 0;
+            pthread_cond_broadcast(&wheel->fired);
+
+            entry = wheel->slots[wheel->current_tick % TIMER_WHEEL_SLOTS];
+        }
+    }
+}
+
+
+static void* timer_main(void *handle)
+{
+    timer_wheel *wheel = (timer_wheel *)handle;
+    struct timespec wake_time;
+
+    pthread_mutex_lock(&wheel->lock);
+
+    while (wheel->state == TIMER_WHEEL_RUNNING) {
+        if (!wheel->count) {
+            pthread_cond_wait(&wheel->wakeup, &wheel->lock);
+            continue;
+        }
+
+        process_ticks(wheel, monotonic_ms());
+
+        long long wake_ms = wheel->current_tick * TIMER_WHEEL_TICK;
+        wake_time.tv_sec = (time_t)(wake_ms / 1000);
+        wake_time.tv_nsec = (long)(wake_ms % 1000) * 1000000;
+        pthread_cond_timedwait(&wheel->wakeup, &wheel->lock, &wake_time);
+    }
+
+    pthread_mutex_unlock(&wheel->lock);
+    return NULL;
+}
+
+
+/*
+    It's called under the lock, only the callback of the entry is awaited
+*/
+static void wait_for_callback(timer_wheel *wheel, timer_entry *entry)
+{
+    while (entry->is_firing) {
+        pthread_cond_wait(&wheel->fired, &wheel->lock);
+    }
+}
+
+
+int timer_wheel_init(timer_wheel *wheel)
+{
+    pthread_condattr_t attr;
+
+    for (size_t i = 0; i < TIMER_WHEEL_SLOTS; i++) {
+        wheel->slots[i] = NULL;
+    }
+    wheel->current_tick = 0;
+    wheel->count = 0;
+    wheel->state = TIMER_WHEEL_STOPPED;
+
+    if (pthread_mutex_init(&wheel->lock, NULL) != 0) {
+        return -1;
+    }
+
+    // the timed waiting uses the same clock as the deadlines
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    if (pthread_cond_init(&wheel->wakeup, &attr) != 0) {
+        pthread_condattr_destroy(&attr);
+        pthread_mutex_destroy(&wheel->lock);
+        return -1;
+    }
+    pthread_condattr_destroy(&attr);
+
+    if (pthread_cond_init(&wheel->fired, NULL) != 0) {
+        pthread_cond_destroy(&wheel->wakeup);
+        pthread_mutex_destroy(&wheel->lock);
+        return -1;
+    }
+
+    return 0;
+}
+
+
+int timer_wheel_add(timer_wheel *wheel, timer_entry *entry, long long deadline)
+{
+    pthread_mutex_lock(&wheel->lock);
+
+    if (wheel->state != TIMER_WHEEL_RUNNING) {
+        wheel->state = TIMER_WHEEL_RUNNING;
+        if (pthread_create(&wheel->thread, NULL, timer_main, wheel) != 0) {
+            wheel->state = TIMER_WHEEL_STOPPED;
+            pthread_mutex_unlock(&wheel->lock);
+            return -1;
+        }
+    }
+
+    wait_for_callback(wheel, entry);
+
+    if (entry->is_scheduled) {
+        unlink_entry(wheel, entry);  // a deadline of the previous operation
+    }
+
+    if (!wheel->count) {
+        wheel->current_tick = monotonic_ms() / TIMER_WHEEL_TICK;
+    }
+
+    // the deadline is rounded up to a tick, so it's expired when its slot is processed.
+    // An expired deadline goes to the next processed slot instead of the next revolution
+    deadline = (deadline + TIMER_WHEEL_TICK - 1) / TIMER_WHEEL_TICK * TIMER_WHEEL_TICK;
+    long long min_deadline = wheel->current_tick * TIMER_WHEEL_TICK;
+    entry->deadline = deadline > min_deadline ? deadline : min_deadline;
+    entry->is_fired = 0;
+
+    size_t slot = (size_t)((entry->deadline / TIMER_WHEEL_TICK) % TIMER_WHEEL_SLOTS);
+    entry->prev = NULL;
+    entry->next = wheel->slots[slot];
+    if (entry->next != NULL) {
+        entry->next->prev = entry;
+    }
+    wheel->slots[slot] = entry;
+    entry->is_scheduled = 1;
+
+    if (!wheel->count++) {
+        pthread_cond_signal(&wheel->wakeup);
+    }
+
+    pthread_mutex_unlock(&wheel->lock);
+    return 0;
+}
+
+
+void timer_wheel_remove(timer_wheel *wheel, timer_entry *entry)
+{
+    pthread_mutex_lock(&wheel->lock);
+
+    if (entry->is_scheduled) {
+        unlink_entry(wheel, entry);
+    }
+
+    // the callback uses the handle of the entry, so the handle isn't freed before its return
+    wait_for_callback(wheel, entry);
+
+    pthread_mutex_unlock(&wheel->lock);
+}
+
+
+void timer_wheel_stop(timer_wheel *wheel)
+{
+    pthread_mutex_lock(&wheel->lock);
+
+    if (wheel->state != TIMER_WHEEL_RUNNING) {
+        pthread_mutex_unlock(&wheel->lock);
+        return;
+    }
+
+    wheel->state = TIMER_WHEEL_STOPPED;
+    pthread_cond_signal(&wheel->wakeup);
+    pthread_mutex_unlock(&wheel->lock);
+
+    pthread_join(wheel->thread, NULL);
+}
+
+
+#endif
@@ -0,0 +1,66 @@
+#ifndef _TIMER_WHEEL_H_
+#define _TIMER_WHEEL_H_
+
+
+#ifdef __linux__
+#include <pthread.h>
+#endif
+
+
+#define TIMER_WHEEL_TICK 10  // ms
+#define TIMER_WHEEL_SLOTS 512
+
+#define TIMER_WHEEL_STOPPED 0
+#define TIMER_WHEEL_RUNNING 1
+
+
+typedef void (*timer_callback)(void *arg);
+
+/*
+    A deadline of a cursor or a connection. The fields are changed under the lock of the wheel,
+    so is_fired isn't a bit field, which can share a byte with the fields of the event loop thread
+*/
+typedef struct timer_entry {
+    struct timer_entry *prev;
+    struct timer_entry *next;
+    long long deadline;  // ms of the monotonic clock, 0 - without a deadline
+    timer_callback callback;
+    void *arg;
+    unsigned char is_scheduled;
+    unsigned char is_fired;
+    unsigned char is_firing;  // the callback is running without the lock
+} timer_entry;
+
+long long monotonic_ms(void);
+void timer_entry_init(timer_entry *entry, timer_callback callback, void *arg);
+void check_timer_entry(timer_entry *entry);
+
+
+#ifdef __linux__
+
+/*
+    A hashed timer wheel with one thread for all deadlines of the process.
+    The thread sleeps without deadlines and wakes up once per tick with them.
+    The callbacks are called without the lock, so a slow cancel doesn't block the other deadlines.
+    timer_wheel_remove waits for the running callback of its entry, so after it the callback won't be called
+*/
+typedef struct timer_wheel {
+    timer_entry *slots[TIMER_WHEEL_SLOTS];
+    long long current_tick;  // the next tick to process
+    size_t count;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t wakeup;
+    pthread_cond_t fired;  // a callback has returned
+    int state;
+} timer_wheel;
+
+int timer_wheel_init(timer_wheel *wheel);
+int timer_wheel_add(timer_wheel *wheel, timer_entry *entry, long long deadline);
+void timer_wheel_remove(timer_wheel *wheel, timer_entry *entry);
+void timer_wheel_stop(timer_wheel *wheel);
+
+#endif
+
+
+#endif
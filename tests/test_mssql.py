@@ -1,9 +1,15 @@
 # python -m pytest --asyncio-mode=strict tests/test_mssql.py
 # python -m pytest --asyncio-mode=strict --capture=sys tests\test_mssql.py
 
+import array
 import asyncio
 import datetime
+import io
+import itertools
 import os
+import sys
+import threading
+import time
 
 import pyaodbc
 import pytest
@@ -177,6 +183,100 @@ async def test_get_data(cursor, sql_type, python_type):
     assert result[0]['TestField'] == python_type
 
 
+@pytest.mark.parametrize(
+    ('sql_type', 'python_type'), types_matching_getting_data
+)
+@pytest.mark.asyncio
+async def test_get_data_async(cursor, sql_type, python_type):
+    query = f'select TestField = {sql_type}'
+    await cursor.execute(query, timeout=5)
+    result = await cursor.fetchall_async()
+    assert result[0]['TestField'] == python_type
+
+
+@pytest.mark.asyncio
+async def test_fetchmany(cursor):
+    query = "select TestField = value from (values (1), (2), (3), (4), (5)) as t(value) order by value"
+    await cursor.execute(query, timeout=5)
+    assert [row['TestField'] for row in cursor.fetchmany(2)] == [1, 2]
+    assert [row['TestField'] for row in await cursor.fetchmany_async(2)] == [3, 4]
+    assert [row['TestField'] for row in await cursor.fetchmany_async(2)] == [5]
+    assert await cursor.fetchmany_async(2) == []
+    assert cursor.fetchmany(2) == []
+
+
+@pytest.mark.asyncio
+async def test_prefetch(cursor):
+    query = "select top 1000 TestField = row_number() over (order by (select null)) from sys.all_columns"
+    await cursor.execute(query, timeout=5)
+    batches = [[row['TestField'] for row in rows] async for rows in cursor.prefetch(300, depth=2)]
+    assert [len(rows) for rows in batches] == [300, 300, 300, 100]
+    assert sum(batches, []) == list(range(1, 1001))
+    assert cursor.fetchall() == []
+
+
+@pytest.mark.asyncio
+async def test_prefetch_break(cursor):
+    query = "select top 1000 TestField = 1 from sys.all_columns"
+    await cursor.execute(query, timeout=5)
+    async for rows in cursor.prefetch(10):
+        break
+    cursor.close()
+
+
+@pytest.mark.asyncio
+async def test_get_long_string_async(cursor):
+    await cursor.execute("select TestField = replicate(cast(N'😀' as nvarchar(max)), 5000)", timeout=5)
+    result = await cursor.fetchall_async()
+    assert result[0]['TestField'] == '😀' * 5000
+
+
+@pytest.mark.asyncio
+async def test_get_long_strings(cursor):
+    query = "select TestField = replicate(cast(N'x' as nvarchar(max)), Id * 30000) from (values (1), (2), (3)) t (Id)"
+    await cursor.execute(query, timeout=5)
+    result = cursor.fetchall()
+    assert [row['TestField'] for row in result] == ['x' * 30000, 'x' * 60000, 'x' * 90000]
+
+    await cursor.execute(query, timeout=5)
+    result = await cursor.fetchall_async()
+    assert [row['TestField'] for row in result] == ['x' * 30000, 'x' * 60000, 'x' * 90000]
+
+
+@pytest.mark.parametrize('value', ['Test', 'Tést ÿ', 'Ωmega €', '😀 Test', ''])
+@pytest.mark.asyncio
+async def test_string_parameters(cursor, value):
+    await cursor.execute("select TestField = ?", (value, ), timeout=5)
+    assert cursor.fetchall() == [{'TestField': value}]
+
+
+@pytest.mark.parametrize('value', [b'', b'\x00\xde\xad', bytearray(b'Test'), memoryview(b'-Test-')[1:-1], bytes(9000)])
+@pytest.mark.asyncio
+async def test_binary_values(cursor, value):
+    await cursor.execute("select TestField = convert(varbinary(max), ?), Size = datalength(?)", (value, value), timeout=5)
+    assert cursor.fetchall() == [{'TestField': bytes(value), 'Size': len(value)}]
+
+    await cursor.execute("select TestField = convert(binary(4), 0xDEADBEEF)", timeout=5)
+    assert cursor.fetchall() == [{'TestField': b'\xde\xad\xbe\xef'}]
+
+
+@pytest.mark.asyncio
+async def test_streaming_parameters(cursor):
+    data = bytes(range(256)) * 4096
+    text = 'Ωmega 😀 ' * 10000
+
+    await cursor.execute("select Size = datalength(?), TestField = ?", (io.BytesIO(data), text), timeout=5)
+    assert cursor.fetchall() == [{'Size': len(data), 'TestField': text}]
+
+    async def parts():
+        for i in range(0, len(data), 100000):
+            await asyncio.sleep(0)
+            yield data[i:i + 100000]
+
+    await cursor.execute("select Size = datalength(?), Part = substring(?, 1, 3)", (parts(), iter(['ab', 'cd'])), timeout=5)
+    assert cursor.fetchall() == [{'Size': len(data), 'Part': 'abc'}]
+
+
 @pytest.mark.parametrize(
     ('sql_type', 'python_type'), types_matching_binding_data
 )
@@ -219,6 +319,221 @@ async def test_nonblocking_execute(some_coro, some_query):
     assert results == phrases
 
 
+@pytest.mark.skipif(sys.platform != 'linux', reason='The eventfd wakeups are used only on Linux')
+@pytest.mark.asyncio
+async def test_waiting_without_cpu_usage(cursor):
+    query = """
+        waitfor delay '00:00:02'
+        select TestField = 'Test'
+    """
+    cpu_time = time.process_time()
+    await cursor.execute(query, timeout=5)
+    cpu_time = time.process_time() - cpu_time
+    assert cursor.fetchall()[0]['TestField'] == 'Test'
+    assert cpu_time < 0.5
+
+
+@pytest.mark.asyncio
+async def test_query_timeout(cursor):
+    query = """
+        waitfor delay '00:00:05'
+        select TestField = 'Test'
+    """
+    start_time = time.monotonic()
+    with pytest.raises(TimeoutError) as exc_info:
+        await cursor.execute(query, timeout=0.5)
+    assert exc_info.value.args[0] == '(Cursor_Next) The query timeout expired'
+    assert time.monotonic() - start_time < 2
+
+    await cursor.execute("select TestField = 'Test'", timeout=0.5)
+    assert cursor.fetchall()[0]['TestField'] == 'Test'
+
+
+@pytest.mark.asyncio
+async def test_cancel_execution(cursor):
+    query = """
+        waitfor delay '00:00:05'
+        select TestField = 'Test'
+    """
+    start_time = time.monotonic()
+    with pytest.raises(asyncio.TimeoutError):
+        await asyncio.wait_for(cursor.execute(query), 0.5)
+    assert time.monotonic() - start_time < 2
+
+    await cursor.execute("select TestField = 'Test'", timeout=5)
+    assert cursor.fetchall()[0]['TestField'] == 'Test'
+
+
+@pytest.mark.asyncio
+async def test_cursor_reuse(f_conn):
+    for value in range(20):
+        with f_conn.cursor() as cur:
+            await cur.execute("select TestField = ?", (value, ), timeout=5)
+            assert cur.fetchall() == [{'TestField': value}]
+
+    for value in range(20):
+        cur = f_conn.cursor()
+        await cur.execute("select TestField = ?", (str(value), ), timeout=5)
+        del cur  # the results aren't taken
+
+    with f_conn.cursor() as cur:
+        await cur.execute("select TestField = 'Test'", timeout=5)
+        assert cur.fetchall() == [{'TestField': 'Test'}]
+
+
+@pytest.mark.asyncio
+async def test_statement_cache(f_conn):
+    query = "select TestField = ?"
+    f_conn.configure_statement_cache(2)
+
+    for value in range(5):
+        with f_conn.cursor() as cur:
+            await cur.execute(query, (value, ), timeout=5)
+            assert cur.fetchall() == [{'TestField': value}]
+
+    stats = f_conn.statement_cache_stats()
+    assert (stats['size'], stats['hits'], stats['misses']) == (1, 4, 1)
+
+    with f_conn.cursor() as cur:
+        await cur.prepare("select TestField = 'Test'")
+        await cur.execute("select TestField = 'Test'", timeout=5)
+        assert cur.fetchall() == [{'TestField': 'Test'}]
+
+    for value in range(3):
+        with f_conn.cursor() as cur:
+            await cur.execute(f"select TestField = {value}", timeout=5)
+            cur.fetchall()
+
+    stats = f_conn.statement_cache_stats()
+    assert stats['size'] == 2 and stats['evictions'] == 3
+
+    f_conn.configure_statement_cache(0)
+    assert f_conn.statement_cache_stats()['size'] == 0
+
+
+@pytest.mark.asyncio
+async def test_executemany(f_conn):
+    rows = [(i, f'Name {i}' if i % 3 else None, i * 0.5) for i in range(2500)]
+
+    with f_conn.cursor() as cur:
+        await cur.execute("create table #Rows (Id int, Name nvarchar(50), Value float)", timeout=5)
+        statuses = await cur.executemany("insert into #Rows values (?, ?, ?)", rows, batch_size=1000, timeout=5)
+        assert statuses == [pyaodbc.PARAM_SUCCESS] * len(rows)
+
+        await cur.execute("select Count = count(*), Names = count(Name), Total = sum(Value) from #Rows", timeout=5)
+        assert cur.fetchall() == [{'Count': 2500, 'Names': 1666, 'Total': sum(row[2] for row in rows)}]
+
+        with pytest.raises(TypeError):
+            await cur.executemany("insert into #Rows values (?, ?, ?)", [(1, 'a', 1.0), ('b', 'b', 2.0)])
+
+
+@pytest.mark.asyncio
+async def test_insert_columns(f_conn):
+    ids = array.array('q', range(2500))
+    values = array.array('d', (i * 0.5 for i in range(2500)))
+    validity = bytes(i % 3 != 0 for i in range(2500))
+    names = [f'Name {i}'.encode() for i in range(2500)]
+    offsets = array.array('i', itertools.accumulate((len(name) for name in names), initial=0))
+
+    with f_conn.cursor() as cur:
+        await cur.execute("create table #Columns (Id bigint, Name nvarchar(50), Value float)", timeout=5)
+        statuses = await cur.insert_columns(
+            "insert into #Columns values (?, ?, ?)",
+            {
+                'id': ids,
+                'name': {'offsets': offsets, 'data': b''.join(names), 'validity': validity},
+                'value': values,
+            },
+            batch_size=1000,
+            timeout=5
+        )
+        assert statuses == [pyaodbc.PARAM_SUCCESS] * len(ids)
+
+        await cur.execute("select Count = count(*), Names = count(Name), Total = sum(Value) from #Columns", timeout=5)
+        assert cur.fetchall() == [{'Count': 2500, 'Names': 1666, 'Total': sum(values)}]
+
+        with pytest.raises(ValueError):
+            await cur.insert_columns("insert into #Columns (Id, Value) values (?, ?)", {'id': ids, 'value': values[:10]})
+
+
+@pytest.mark.asyncio
+async def test_rebinding_parameters(f_conn):
+    query = "select A = ?, B = ?"
+    values = [(1, 'ab'), (2, 'cd'), (3, None), ('x', 1.5), (5000000000, 'longer'), (True, datetime.date(2020, 1, 2))]
+
+    with f_conn.cursor() as cur:
+        for params in values:
+            await cur.execute(query, params, timeout=5)
+            assert cur.fetchall() == [{'A': params[0], 'B': params[1]}]
+
+        # the bindings of the dropped parameters aren't kept by the handle
+        for query, params, row in [
+            ("select A = ?, B = ?, C = ?", (1, 'ab', 1.5), {'A': 1, 'B': 'ab', 'C': 1.5}),
+            ("select A = ?", ('x', ), {'A': 'x'}),
+            ("select A = 1", None, {'A': 1}),
+            ("select A = ?, B = ?", (2, 'cd'), {'A': 2, 'B': 'cd'}),
+        ]:
+            await cur.execute(query, params, timeout=5)
+            assert cur.fetchall() == [row]
+
+        # the strings of different lengths share the buffer of the parameter
+        for value in ['', 'a', 'b' * 16, 'c' * 17, 'd' * 40, 'e' * 3, 'f' * 2001, 'g' * 10]:
+            await cur.execute("select A = ?", (value, ), timeout=5)
+            assert cur.fetchall() == [{'A': value}]
+
+
+@pytest.mark.asyncio
+async def test_named_parameters(f_cur):
+    await f_cur.execute("select A = :a, B = %(b)s, C = :a, D = '?:a' -- ?", {'a': 1, 'b': 'x'}, timeout=5)
+    assert f_cur.fetchall() == [{'A': 1, 'B': 'x', 'C': 1, 'D': '?:a'}]
+
+    await f_cur.execute("select [A?] = ? /* :a */", (2, ), timeout=5)
+    assert f_cur.fetchall() == [{'A?': 2}]
+
+    with pytest.raises(TypeError) as exc_info:
+        await f_cur.execute("select A = :a", {'b': 1}, timeout=5)
+    assert exc_info.value.args[0] == "(Cursor_Execute) The parameter 'a' isn't given"
+
+
+@pytest.mark.asyncio
+async def test_result_sets(f_conn):
+    with f_conn.cursor() as cur:
+        await cur.execute("create table #Sets (Id int)", timeout=5)
+        await cur.execute("insert into #Sets values (1), (2); select Id from #Sets; select Value = 'A'", timeout=5)
+        assert cur.rowcount == 2
+        assert cur.fetchall() == []
+        assert await cur.nextset_async() is True
+        assert cur.fetchall() == [{'Id': 1}, {'Id': 2}]
+        assert cur.nextset() is True
+        assert cur.fetchall() == [{'Value': 'A'}]
+        assert await cur.nextset_async() is False
+
+        query = "update #Sets set Id = 3 where Id = 1; delete from #Sets where Id = 0; select Id from #Sets order by Id"
+        await cur.execute(query, timeout=5)
+        assert await cur.fetch_all_sets() == [1, 0, [{'Id': 2}, {'Id': 3}]]
+
+
+@pytest.mark.asyncio
+async def test_batching(f_conn):
+    f_conn.configure_batching(8, 0.01)
+    results = await asyncio.gather(*(f_conn.fetchall("select Value = ?", (i, ), timeout=5) for i in range(20)))
+    assert results == [[{'Value': i}] for i in range(20)]
+
+    # an error of a query fails only its query
+    results = await asyncio.gather(
+        f_conn.fetchall("select Value = ?", (1, ), timeout=5),
+        f_conn.fetchall("select Value = 1 / 0", timeout=5),
+        f_conn.fetchall("select Value = ?", (2, ), timeout=5),
+        return_exceptions=True,
+    )
+    assert results[0] == [{'Value': 1}]
+    assert isinstance(results[1], Exception) and '22012' in str(results[1])
+    assert results[2] == [{'Value': 2}]
+
+    f_conn.configure_batching(0)
+    assert await f_conn.fetchall("select Value = 'A'") == [{'Value': 'A'}]
+
+
 @pytest.mark.asyncio
 async def test_concurrent_execution():
     async def execute(query, params=None):
@@ -236,6 +551,82 @@ async def test_concurrent_execution():
     assert len(results) == len(tasks)
 
 
+def test_execution_in_threads():
+    def execute(results):
+        async def run():
+            async with pyaodbc.connect(DSN, 3) as conn:
+                with conn.cursor() as cur:
+                    for _ in range(10):
+                        await cur.execute("select TestField = 'Test'", timeout=5)
+                        results.append(cur.fetchall()[0]['TestField'])
+
+        asyncio.run(run())
+
+    results = []
+    threads = [threading.Thread(target=execute, args=(results,)) for _ in range(4)]
+    for thread in threads:
+        thread.start()
+    for thread in threads:
+        thread.join()
+    assert results == ['Test'] * 40
+
+
+def test_exception_in_cursor_instantiation():
+    with pytest.raises(TypeError):
+        pyaodbc.Cursor()
+    with pytest.raises(TypeError):
+        pyaodbc.Connection()
+
+
+@pytest.mark.asyncio
+async def test_pool():
+    async with pyaodbc.create_pool(DSN, min_size=1, max_size=2, timeout=3) as pool:
+        async with pool.acquire() as conn:
+            with conn.cursor() as cur:
+                await cur.execute("select TestField = 'Test'", timeout=5)
+                assert cur.fetchall() == [{'TestField': 'Test'}]
+
+        results = await asyncio.gather(*[
+            pool.fetchall("waitfor delay '00:00:00.2' select TestField = ?", (i, ), timeout=5) for i in range(5)
+        ])
+        assert results == [[{'TestField': i}] for i in range(5)]
+        assert await pool.execute("select TestField = 'Test'", timeout=5) is None
+
+        stats = pool.stats()
+        assert stats['size'] == 2
+        assert stats['idle'] == 2
+        assert stats['waiting'] == 0
+
+
+@pytest.mark.asyncio
+async def test_connect_many():
+    results = await pyaodbc.connect_many(DSN, 3, timeout=3)
+    assert len(results) == 3
+    for conn in results:
+        assert isinstance(conn, pyaodbc.Connection)
+        with conn.cursor() as cur:
+            await cur.execute("select TestField = 'Test'", timeout=5)
+            assert cur.fetchall() == [{'TestField': 'Test'}]
+        await conn.close()
+
+
+@pytest.mark.asyncio
+async def test_exception_in_connect_many_quorum():
+    with pytest.raises(AttributeError) as exc_info:
+        await pyaodbc.connect_many(DSN, 2, timeout=3, quorum=3)
+    assert exc_info.value.args[0] == '(create_connection_group) The values must be 1 <= n, 0 <= quorum <= n'
+
+
+@pytest.mark.asyncio
+async def test_exception_in_pool_release():
+    async with pyaodbc.create_pool(DSN, min_size=1, max_size=1, timeout=3) as pool:
+        conn = await pool.acquire()
+        pool.release(conn)
+        with pytest.raises(Exception) as exc_info:
+            pool.release(conn)
+        assert exc_info.value.args[0] == "(release_connection) The connection isn't acquired from the pool"
+
+
 @pytest_asyncio.fixture(scope='function')
 async def f_conn():
     conn = await pyaodbc.connect(DSN, 3)
@@ -342,12 +733,16 @@ async def test_exception_in_close_cursor_on_not_opened_cursor(f_cur):
 
 
 @pytest.mark.asyncio
-async def test_exception_in_close_cursor_on_prepare_execute(f_cur):
-    with pytest.raises(Exception) as exc_info:
-        statement = f_cur.execute("select TestField = 'Test'", timeout=5)
-        f_cur.close()
-    assert exc_info.value.args[0] == "(free_cursor) Canceling of the executed instruction isn't implemented"
-    await statement
+async def test_close_cursor_on_prepare_execute(f_conn):
+    cur = f_conn.cursor()
+    cur.execute("waitfor delay '00:00:05'", timeout=10)
+    start_time = time.monotonic()
+    cur.close()
+    assert time.monotonic() - start_time < 2
+
+    with f_conn.cursor() as cur:
+        await cur.execute("select TestField = 'Test'", timeout=5)
+        assert cur.fetchall()[0]['TestField'] == 'Test'
 
 
 @pytest.mark.asyncio
@@ -399,16 +794,14 @@ async def test_exception_in_prepare_execute_on_close_cursor(f_cur):
 
 
 @pytest.mark.asyncio
-async def test_exception_in_prepare_execute_on_runned_cursors(f_conn):
-    with pytest.raises(Exception) as exc_info:
-        cur1 = f_conn.cursor()
-        cur2 = f_conn.cursor()
-        await asyncio.gather(
-            cur1.execute("select TestField = 'Test'", timeout=5),
-            cur2.execute("select TestField = 'Test'", timeout=5)
-        )
-    assert exc_info.value.args[0] == "(prepare_execute) The number of cursors from one connection can't exceed " \
-                                     "max concurrent activities (1)"
+async def test_queue_of_runned_cursors(f_conn):
+    async def execute(value):
+        with f_conn.cursor() as cur:
+            await cur.execute("select TestField = ?", (value, ), timeout=5)
+            return cur.fetchall()
+
+    results = await asyncio.gather(*[execute(i) for i in range(3)])
+    assert results == [[{'TestField': i}] for i in range(3)]
 
 
 @pytest.mark.parametrize(
@@ -470,3 +863,63 @@ async def test_exception_in_cursor_fetchall_on_not_executed_cursor(f_cur):
     with pytest.raises(Exception) as exc_info:
         f_cur.fetchall()
     assert exc_info.value.args[0] == "(Cursor_Fetchall) The cursor wasn't executed"
+
+
+@pytest.mark.asyncio
+async def test_exception_in_cursor_fetchmany_async_on_wrong_size(f_cur):
+    await f_cur.execute("select TestField = 'Test'", timeout=5)
+    with pytest.raises(Exception) as exc_info:
+        await f_cur.fetchmany_async(0)
+    assert exc_info.value.args[0] == "(Cursor_FetchmanyAsync) The size must be positive"
+    assert (await f_cur.fetchall_async())[0]['TestField'] == 'Test'
+
+
+@pytest.mark.asyncio
+async def test_exception_in_async_iteration_without_prefetch(f_cur):
+    await f_cur.execute("select TestField = 'Test'", timeout=5)
+    with pytest.raises(TypeError) as exc_info:
+        async for _ in f_cur:
+            pass
+    assert exc_info.value.args[0] == "(Cursor_ANext) The cursor isn't prefetching, You need to call prefetch"
+
+
+@pytest.mark.skipif(sys.platform != 'linux', reason='The worker pool is used only on Linux')
+@pytest.mark.asyncio
+async def test_pool_stats(f_cur):
+    await f_cur.execute("select TestField = 'Test'", timeout=5)
+    f_cur.fetchall()
+    stats = pyaodbc.pool_stats()
+    assert stats['started'] is True
+    assert stats['threads'] > 0
+    assert stats['depth'] >= 0
+    assert stats['active'] >= 0
+    assert stats['polled'] >= 0
+
+
+@pytest.mark.skipif(sys.platform != 'linux', reason='The poller is used only on Linux')
+@pytest.mark.asyncio
+async def test_polling():
+    async def execute(delay):
+        async with pyaodbc.connect(DSN, 3, polling=True) as conn:
+            with conn.cursor() as cur:
+                await cur.execute(f"waitfor delay '00:00:0{delay}' select TestField = {delay}", timeout=5)
+                return cur.fetchall()[0]['TestField']
+
+    results = await asyncio.gather(*[execute(delay) for delay in (1, 1, 2, 1)])
+    assert results == [1, 1, 2, 1]
+    assert pyaodbc.pool_stats()['polled'] == 0
+
+
+@pytest.mark.skipif(sys.platform != 'linux', reason='The worker pool is used only on Linux')
+@pytest.mark.asyncio
+async def test_exception_in_configure_started_pool(f_conn):
+    with pytest.raises(Exception) as exc_info:
+        pyaodbc.configure_pool(threads=4)
+    assert exc_info.value.args[0] == '(PyAODBC_ConfigurePool) The worker pool is already started'
+
+
+@pytest.mark.asyncio
+async def test_exception_in_configure_allocated_environment(f_conn):
+    with pytest.raises(Exception) as exc_info:
+        pyaodbc.configure_environment(pooling=True)
+    assert exc_info.value.args[0] == '(PyAODBC_ConfigureEnvironment) The environment is already allocated'